@@ -39,10 +39,20 @@
 
 #import <LdapKit/LKEnumerations.h>
 #import <LdapKit/models/LKBerValue.h>
+#import <LdapKit/models/LKChange.h>
 #import <LdapKit/models/LKEntry.h>
+#import <LdapKit/models/LKEntryWriter.h>
+#import <LdapKit/models/LKFilter.h>
+#import <LdapKit/models/LKHedgePolicy.h>
 #import <LdapKit/models/LKLdap.h>
+#import <LdapKit/models/LKLdifReader.h>
 #import <LdapKit/models/LKMessage.h>
+#import <LdapKit/models/LKMetrics.h>
 #import <LdapKit/models/LKMod.h>
+#import <LdapKit/models/LKReplica.h>
+#import <LdapKit/models/LKScheduler.h>
+#import <LdapKit/models/LKSearchCache.h>
+#import <LdapKit/models/LKServer.h>
 #import <LdapKit/models/LKUrl.h>
 
 #if TARGET_OS_IPHONE
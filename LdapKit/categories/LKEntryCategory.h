@@ -40,8 +40,14 @@
 
 /// @name Object Management Methods
 - (id) initWithDn:(const char *)entryDN;
+- (id) initWithMessage:(LDAPMessage *)msg ld:(LDAP *)ld
+       attributeTable:(LKAttributeTable *)table;
 
 /// @name queries
+- (LKAttributeTable *) berAttributeTable;
+- (NSUInteger) berSize;
+- (NSUInteger) berValueCountWithLength:(NSUInteger *)lengthp;
+- (BerVarray) berValuesForIdentifier:(NSUInteger)identifier;
 - (void) setBerValues:(BerValue **)vals forAttribute:(const char *)attribute;
 
 @end
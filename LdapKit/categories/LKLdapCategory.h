@@ -39,7 +39,14 @@
 @interface LKLdap ()
 
 /// @name server state
-@property (nonatomic, assign)   LDAP * ld;
 - (void) setIsConnected:(BOOL)connected;
 
+/// @name connection pool
+- (LKConnection *) checkoutConnectionForMessage:(LKMessage *)message;
+- (void) checkinConnection:(LKConnection *)connection;
+- (LKConnection *) checkoutHedgeConnectionExceptServer:(LKServer *)server;
+- (LKConnection *) checkoutNewConnection;
+- (void) resetConnectionsExcept:(LKConnection *)connection;
+- (void) signalConnectionWaiters;
+
 @end
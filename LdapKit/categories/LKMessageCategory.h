@@ -35,10 +35,13 @@
  *  LdapKit/LKMessageCategory.h private/hidden interface for LKMessage
  */
 #import "LKMessage.h"
+#include <ldap.h>
 
 @interface LKMessage ()
 
 /// @name Object Management Methods
+- (id) initAddWithSession:(LKLdap *)session dn:(NSString *)dn
+       mods:(NSArray *)mods;
 - (id) initBindWithSession:(LKLdap *)session;
 - (id) initDeleteWithSession:(LKLdap *)session dn:(NSString *)dn;
 - (id) initModifyWithSession:(LKLdap *)session dn:(NSString *)dn
@@ -52,7 +55,55 @@
 - (id) initSearchWithSession:(LKLdap *)session baseDnList:(NSArray *)dnList
        scope:(LKLdapSearchScope)scope filter:(NSString *)filter
        attributes:(NSArray *)attributes attributesOnly:(BOOL)attributesOnly;
+- (id) initSearchWithSession:(LKLdap *)session baseDnList:(NSArray *)dnList
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes attributesOnly:(BOOL)attributesOnly
+       batchSize:(NSUInteger)batchSize entryHandler:(LKMessageEntryHandler)handler;
+- (id) initSearchWithSession:(LKLdap *)session baseDnList:(NSArray *)dnList
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes attributesOnly:(BOOL)attributesOnly
+       uniqueEntries:(BOOL)uniqueEntries;
+- (id) initSearchWithSession:(LKLdap *)session baseDnList:(NSArray *)dnList
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes attributesOnly:(BOOL)attributesOnly
+       writer:(LKEntryWriter *)writer;
+- (id) initSearchWithSession:(LKLdap *)session baseDN:(NSString *)dn
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes sortKeys:(NSArray *)sortKeys
+       window:(NSRange)window contextID:(NSData *)contextID;
+- (id) initSyncWithSession:(LKLdap *)session baseDN:(NSString *)dn
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes replica:(LKReplica *)replica
+       persist:(BOOL)persist;
+- (id) initBatchWithSession:(LKLdap *)session changes:(NSArray *)changes
+       windowSize:(NSUInteger)windowSize
+       progressHandler:(LKMessageProgressHandler)handler;
+- (id) initImportWithSession:(LKLdap *)session reader:(LKLdifReader *)reader
+       windowSize:(NSUInteger)windowSize continueOnError:(BOOL)continueOnError
+       changeHandler:(LKMessageChangeHandler)handler;
+- (id) initPrewarmWithSession:(LKLdap *)session;
 - (id) initRebindWithSession:(LKLdap *)session;
 - (id) initUnbindWithSession:(LKLdap *)session;
 
+/// @name Search cache
+- (void) setCachedEntries:(NSArray *)cached;
+- (void) setSearchCacheKey:(NSString *)key generation:(NSUInteger)generation;
+
+/// @name Scheduling
+- (NSUInteger) schedulerLaneWithInteractiveSizeLimit:(NSInteger)limit;
+
+/// @name Replica routing
+- (BOOL) requiresPrimaryServer;
+
+/// @name Metrics
+- (void) enableMetrics;
+
+/// @name Completion
+- (void) setCompletionHandler:(LKMessageCompletionHandler)handler
+         queue:(dispatch_queue_t)queue;
+
+/// @name Dispatcher
+- (void) deliverResult:(LDAPMessage *)res;
+- (void) deliverErrorCode:(int)err;
+
 @end
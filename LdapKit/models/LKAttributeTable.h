@@ -0,0 +1,82 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKAttributeTable interns the attribute descriptions of the entries
+ *  returned by an LKMessage. Each distinct description is stored once and is
+ *  identified by a small integer which LKEntry objects use as an index into
+ *  their attribute slots. Descriptions are compared case-insensitively.
+ */
+
+#import <Foundation/Foundation.h>
+#import <ldap.h>
+
+@interface LKAttributeTable : NSObject
+{
+   // interned names
+   NSMutableArray         * names;
+   struct berval          * berNames;
+   NSUInteger               count;
+   NSUInteger               size;
+
+   // hash table of identifiers
+   NSUInteger             * buckets;
+   NSUInteger               bucketCount;
+}
+
+#pragma mark - Interned names
+/// @name Interned names
+
+/// The number of attribute descriptions in the table.
+@property (nonatomic, readonly) NSUInteger               count;
+
+/// Returns the identifier of an attribute description, adding the
+/// description to the table if it has not been seen.
+/// @param name The attribute description as received from the server.
+/// @return Returns the identifier or `NSNotFound` if memory could not be
+/// allocated.
+- (NSUInteger) identifierForBerValue:(struct berval *)name;
+
+/// Returns the identifier of an attribute description without modifying the
+/// table.
+/// @param name The attribute description.
+/// @return Returns the identifier or `NSNotFound` if the description is not in
+/// the table.
+- (NSUInteger) identifierForName:(NSString *)name;
+
+/// Returns the attribute description of an identifier.
+/// @param identifier An identifier returned by the table.
+/// @return Returns the attribute description as first received.
+- (NSString *) nameForIdentifier:(NSUInteger)identifier;
+
+@end
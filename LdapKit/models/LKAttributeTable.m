@@ -0,0 +1,250 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKAttributeTable.m - interned attribute descriptions
+ */
+#import "LKAttributeTable.h"
+
+#include <ctype.h>
+#include <strings.h>
+
+
+@interface LKAttributeTable ()
+
+/// @name Hash table
+- (NSUInteger) bucketForBytes:(const char *)bytes length:(size_t)len
+               identifier:(NSUInteger *)identifierp;
+- (BOOL) resizeBuckets;
+
+@end
+
+
+@implementation LKAttributeTable
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   NSUInteger pos;
+
+   // interned names
+   [names release];
+   for(pos = 0; pos < count; pos++)
+      free(berNames[pos].bv_val);
+   free(berNames);
+
+   // hash table of identifiers
+   free(buckets);
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   if ((self = [super init]) == nil)
+      return(self);
+
+   names = [[NSMutableArray alloc] initWithCapacity:32];
+
+   return(self);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSUInteger) count
+{
+   @synchronized(self)
+   {
+      return(count);
+   };
+}
+
+
+#pragma mark - Interned names
+
+- (NSUInteger) identifierForBerValue:(struct berval *)name
+{
+   NSUInteger   bucket;
+   NSUInteger   identifier;
+   NSString   * string;
+   void       * ptr;
+
+   NSAssert((name != NULL), @"name must not be NULL");
+
+   @synchronized(self)
+   {
+      // returns the identifier of a known name
+      bucket = [self bucketForBytes:name->bv_val length:name->bv_len identifier:&identifier];
+      if (identifier != NSNotFound)
+         return(identifier);
+
+      // keeps the table at most half full
+      if ((count + 1) * 2 > bucketCount)
+      {
+         if (!([self resizeBuckets]))
+            return(NSNotFound);
+         bucket = [self bucketForBytes:name->bv_val length:name->bv_len identifier:&identifier];
+      };
+      if (count >= size)
+      {
+         if ((ptr = realloc(berNames, sizeof(struct berval) * (size + 32))) == NULL)
+            return(NSNotFound);
+         berNames  = ptr;
+         size     += 32;
+      };
+
+      // stores the name once
+      string = [[NSString alloc] initWithBytes:name->bv_val length:name->bv_len
+                  encoding:NSUTF8StringEncoding];
+      if ((string == nil) || ((ptr = malloc(name->bv_len + 1)) == NULL))
+      {
+         [string release];
+         return(NSNotFound);
+      };
+      memcpy(ptr, name->bv_val, name->bv_len);
+      ((char *)ptr)[name->bv_len] = '\0';
+      berNames[count].bv_val = ptr;
+      berNames[count].bv_len = name->bv_len;
+      [names addObject:string];
+      [string release];
+
+      buckets[bucket] = count + 1;
+      count++;
+
+      return(count - 1);
+   };
+}
+
+
+- (NSUInteger) identifierForName:(NSString *)name
+{
+   const char * str;
+   NSUInteger   identifier;
+
+   NSAssert((name != nil), @"name must not be nil");
+
+   str = [name UTF8String];
+   @synchronized(self)
+   {
+      if (!(bucketCount))
+         return(NSNotFound);
+      [self bucketForBytes:str length:strlen(str) identifier:&identifier];
+      return(identifier);
+   };
+}
+
+
+- (NSString *) nameForIdentifier:(NSUInteger)identifier
+{
+   @synchronized(self)
+   {
+      if (identifier >= count)
+         return(nil);
+      return([[[names objectAtIndex:identifier] retain] autorelease]);
+   };
+}
+
+
+#pragma mark - Hash table
+
+- (NSUInteger) bucketForBytes:(const char *)bytes length:(size_t)len
+               identifier:(NSUInteger *)identifierp
+{
+   NSUInteger   hash;
+   NSUInteger   bucket;
+   NSUInteger   entry;
+   size_t       pos;
+
+   *identifierp = NSNotFound;
+   if (!(bucketCount))
+      return(0);
+
+   // FNV-1a hash of the lower case name
+   hash = 2166136261U;
+   for(pos = 0; pos < len; pos++)
+      hash = (hash ^ (NSUInteger)tolower((unsigned char)bytes[pos])) * 16777619U;
+
+   // linear probing, empty buckets contain zero
+   bucket = hash & (bucketCount - 1);
+   while ((entry = buckets[bucket]) != 0)
+   {
+      if ( (berNames[entry-1].bv_len == len) &&
+           (!(strncasecmp(berNames[entry-1].bv_val, bytes, len))) )
+      {
+         *identifierp = entry - 1;
+         return(bucket);
+      };
+      bucket = (bucket + 1) & (bucketCount - 1);
+   };
+
+   return(bucket);
+}
+
+
+- (BOOL) resizeBuckets
+{
+   NSUInteger   * old;
+   NSUInteger     oldCount;
+   NSUInteger     pos;
+   NSUInteger     bucket;
+   NSUInteger     identifier;
+
+   old      = buckets;
+   oldCount = bucketCount;
+
+   bucketCount = ((oldCount)) ? (oldCount * 2) : 64;
+   if ((buckets = calloc(bucketCount, sizeof(NSUInteger))) == NULL)
+   {
+      buckets     = old;
+      bucketCount = oldCount;
+      return(NO);
+   };
+
+   // rehashes the existing names
+   for(pos = 0; pos < count; pos++)
+   {
+      bucket = [self bucketForBytes:berNames[pos].bv_val length:berNames[pos].bv_len
+                     identifier:&identifier];
+      buckets[bucket] = pos + 1;
+   };
+   free(old);
+
+   return(YES);
+}
+
+@end
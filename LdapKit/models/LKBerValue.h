@@ -48,7 +48,8 @@
 @interface LKBerValue : NSObject <NSCopying>
 {
    // BerValue data
-   NSMutableData * berData;
+   NSData        * berData;
+   id              berOwner;
 
    // Derived data
    id <NSObject>   berImage;
@@ -134,6 +135,27 @@
 @property (nonatomic, readonly) NSString   * berStringBase64;
 
 
+#pragma mark - Base64
+/// @name Base64
+
+/// Encodes binary data as a base64 string.
+/// @param data The NSData object to encode.
+/// @return Returns the base64 encoding of the data without line breaks.
++ (NSString *) base64StringWithData:(NSData *)data;
+
+/// Decodes base64 encoded characters.
+/// @param bytes The base64 characters to decode. Whitespace is ignored.
+/// @param len The number of characters to decode.
+/// @return Returns the decoded data or nil if the characters are not valid
+/// base64.
++ (NSData *) dataWithBase64Bytes:(const char *)bytes length:(size_t)len;
+
+/// Decodes a base64 encoded string.
+/// @param string The base64 string to decode. Whitespace is ignored.
+/// @return Returns the decoded data or nil if the string is not valid base64.
++ (NSData *) dataWithBase64String:(NSString *)string;
+
+
 #pragma mark - Type of data
 /// @name Type of data
 
@@ -35,14 +35,20 @@
  *  LdapKit/LKBerValue.m convenience class for BerValue.
  */
 #import "LKBerValue.h"
+#import "LKBerValueCategory.h"
 
+// defining LK_BASE64_SCALAR builds the library with only the scalar codec
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(LK_BASE64_SCALAR)
+#define LK_BASE64_SSSE3 1
+#include <tmmintrin.h>
+#endif
 
-@interface LKBerValue ()
-
-/// @name calculations
-- (NSString *) convertToBase64:(NSData *)value;
 
-@end
+#ifdef LK_BASE64_SSSE3
+static int lk_base64_has_ssse3(void);
+static size_t lk_base64_encode_ssse3(const uint8_t * src, size_t len, char * dst);
+static size_t lk_base64_decode_ssse3(const char * src, size_t len, uint8_t * dst);
+#endif
 
 
 @implementation LKBerValue
@@ -58,7 +64,8 @@
 - (void) dealloc
 {
    // BerVal data
-   [berData release];
+   [berData  release];
+   [berOwner release];
 
    // derived data
    [berImage        release];
@@ -84,6 +91,25 @@
 }
 
 
+- (id) initWithBerValue:(BerValue *)value owner:(id)owner
+{
+   NSAssert((value != NULL), @"BerValue must not be NULL");
+   NSAssert((owner != nil),  @"owner must not be nil");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // references the value in place, the owner keeps the buffer allocated
+   berOwner = [owner retain];
+   if (!(value->bv_len))
+      berData = [[NSData alloc] init];
+   else
+      berData = [[NSData alloc] initWithBytesNoCopy:value->bv_val
+                  length:value->bv_len freeWhenDone:NO];
+
+   return(self);
+}
+
+
 - (id) initWithData:(NSData *)value
 {
    NSAssert((value != NULL), @"NSData must not be nil");
@@ -180,7 +206,21 @@
 
 - (NSData *) berData
 {
-   return([[berData retain] autorelease]);
+   NSData * data;
+   @synchronized(self)
+   {
+      // copies values referencing a buffer of the owner before exposing the
+      // data, the NSData may outlive the owner
+      if ((berOwner))
+      {
+         data = [[NSData alloc] initWithData:berData];
+         [berData  autorelease];
+         [berOwner autorelease];
+         berData  = data;
+         berOwner = nil;
+      };
+      return([[berData retain] autorelease]);
+   };
 }
 
 
@@ -192,7 +232,7 @@
          return([[berImage retain] autorelease]);
       attemptedImage = YES;
 #if TARGET_OS_IPHONE
-      berImage = [[UIImage alloc] initWithData:berData];
+      berImage = [[UIImage alloc] initWithData:[self berData]];
 #else
       berImage = [[NSData alloc] initWithData:berData];
 #endif
@@ -222,7 +262,8 @@
       if ((attemptedStringBase64))
          return([[berStringBase64 retain] autorelease]);
       pool = [[NSAutoreleasePool alloc] init];
-      berStringBase64 = [[self convertToBase64:berData] retain];
+      attemptedStringBase64 = YES;
+      berStringBase64 = [[LKBerValue base64StringWithData:berData] retain];
       [pool release];
    };
    return([[berStringBase64 retain] autorelease]);
@@ -273,19 +314,194 @@
 
 #pragma mark - calculations
 
-- (NSString *) convertToBase64:(NSData *)value
++ (NSString *) base64StringWithData:(NSData *)data
 {
-   NSUInteger        encLen;
-   NSUInteger        srcLen;
-   NSUInteger        pos;
-   const char      * src;
-   char            * enc;
-   char            * buff;
-   char              pad[4];
    NSString        * base64Value;
+   char            * enc;
+   size_t            encLen;
+
+   // allocates memory for buffer
+   if (!(enc = malloc([LKBerValue lengthOfBase64:[data length]] + 1)))
+      return(nil);
+
+   // encodes data
+   encLen = [LKBerValue encodeBase64:[data bytes] length:[data length] buffer:enc];
+
+   // creates NSString of base64
+   base64Value = [[NSString alloc] initWithBytes:enc length:encLen
+                  encoding:NSASCIIStringEncoding];
+
+   // frees resources
+   free(enc);
+
+   return([base64Value autorelease]);
+}
+
+
++ (NSData *) dataWithBase64Bytes:(const char *)bytes length:(size_t)len
+{
+   uint8_t         * dec;
+   size_t            decLen;
+
+   // allocates memory for buffer, SIMD decoding stores 16 bytes per block
+   if (!(dec = malloc(((len + 3) / 4) * 3 + 16)))
+      return(nil);
+
+   // decodes data
+   if (lk_base64_decode(bytes, len, dec, &decLen) == -1)
+   {
+      free(dec);
+      return(nil);
+   };
+
+   return([NSData dataWithBytesNoCopy:dec length:decLen freeWhenDone:YES]);
+}
+
+
++ (NSData *) dataWithBase64String:(NSString *)string
+{
+   const char * bytes;
+   if (!(bytes = [string UTF8String]))
+      return(nil);
+   return([LKBerValue dataWithBase64Bytes:bytes length:strlen(bytes)]);
+}
+
+
++ (size_t) encodeBase64:(const void *)src length:(size_t)len buffer:(char *)dst
+{
+   return(lk_base64_encode(src, len, dst));
+}
+
+
++ (size_t) lengthOfBase64:(size_t)len
+{
+   return(((len + 2) / 3) * 4);
+}
+
+
+#pragma mark - C functions
+
+#ifdef LK_BASE64_SSSE3
+static int lk_base64_has_ssse3(void)
+{
+   static int hasSSSE3 = -1;
+   if (hasSSSE3 == -1)
+      hasSSSE3 = (__builtin_cpu_supports("ssse3")) ? 1 : 0;
+   return(hasSSSE3);
+}
+
+
+__attribute__((target("ssse3")))
+static size_t lk_base64_encode_ssse3(const uint8_t * src, size_t len, char * dst)
+{
+   size_t    pos;
+   __m128i   in;
+   __m128i   t0;
+   __m128i   t1;
+   __m128i   t2;
+   __m128i   t3;
+   __m128i   indices;
+   __m128i   result;
+   __m128i   less;
+
+   const __m128i shuffle  = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+   const __m128i shiftLUT = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+
+   // encodes 12 bytes at a time, 16 bytes are loaded for each block
+   for(pos = 0; (pos + 16) <= len; pos += 12)
+   {
+      // splits each group of 3 bytes into 4 indices
+      in      = _mm_loadu_si128((const __m128i *)&src[pos]);
+      in      = _mm_shuffle_epi8(in, shuffle);
+      t0      = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+      t1      = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+      t2      = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+      t3      = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+      indices = _mm_or_si128(t1, t3);
+
+      // maps each index to the offset of its character range
+      result  = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+      less    = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+      result  = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+      result  = _mm_shuffle_epi8(shiftLUT, result);
+      result  = _mm_add_epi8(result, indices);
+
+      _mm_storeu_si128((__m128i *)dst, result);
+      dst += 16;
+   };
+
+   return(pos);
+}
+
+
+__attribute__((target("ssse3")))
+static size_t lk_base64_decode_ssse3(const char * src, size_t len, uint8_t * dst)
+{
+   size_t    pos;
+   __m128i   in;
+   __m128i   hi;
+   __m128i   lo;
+   __m128i   shift;
+   __m128i   slash;
+   __m128i   mask;
+   __m128i   bits;
+   __m128i   out;
+
+   const __m128i shiftLUT  = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71,
+                                           0, 0,  0, 0,   0,   0,   0,   0);
+   const __m128i maskLUT   = _mm_setr_epi8((char)0xa8, (char)0xf8, (char)0xf8, (char)0xf8,
+                                           (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8,
+                                           (char)0xf8, (char)0xf8, (char)0xf0, (char)0x54,
+                                           (char)0x50, (char)0x50, (char)0x50, (char)0x54);
+   const __m128i bitposLUT = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+   const __m128i pack      = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                           -1, -1, -1, -1);
+
+   // decodes 16 characters at a time and stops at the first block which
+   // contains padding, whitespace, or invalid characters
+   for(pos = 0; (pos + 16) <= len; pos += 16)
+   {
+      in    = _mm_loadu_si128((const __m128i *)&src[pos]);
+      hi    = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+      lo    = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+
+      // validates the block using the allowed high nibbles of each low nibble
+      mask  = _mm_shuffle_epi8(maskLUT, lo);
+      bits  = _mm_shuffle_epi8(bitposLUT, hi);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(mask, bits), _mm_setzero_si128())))
+         break;
+
+      // converts characters to 6-bit values, '/' shares a range with '+'
+      slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+      shift = _mm_shuffle_epi8(shiftLUT, hi);
+      shift = _mm_or_si128(_mm_andnot_si128(slash, shift),
+                           _mm_and_si128(slash, _mm_set1_epi8(16)));
+      in    = _mm_add_epi8(in, shift);
+
+      // packs 4 values of 6 bits into 3 bytes, 16 bytes are stored per block
+      out   = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+      out   = _mm_madd_epi16(out, _mm_set1_epi32(0x00011000));
+      out   = _mm_shuffle_epi8(out, pack);
+      _mm_storeu_si128((__m128i *)dst, out);
+      dst  += 12;
+   };
+
+   return(pos);
+}
+#endif
+
+
+size_t lk_base64_encode(const uint8_t * src, size_t len, char * dst)
+{
+   size_t    pos;
+   size_t    outLen;
 
    // base64 table
-   static uint8_t    b64t[64] =
+   static const char b64t[64] =
    {
       'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P',
       'Q','R','S','T','U','V','W','X','Y','Z','a','b','c','d','e','f',
@@ -293,57 +509,134 @@
       'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/'
    };
 
-   // retrieves input information
-   src    = [value bytes];
-   srcLen = [value length];
+   // encodes blocks of 12 bytes with SIMD instructions when available
+   pos    = 0;
+   outLen = 0;
+#ifdef LK_BASE64_SSSE3
+   if ((lk_base64_has_ssse3()))
+   {
+      pos    = lk_base64_encode_ssse3(src, len, dst);
+      outLen = (pos / 3) * 4;
+   };
+#endif
 
-   // calculates output size
-   encLen  = (srcLen * 4) / 3;  // size of raw b64 encoding w/padding
-   encLen += 1;                 // padding for '\0'
+   // encodes the remaining bytes 3 bytes at a time
+   for(; (pos + 3) <= len; pos += 3)
+   {
+      dst[outLen++] = b64t[  src[pos]   >> 2];
+      dst[outLen++] = b64t[((src[pos]   << 4) & 0x30) | (src[pos+1] >> 4)];
+      dst[outLen++] = b64t[((src[pos+1] << 2) & 0x3c) | (src[pos+2] >> 6)];
+      dst[outLen++] = b64t[  src[pos+2] & 0x3f];
+   };
+
+   // encodes the final partial group with padding
+   if (pos < len)
+   {
+      dst[outLen++] = b64t[src[pos] >> 2];
+      if ((pos + 1) < len)
+      {
+         dst[outLen++] = b64t[((src[pos] << 4) & 0x30) | (src[pos+1] >> 4)];
+         dst[outLen++] = b64t[(src[pos+1] << 2) & 0x3c];
+      } else {
+         dst[outLen++] = b64t[(src[pos] << 4) & 0x30];
+         dst[outLen++] = '=';
+      };
+      dst[outLen++] = '=';
+   };
+
+   return(outLen);
+}
 
-   // allocates memory for buffer
-   if (!(enc = calloc(encLen, 1)))
-      return(nil);
 
-   // encodes data 3 bytes at a time
-   buff = enc;
-   for(pos = 0; (pos +3) < srcLen; pos += 3)
+int lk_base64_decode(const char * src, size_t len, uint8_t * dst, size_t * dstLen)
+{
+   size_t         pos;
+   size_t         count;
+   size_t         pad;
+   size_t         outLen;
+   uint32_t       bits;
+   uint8_t        val;
+
+   // base64 reverse table, 0xfe is whitespace and 0xfd is padding
+   static const uint8_t b64r[256] =
    {
-      buff[0]  = b64t[ (src[pos]   >> 2) & 0x3f];
-      buff[1]  = b64t[((src[pos]   << 4) & 0x30) | ((src[pos+1] >> 4) & 0x0f)];
-      buff[2]  = b64t[((src[pos+1] << 2) & 0x3c) | ((src[pos+2] >> 6) & 0x03)];
-      buff[3]  = b64t[  src[pos+2]       & 0x3f];
-      buff    += 4; // jumps to next 4 bytes of output buffer
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xfe,0xfe,0xff,0xff,0xfe,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xfe,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x3e,0xff,0xff,0xff,0x3f,
+      0x34,0x35,0x36,0x37,0x38,0x39,0x3a,0x3b,0x3c,0x3d,0xff,0xff,0xff,0xfd,0xff,0xff,
+      0xff,0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,
+      0x0f,0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0xff,0xff,0xff,0xff,0xff,
+      0xff,0x1a,0x1b,0x1c,0x1d,0x1e,0x1f,0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,
+      0x29,0x2a,0x2b,0x2c,0x2d,0x2e,0x2f,0x30,0x31,0x32,0x33,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff
    };
 
-   // encodes padding
-   if (pos < srcLen)
+   // decodes blocks of 16 characters with SIMD instructions when available
+   pos    = 0;
+   outLen = 0;
+#ifdef LK_BASE64_SSSE3
+   if ((lk_base64_has_ssse3()))
    {
-      // copies last three bytes of input into tmp buffer with 0 padding
-      pad[0] = src[pos];
-      pad[1] = ((pos+1) < srcLen) ? src[pos+1] : 0;
-      pad[2] = ((pos+2) < srcLen) ? src[pos+2] : 0;
-
-      // encodes tmp buffer
-      buff[0]  = b64t[ (pad[0] >> 2) & 0x3f];
-      buff[1]  = b64t[((pad[0] << 4) & 0x30) | ((pad[1] >> 4) & 0x0f)];
-      buff[2]  = b64t[((pad[1] << 2) & 0x3c) | ((pad[2] >> 6) & 0x03)];
-      buff[3]  = b64t[  pad[2]       & 0x3f];
-
-      // calculates base64 padding
-      if (srcLen <= (pos+1))
-         buff[2] = '=';
-      if (srcLen <= (pos+2))
-         buff[3] = '=';
+      pos    = lk_base64_decode_ssse3(src, len, dst);
+      outLen = (pos / 4) * 3;
    };
+#endif
 
-   // creates NSString of base64
-   base64Value = [[NSString alloc] initWithUTF8String:enc];
+   // decodes the remaining characters, whitespace is ignored
+   bits  = 0;
+   count = 0;
+   pad   = 0;
+   for(; pos < len; pos++)
+   {
+      val = b64r[(uint8_t)src[pos]];
+      if (val == 0xfe)
+         continue;
+      if (val == 0xfd)
+      {
+         pad++;
+         continue;
+      };
+      if ( (val == 0xff) || ((pad)) )
+         return(-1);
+      bits = (bits << 6) | val;
+      if (++count == 4)
+      {
+         dst[outLen++] = (uint8_t)(bits >> 16);
+         dst[outLen++] = (uint8_t)(bits >>  8);
+         dst[outLen++] = (uint8_t)(bits);
+         bits  = 0;
+         count = 0;
+      };
+   };
 
-   // frees resources
-   free(enc);
+   // decodes the final partial group
+   switch(count)
+   {
+      case 1:
+      return(-1);
 
-   return([base64Value autorelease]);
+      case 2:
+      dst[outLen++] = (uint8_t)(bits >> 4);
+      break;
+
+      case 3:
+      dst[outLen++] = (uint8_t)(bits >> 10);
+      dst[outLen++] = (uint8_t)(bits >>  2);
+      break;
+
+      default:
+      break;
+   };
+   *dstLen = outLen;
+
+   return(0);
 }
 
 @end
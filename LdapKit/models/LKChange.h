@@ -0,0 +1,159 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKChange describes a single write operation submitted as part of a batch
+ *  of changes with [LKLdap ldapApplyChanges:windowSize:progressHandler:] or
+ *  read from an LDIF file by LKLdifReader.
+ *  The result of the operation is stored in the LKChange once the server has
+ *  responded.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/LKEnumerations.h>
+#import <LdapKit/models/LKMessage.h>
+
+
+@interface LKChange : NSObject
+{
+   // change information
+   LKLdapMessageType     changeType;
+   NSString            * dn;
+   NSArray             * modifications;
+   NSString            * relativeDN;
+   NSString            * superiorDN;
+   NSInteger             deleteOldRDN;
+
+   // result information
+   BOOL                  isCompleted;
+   NSInteger             errorCode;
+   NSString            * errorMessage;
+   NSString            * diagnosticMessage;
+}
+
+#pragma mark - Object Management Methods
+/// @name Object Management Methods
+
+/// Initialize a new add change.
+/// @param dn The DN of the entry to be added.
+/// @param attributes An array of LKMod objects containing the attributes and
+/// values of the entry.
+- (id) initAddWithDN:(NSString *)dn attributes:(NSArray *)attributes;
+
+/// Initialize a new delete change.
+/// @param dn The DN to be deleted.
+- (id) initDeleteWithDN:(NSString *)dn;
+
+/// Initialize a new modify change.
+/// @param dn The DN to be modified.
+/// @param mods An array of LKMod objects.
+- (id) initModifyWithDN:(NSString *)dn modifications:(NSArray *)mods;
+
+/// Initialize a new rename change.
+/// @param dn The DN to be renamed.
+/// @param newrdn The new relative DN of the entry.
+/// @param newSuperior The optional DN of the new parent entry.
+/// @param deleteOldRDN Set to a non-zero value to remove the old RDN values.
+- (id) initRenameWithDN:(NSString *)dn newRDN:(NSString *)newrdn
+       newSuperior:(NSString *)newSuperior deleteOldRDN:(NSInteger)deleteOldRDN;
+
+/// Creates a new add change.
+/// @param dn The DN of the entry to be added.
+/// @param attributes An array of LKMod objects containing the attributes and
+/// values of the entry.
++ (id) changeAddWithDN:(NSString *)dn attributes:(NSArray *)attributes;
+
+/// Creates a new delete change.
+/// @param dn The DN to be deleted.
++ (id) changeDeleteWithDN:(NSString *)dn;
+
+/// Creates a new modify change.
+/// @param dn The DN to be modified.
+/// @param mods An array of LKMod objects.
++ (id) changeModifyWithDN:(NSString *)dn modifications:(NSArray *)mods;
+
+/// Creates a new rename change.
+/// @param dn The DN to be renamed.
+/// @param newrdn The new relative DN of the entry.
+/// @param newSuperior The optional DN of the new parent entry.
+/// @param deleteOldRDN Set to a non-zero value to remove the old RDN values.
++ (id) changeRenameWithDN:(NSString *)dn newRDN:(NSString *)newrdn
+       newSuperior:(NSString *)newSuperior deleteOldRDN:(NSInteger)deleteOldRDN;
+
+
+#pragma mark - Change information
+/// @name Change information
+
+/// The type of operation, one of `LKLdapMessageTypeAdd`,
+/// `LKLdapMessageTypeDelete`, `LKLdapMessageTypeModify`, or
+/// `LKLdapMessageTypeRename`.
+@property (nonatomic, readonly) LKLdapMessageType     changeType;
+
+/// The DN of the entry being changed.
+@property (nonatomic, readonly) NSString            * dn;
+
+/// An array of LKMod objects for add and modify changes.
+@property (nonatomic, readonly) NSArray             * modifications;
+
+/// The new relative DN for rename changes.
+@property (nonatomic, readonly) NSString            * relativeDN;
+
+/// The DN of the new parent entry for rename changes.
+@property (nonatomic, readonly) NSString            * superiorDN;
+
+/// Indicates whether the old RDN values are removed by rename changes.
+@property (nonatomic, readonly) NSInteger             deleteOldRDN;
+
+
+#pragma mark - Results
+/// @name Results
+
+/// Indicates whether a result has been recorded for the change.
+@property (atomic, readonly)    BOOL                  isCompleted;
+
+/// The numeric value of the result returned by the server.
+///
+/// See the man page for ldap_error(3) for descriptions of valid error
+/// codes.
+@property (atomic, readonly)    NSInteger             errorCode;
+
+/// A human readable error message.
+@property (nonatomic, readonly) NSString            * errorMessage;
+
+/// Additional diagnostic information if available.
+@property (nonatomic, readonly) NSString            * diagnosticMessage;
+
+/// Determines if the change was applied successfully.
+@property (nonatomic, readonly) BOOL                  isSuccessful;
+
+@end
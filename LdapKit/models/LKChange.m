@@ -0,0 +1,250 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKChange.m - a single write operation within a batch
+ */
+#import "LKChange.h"
+#import "LKChangeCategory.h"
+
+#import "LKMod.h"
+
+
+@implementation LKChange
+
+// change information
+@synthesize changeType;
+@synthesize deleteOldRDN;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // change information
+   [dn            release];
+   [modifications release];
+   [relativeDN    release];
+   [superiorDN    release];
+
+   // result information
+   [errorMessage      release];
+   [diagnosticMessage release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) initAddWithDN:(NSString *)entryDN attributes:(NSArray *)attributes
+{
+   NSUInteger pos;
+   NSAssert((entryDN != nil), @"dn must not be nil");
+   NSAssert((attributes != nil), @"attributes must not be nil");
+   for(pos = 0; pos < [attributes count]; pos++)
+      NSAssert([[attributes objectAtIndex:pos] isKindOfClass:[LKMod class]],
+         @"attributes must only contain LKMod objects");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   changeType    = LKLdapMessageTypeAdd;
+   dn            = [entryDN copy];
+   modifications = [[NSArray alloc] initWithArray:attributes];
+
+   return(self);
+}
+
+
+- (id) initDeleteWithDN:(NSString *)entryDN
+{
+   NSAssert((entryDN != nil), @"dn must not be nil");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   changeType = LKLdapMessageTypeDelete;
+   dn         = [entryDN copy];
+
+   return(self);
+}
+
+
+- (id) initModifyWithDN:(NSString *)entryDN modifications:(NSArray *)mods
+{
+   NSUInteger pos;
+   NSAssert((entryDN != nil), @"dn must not be nil");
+   NSAssert((mods != nil), @"mods must not be nil");
+   for(pos = 0; pos < [mods count]; pos++)
+      NSAssert([[mods objectAtIndex:pos] isKindOfClass:[LKMod class]],
+         @"mods must only contain LKMod objects");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   changeType    = LKLdapMessageTypeModify;
+   dn            = [entryDN copy];
+   modifications = [[NSArray alloc] initWithArray:mods];
+
+   return(self);
+}
+
+
+- (id) initRenameWithDN:(NSString *)entryDN newRDN:(NSString *)newrdn
+       newSuperior:(NSString *)superior deleteOldRDN:(NSInteger)deleteoldrdn
+{
+   NSAssert((entryDN != nil), @"dn must not be nil");
+   NSAssert((newrdn != nil), @"newrdn must not be nil");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   changeType   = LKLdapMessageTypeRename;
+   dn           = [entryDN copy];
+   relativeDN   = [newrdn copy];
+   superiorDN   = [superior copy];
+   deleteOldRDN = deleteoldrdn;
+
+   return(self);
+}
+
+
++ (id) changeAddWithDN:(NSString *)entryDN attributes:(NSArray *)attributes
+{
+   return([[[LKChange alloc] initAddWithDN:entryDN attributes:attributes] autorelease]);
+}
+
+
++ (id) changeDeleteWithDN:(NSString *)entryDN
+{
+   return([[[LKChange alloc] initDeleteWithDN:entryDN] autorelease]);
+}
+
+
++ (id) changeModifyWithDN:(NSString *)entryDN modifications:(NSArray *)mods
+{
+   return([[[LKChange alloc] initModifyWithDN:entryDN modifications:mods] autorelease]);
+}
+
+
++ (id) changeRenameWithDN:(NSString *)entryDN newRDN:(NSString *)newrdn
+       newSuperior:(NSString *)superior deleteOldRDN:(NSInteger)deleteoldrdn
+{
+   return([[[LKChange alloc] initRenameWithDN:entryDN newRDN:newrdn
+            newSuperior:superior deleteOldRDN:deleteoldrdn] autorelease]);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSString *) dn
+{
+   return([[dn retain] autorelease]);
+}
+
+
+- (NSArray *) modifications
+{
+   return([[modifications retain] autorelease]);
+}
+
+
+- (NSString *) relativeDN
+{
+   return([[relativeDN retain] autorelease]);
+}
+
+
+- (NSString *) superiorDN
+{
+   return([[superiorDN retain] autorelease]);
+}
+
+
+- (BOOL) isCompleted
+{
+   @synchronized(self)
+   {
+      return(isCompleted);
+   };
+}
+
+
+- (NSInteger) errorCode
+{
+   @synchronized(self)
+   {
+      return(errorCode);
+   };
+}
+
+
+- (NSString *) errorMessage
+{
+   @synchronized(self)
+   {
+      return([[errorMessage retain] autorelease]);
+   };
+}
+
+
+- (NSString *) diagnosticMessage
+{
+   @synchronized(self)
+   {
+      return([[diagnosticMessage retain] autorelease]);
+   };
+}
+
+
+- (BOOL) isSuccessful
+{
+   return(self.errorCode == LDAP_SUCCESS);
+}
+
+
+#pragma mark - Results
+
+- (void) setResultCode:(NSInteger)code message:(NSString *)message
+         diagnosticMessage:(NSString *)diagnostic
+{
+   @synchronized(self)
+   {
+      [errorMessage      release];
+      [diagnosticMessage release];
+      isCompleted       = YES;
+      errorCode         = code;
+      errorMessage      = [message copy];
+      diagnosticMessage = [diagnostic copy];
+   };
+   return;
+}
+
+@end
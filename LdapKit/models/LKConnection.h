@@ -0,0 +1,163 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKConnection wraps a single OpenLDAP handle. LKLdap keeps a pool of
+ *  LKConnection objects and lends one to each LKMessage while the message
+ *  is executing.
+ *
+ *  All access to the underlying `LDAP *` handle must be performed while
+ *  holding the lock of the LKConnection object (`@synchronized(connection)`).
+ */
+
+#import <Foundation/Foundation.h>
+#import <ldap.h>
+#import <LdapKit/LKEnumerations.h>
+
+@class LKMessage;
+@class LKServer;
+
+@interface LKConnection : NSObject
+{
+   // connection state
+   LDAP                   * ld;
+   BOOL                     isConnected;
+   NSUInteger               generation;
+   NSUInteger               borrowCount;
+   NSTimeInterval           lastUsed;
+   NSTimeInterval           lastActivity;
+   LKServer               * server;
+
+   // bind state
+   NSString               * bindURI;
+   LKLdapEncryptionScheme   bindEncryptionScheme;
+   LKLdapBindMethod         bindMethod;
+
+   // dispatcher state
+   int                      dispatchPipe[2];
+   NSUInteger               dispatchThreads;
+   NSCondition            * dispatchCondition;
+   NSMutableDictionary    * pendingMessages;
+}
+
+#pragma mark - Connection state
+/// @name Connection state
+
+/// The OpenLDAP handle, or `NULL` if the connection has not been established.
+@property (nonatomic, assign)   LDAP                   * ld;
+
+/// Indicates whether the handle is bound to the directory server.
+@property (nonatomic, assign)   BOOL                     isConnected;
+
+/// The pool generation the connection was created in. Connections from an
+/// older generation are closed when they are returned to the pool.
+@property (nonatomic, assign)   NSUInteger               generation;
+
+/// The number of messages currently borrowing the connection. The value is
+/// only accessed by LKLdap while holding the lock of the pool.
+@property (nonatomic, assign)   NSUInteger               borrowCount;
+
+/// The time (seconds since the reference date) the connection was last
+/// returned to the pool.
+@property (nonatomic, assign)   NSTimeInterval           lastUsed;
+
+/// The time (seconds since the reference date) a response was last received
+/// from the directory server. A connection which has been active recently is
+/// assumed to be alive without probing the server.
+@property (nonatomic, assign)   NSTimeInterval           lastActivity;
+
+/// The server the handle connects to, or `nil` if the connection uses
+/// [LKLdap ldapURI]. The server is assigned when the connection is added to
+/// the pool and does not change.
+@property (nonatomic, retain)   LKServer               * server;
+
+/// The URI the handle was opened with.
+@property (nonatomic, copy)     NSString               * bindURI;
+
+/// The encryption scheme the handle was opened with.
+@property (nonatomic, assign)   LKLdapEncryptionScheme   bindEncryptionScheme;
+
+/// The method used to authenticate the handle. A handle authenticated with a
+/// simple or anonymous bind may be authenticated again without reopening the
+/// connection, as long as its URI and encryption scheme have not changed.
+@property (nonatomic, assign)   LKLdapBindMethod         bindMethod;
+
+/// Unbinds the handle from the directory server and resets the connection.
+///
+/// Messages waiting on the dispatcher receive `LDAP_UNAVAILABLE`.
+- (void) unbind;
+
+
+#pragma mark - Dispatcher
+/// @name Dispatcher
+
+/// Indicates whether a dispatcher thread is reading responses for the handle.
+@property (nonatomic, readonly) BOOL                     isDispatching;
+
+/// Starts a thread which reads every response received on the handle and
+/// delivers each response to the message which registered its message ID.
+/// Once the dispatcher is running, `ldap_result()` must not be called
+/// by any other thread.
+///
+/// The thread is named `LdapKit dispatcher` and retains the connection
+/// until it exits, so the owner of the connection must call unbind to stop it.
+- (BOOL) startDispatcher;
+
+/// Stops the dispatcher if no message is waiting for a response.
+///
+/// Once the dispatcher has stopped, responses are read with `ldap_result()`
+/// by the message using the connection. Connections which are not shared
+/// by several messages are returned to the pool without a dispatcher.
+/// @return Returns `YES` if the dispatcher is not running.
+- (BOOL) stopDispatcherIfIdle;
+
+/// Waits until the dispatcher threads stopped by unbind or
+/// stopDispatcherIfIdle have exited.
+///
+/// This must not be called while holding the lock of the connection. A
+/// dispatcher thread does not wait for itself.
+- (void) waitForDispatcher;
+
+/// Routes responses for the message ID to the message. The registration is
+/// removed when the final response is delivered.
+///
+/// This must be called while holding the lock of the connection used to send
+/// the request, otherwise the dispatcher may read the response before the
+/// message ID is registered.
+- (BOOL) registerMessage:(LKMessage *)message forMessageID:(int)msgid;
+
+/// Stops routing responses for the message ID. Responses received later are
+/// discarded.
+- (void) unregisterMessageID:(int)msgid;
+
+@end
@@ -0,0 +1,456 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKConnection.m - wraps a single OpenLDAP handle
+ */
+#import "LKConnection.h"
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#import "LKMessageCategory.h"
+
+
+// name of the dispatcher threads
+#define LK_DISPATCHER_THREAD_NAME @"LdapKit dispatcher"
+
+// thread dictionary key of the connection read by a dispatcher thread
+#define LK_DISPATCHER_THREAD_KEY  @"LKConnection"
+
+
+@interface LKConnection ()
+
+/// @name Dispatcher
+- (void) dispatchMessages:(NSNumber *)descriptor;
+- (NSArray *) stopDispatcher;
+
+@end
+
+
+@implementation LKConnection
+
+// connection state
+@synthesize generation;
+@synthesize borrowCount;
+@synthesize server;
+@synthesize bindURI;
+@synthesize bindEncryptionScheme;
+@synthesize bindMethod;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // unbind from LDAP server
+   if ((ld))
+      ldap_unbind_ext(ld, NULL, NULL);
+   ld = NULL;
+   [server release];
+
+   // bind state
+   [bindURI release];
+
+   // dispatcher state
+   if (dispatchPipe[1] != -1)
+      close(dispatchPipe[1]);
+   [dispatchCondition release];
+   [pendingMessages   release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   // initialize super
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // dispatcher state
+   dispatchPipe[0]   = -1;
+   dispatchPipe[1]   = -1;
+   dispatchCondition = [[NSCondition alloc] init];
+
+   return(self);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (BOOL) isConnected
+{
+   @synchronized(self)
+   {
+      return(isConnected);
+   };
+}
+- (void) setIsConnected:(BOOL)connected
+{
+   @synchronized(self)
+   {
+      isConnected = connected;
+   };
+   return;
+}
+
+
+- (BOOL) isDispatching
+{
+   @synchronized(self)
+   {
+      return(dispatchPipe[0] != -1);
+   };
+}
+
+
+- (NSTimeInterval) lastUsed
+{
+   @synchronized(self)
+   {
+      return(lastUsed);
+   };
+}
+- (void) setLastUsed:(NSTimeInterval)interval
+{
+   @synchronized(self)
+   {
+      lastUsed = interval;
+   };
+   return;
+}
+
+
+- (NSTimeInterval) lastActivity
+{
+   @synchronized(self)
+   {
+      return(lastActivity);
+   };
+}
+- (void) setLastActivity:(NSTimeInterval)interval
+{
+   @synchronized(self)
+   {
+      lastActivity = interval;
+   };
+   return;
+}
+
+
+- (LDAP *) ld
+{
+   @synchronized(self)
+   {
+      return(ld);
+   };
+}
+- (void) setLd:(LDAP *)handle
+{
+   @synchronized(self)
+   {
+      ld = handle;
+   };
+   return;
+}
+
+
+#pragma mark - Connection state
+
+- (void) unbind
+{
+   NSArray   * waiting;
+   LKMessage * message;
+
+   @synchronized(self)
+   {
+      waiting = [self stopDispatcher];
+      if ((ld))
+         ldap_unbind_ext(ld, NULL, NULL);
+      ld          = NULL;
+      isConnected = NO;
+   };
+
+   // fails requests which were still waiting for a response
+   for(message in waiting)
+      [message deliverErrorCode:LDAP_UNAVAILABLE];
+
+   return;
+}
+
+
+#pragma mark - Dispatcher
+
+- (void) dispatchMessages:(NSNumber *)descriptor
+{
+   NSAutoreleasePool * pool;
+   NSArray           * waiting;
+   NSNumber          * key;
+   LKMessage         * message;
+   LDAPMessage       * res;
+   BOOL                isRunning;
+   int                 fd;
+   int                 sd;
+   int                 rc;
+   int                 err;
+   struct timeval      zero;
+   struct pollfd       fds[2];
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   // identifies the thread to waitForDispatcher and to debuggers
+   [[NSThread currentThread] setName:LK_DISPATCHER_THREAD_NAME];
+   [[[NSThread currentThread] threadDictionary] setObject:[NSValue valueWithNonretainedObject:self]
+                                                forKey:LK_DISPATCHER_THREAD_KEY];
+
+   // the read end of the pipe identifies this dispatcher, the connection
+   // closes the write end to stop it
+   fd        = [descriptor intValue];
+   waiting   = nil;
+   err       = LDAP_SERVER_DOWN;
+   isRunning = YES;
+
+   // ldap_result() is only used to drain data already received
+   zero.tv_sec  = 0;
+   zero.tv_usec = 0;
+
+   while((isRunning))
+   {
+      res     = NULL;
+      message = nil;
+      sd      = -1;
+      rc      = 0;
+
+      // reads the next response which has already been received
+      @synchronized(self)
+      {
+         if (dispatchPipe[0] != fd)
+            isRunning = NO;
+         else if ((rc = ldap_result(ld, LDAP_RES_ANY, LDAP_MSG_ONE, &zero, &res)) == -1)
+         {
+            ldap_get_option(ld, LDAP_OPT_RESULT_CODE, &err);
+            waiting     = [self stopDispatcher];
+            isConnected = NO;
+            isRunning   = NO;
+         }
+         else if (rc == 0)
+            ldap_get_option(ld, LDAP_OPT_DESC, &sd);
+         else
+         {
+            lastActivity = [NSDate timeIntervalSinceReferenceDate];
+            key          = [[NSNumber alloc] initWithInt:ldap_msgid(res)];
+            message      = [[pendingMessages objectForKey:key] retain];
+            switch(rc)
+            {
+               case LDAP_RES_SEARCH_ENTRY:
+               case LDAP_RES_SEARCH_REFERENCE:
+               case LDAP_RES_INTERMEDIATE:
+               break;
+
+               default:
+               [pendingMessages removeObjectForKey:key];
+               break;
+            };
+            [key release];
+         };
+      };
+
+      // routes the response to the message which sent the request
+      if (rc > 0)
+      {
+         if ((message))
+            [message deliverResult:res];
+         else
+            ldap_msgfree(res);
+         [message release];
+         continue;
+      };
+      if (!(isRunning))
+         continue;
+
+      // waits for the socket to become readable or for the dispatcher to be stopped
+      fds[0].fd      = sd;
+      fds[0].events  = POLLIN;
+      fds[0].revents = 0;
+      fds[1].fd      = fd;
+      fds[1].events  = POLLIN;
+      fds[1].revents = 0;
+      rc = ((sd == -1)) ? -1 : poll(fds, 2, -1);
+      if ((rc == -1) && ((sd == -1) || (errno != EINTR)))
+      {
+         @synchronized(self)
+         {
+            if (dispatchPipe[0] == fd)
+            {
+               waiting     = [self stopDispatcher];
+               isConnected = NO;
+            };
+         };
+         err       = LDAP_SERVER_DOWN;
+         isRunning = NO;
+      };
+   };
+
+   // fails requests which were still waiting for a response
+   for(message in waiting)
+      [message deliverErrorCode:err];
+
+   close(fd);
+
+   [[[NSThread currentThread] threadDictionary] removeObjectForKey:LK_DISPATCHER_THREAD_KEY];
+
+   [pool release];
+
+   // allows waitForDispatcher to return
+   [dispatchCondition lock];
+   dispatchThreads--;
+   [dispatchCondition broadcast];
+   [dispatchCondition unlock];
+
+   return;
+}
+
+
+- (BOOL) registerMessage:(LKMessage *)message forMessageID:(int)msgid
+{
+   @synchronized(self)
+   {
+      if (dispatchPipe[0] == -1)
+         return(NO);
+      [pendingMessages setObject:message forKey:[NSNumber numberWithInt:msgid]];
+   };
+   return(YES);
+}
+
+
+- (BOOL) startDispatcher
+{
+   int x;
+
+   @synchronized(self)
+   {
+      if (dispatchPipe[0] != -1)
+         return(YES);
+      if (!(ld))
+         return(NO);
+
+      if (pipe(dispatchPipe) == -1)
+      {
+         dispatchPipe[0] = -1;
+         dispatchPipe[1] = -1;
+         return(NO);
+      };
+      for(x = 0; x < 2; x++)
+         fcntl(dispatchPipe[x], F_SETFD, FD_CLOEXEC);
+
+      if (!(pendingMessages))
+         pendingMessages = [[NSMutableDictionary alloc] initWithCapacity:16];
+
+      [dispatchCondition lock];
+      dispatchThreads++;
+      [dispatchCondition unlock];
+
+      [NSThread detachNewThreadSelector:@selector(dispatchMessages:) toTarget:self
+                withObject:[NSNumber numberWithInt:dispatchPipe[0]]];
+   };
+
+   return(YES);
+}
+
+
+- (NSArray *) stopDispatcher
+{
+   NSArray * waiting;
+
+   // must be called while holding the lock of the connection
+   if (dispatchPipe[0] == -1)
+      return(nil);
+
+   // closing the write end of the pipe wakes the dispatcher
+   close(dispatchPipe[1]);
+   dispatchPipe[0] = -1;
+   dispatchPipe[1] = -1;
+
+   waiting = [pendingMessages allValues];
+   [pendingMessages removeAllObjects];
+
+   return(waiting);
+}
+
+
+- (BOOL) stopDispatcherIfIdle
+{
+   @synchronized(self)
+   {
+      if (dispatchPipe[0] == -1)
+         return(YES);
+      if ([pendingMessages count] > 0)
+         return(NO);
+      [self stopDispatcher];
+   };
+   return(YES);
+}
+
+
+- (void) unregisterMessageID:(int)msgid
+{
+   @synchronized(self)
+   {
+      [pendingMessages removeObjectForKey:[NSNumber numberWithInt:msgid]];
+   };
+   return;
+}
+
+
+- (void) waitForDispatcher
+{
+   NSValue    * current;
+   NSUInteger   running;
+
+   // a dispatcher which unbinds its own connection cannot wait for itself
+   current = [[[NSThread currentThread] threadDictionary] objectForKey:LK_DISPATCHER_THREAD_KEY];
+   running = ([current nonretainedObjectValue] == self) ? 1 : 0;
+
+   [dispatchCondition lock];
+   while(dispatchThreads > running)
+      [dispatchCondition wait];
+   [dispatchCondition unlock];
+
+   return;
+}
+
+@end
@@ -34,17 +34,34 @@
 /**
  *  LKEntry objects contain the distinguished name, attributes, and values of
  *  an LDAP entry.
+ *
+ *  Entries returned by searches reference the BER encoded search result
+ *  received from the server. The DN, attribute names, and values are only
+ *  converted to Objective-C objects when they are accessed. Attribute names
+ *  are shared by the entries of a search and values are stored in slots
+ *  indexed by the identifier of the attribute name.
  */
 
 #import <Foundation/Foundation.h>
 #import <ldap.h>
 
+@class LKAttributeTable;
+
 @interface LKEntry : NSObject
 {
    // entry information
    NSString            * dn;
    NSMutableDictionary * entry;
 
+   // BER encoded entry information
+   LDAPMessage         * berMessage;
+   struct berval         berDn;
+   LKAttributeTable    * berAttributeTable;
+   NSUInteger          * berAttributeIDs;
+   NSUInteger            berAttributeCount;
+   BerVarray           * berSlots;
+   NSUInteger            berSlotCount;
+
    // derived data
    NSArray             * attributes;
 }
@@ -37,7 +37,11 @@
 #import "LKEntry.h"
 #import "LKEntryCategory.h"
 
+#include <objc/runtime.h>
+
+#import "LKAttributeTable.h"
 #import "LKBerValue.h"
+#import "LKBerValueCategory.h"
 
 @implementation LKEntry
 
@@ -45,10 +49,21 @@
 
 - (void) dealloc
 {
+   NSUInteger pos;
+
    // entry information
    [dn     release];
    [entry  release];
 
+   // BER encoded entry information
+   for(pos = 0; pos < berSlotCount; pos++)
+      ber_memfree(berSlots[pos]);
+   free(berSlots);
+   free(berAttributeIDs);
+   [berAttributeTable release];
+   if ((berMessage))
+      ldap_msgfree(berMessage);
+
    // derived data
    [attributes release];
 
@@ -69,14 +84,98 @@
 }
 
 
+- (id) initWithMessage:(LDAPMessage *)msg ld:(LDAP *)ld
+       attributeTable:(LKAttributeTable *)table
+{
+   int             err;
+   NSUInteger      size;
+   NSUInteger      ident;
+   NSUInteger      slots;
+   void          * ptr;
+   BerElement    * ber;
+   struct berval   name;
+   BerVarray       vals;
+
+   NSAssert((msg   != NULL), @"msg must not be NULL");
+   NSAssert((table != nil),  @"table must not be nil");
+   if ((self = [super init]) == nil)
+   {
+      ldap_msgfree(msg);
+      return(self);
+   };
+
+   // the entry owns the message, the DN and values are references into the
+   // BER buffer of the message
+   berMessage        = msg;
+   berAttributeTable = [table retain];
+   if (ldap_get_dn_ber(ld, msg, &ber, &berDn) != LDAP_SUCCESS)
+      return(self);
+
+   // stores the values of each attribute in the slot of the attribute name
+   size = 0;
+   vals = NULL;
+   err  = ldap_get_attribute_ber(ld, msg, ber, &name, &vals);
+   while ((err == LDAP_SUCCESS) && ((name.bv_val)))
+   {
+      ident = [table identifierForBerValue:&name];
+      if ((ident == NSNotFound) || ((ident < berSlotCount) && ((berSlots[ident]))))
+      {
+         ber_memfree(vals);
+         vals = NULL;
+         err  = ldap_get_attribute_ber(ld, msg, ber, &name, &vals);
+         continue;
+      };
+      if (ident >= berSlotCount)
+      {
+         slots = [table count];
+         if ((ptr = realloc(berSlots, sizeof(BerVarray) * slots)) == NULL)
+         {
+            ber_memfree(vals);
+            break;
+         };
+         berSlots = ptr;
+         memset(&berSlots[berSlotCount], 0, sizeof(BerVarray) * (slots - berSlotCount));
+         berSlotCount = slots;
+      };
+      if (berAttributeCount >= size)
+      {
+         size = ((size)) ? (size * 2) : 16;
+         if ((ptr = realloc(berAttributeIDs, sizeof(NSUInteger) * size)) == NULL)
+         {
+            ber_memfree(vals);
+            break;
+         };
+         berAttributeIDs = ptr;
+      };
+      berSlots[ident] = vals;
+      berAttributeIDs[berAttributeCount++] = ident;
+      vals = NULL;
+      err  = ldap_get_attribute_ber(ld, msg, ber, &name, &vals);
+   };
+   ber_free(ber, 0);
+
+   return(self);
+}
+
+
 #pragma mark - Getter/Setter methods
 
 - (NSArray *) attributes
 {
    NSAutoreleasePool * pool;
+   NSMutableArray    * names;
+   NSUInteger          pos;
    @synchronized(self)
    {
-      if (!(attributes))
+      // attribute names are shared with the other entries of the search
+      if ( (!(attributes)) && ((berMessage)) )
+      {
+         names = [[NSMutableArray alloc] initWithCapacity:berAttributeCount];
+         for(pos = 0; pos < berAttributeCount; pos++)
+            [names addObject:[berAttributeTable nameForIdentifier:berAttributeIDs[pos]]];
+         attributes = names;
+      }
+      else if (!(attributes))
       {
          pool = [[NSAutoreleasePool alloc] init];
          attributes = [[entry allKeys] retain];
@@ -89,17 +188,129 @@
 
 - (NSString *) dn
 {
-   return([[dn retain] autorelease]);
+   @synchronized(self)
+   {
+      if ( (!(dn)) && ((berMessage)) )
+      {
+         if ((berDn.bv_val))
+            dn = [[NSString alloc] initWithBytes:berDn.bv_val length:berDn.bv_len
+                  encoding:NSUTF8StringEncoding];
+         if (!(dn))
+            dn = [[NSString alloc] init];
+      };
+      return([[dn retain] autorelease]);
+   };
 }
 
 
 #pragma mark - entry information
 
+- (LKAttributeTable *) berAttributeTable
+{
+   // the table and slots of an entry backed by a message are not modified
+   // after the entry is initialized
+   return(berAttributeTable);
+}
+
+
+- (NSUInteger) berSize
+{
+   NSUInteger     size;
+   NSUInteger     pos;
+   BerVarray      vals;
+   NSArray      * values;
+   LKBerValue   * value;
+
+   @synchronized(self)
+   {
+      size = class_getInstanceSize([self class]) + (sizeof(BerVarray) * berSlotCount) +
+             (sizeof(NSUInteger) * berAttributeCount);
+
+      // values of entries received from a search reference the BER buffer
+      if ((berMessage))
+      {
+         size += berDn.bv_len;
+         for(pos = 0; pos < berSlotCount; pos++)
+            for(vals = berSlots[pos]; ((vals)) && ((vals->bv_val)); vals++)
+               size += vals->bv_len + sizeof(struct berval);
+         return(size);
+      };
+
+      size += [dn lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+      for(values in [entry allValues])
+         for(value in values)
+            size += value.bv_len + sizeof(struct berval);
+   };
+
+   return(size);
+}
+
+
+- (NSUInteger) berValueCountWithLength:(NSUInteger *)lengthp
+{
+   NSUInteger     count;
+   NSUInteger     pos;
+   BerVarray      vals;
+
+   // counts the values and the bytes of the DN and values in the BER buffer
+   count    = 0;
+   *lengthp = berDn.bv_len;
+   for(pos = 0; pos < berSlotCount; pos++)
+   {
+      for(vals = berSlots[pos]; ((vals)) && ((vals->bv_val)); vals++)
+      {
+         count++;
+         *lengthp += vals->bv_len;
+      };
+   };
+
+   return(count);
+}
+
+
+- (BerVarray) berValuesForIdentifier:(NSUInteger)identifier
+{
+   if (identifier >= berSlotCount)
+      return(NULL);
+   return(berSlots[identifier]);
+}
+
+
 - (NSArray *) valuesForAttribute:(NSString *)attribute
 {
+   NSUInteger    ident;
+   NSUInteger    pos;
+   NSUInteger    count;
+   BerVarray     vals;
+   id          * values;
+   NSArray     * array;
+
    @synchronized(self)
    {
-      return([[[entry objectForKey:attribute] retain] autorelease]);
+      if (!(berMessage))
+         return([[[entry objectForKey:attribute] retain] autorelease]);
+
+      // locates the slot of the attribute
+      ident = [berAttributeTable identifierForName:attribute];
+      if ( (ident == NSNotFound) || (ident >= berSlotCount) || (!(berSlots[ident])) )
+         return(nil);
+
+      // creates values which reference the BER buffer instead of copying it
+      vals  = berSlots[ident];
+      count = 0;
+      if ((vals))
+         while ((vals[count].bv_val))
+            count++;
+      if ((values = malloc(sizeof(id) * (((count)) ? count : 1))) == NULL)
+         return(nil);
+      for(pos = 0; pos < count; pos++)
+         values[pos] = [[LKBerValue alloc] initWithBerValue:&vals[pos] owner:self];
+      array = [[NSArray alloc] initWithObjects:values count:count];
+      for(pos = 0; pos < count; pos++)
+         [values[pos] release];
+      free(values);
+
+      return([array autorelease]);
    };
 }
 
@@ -0,0 +1,147 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKEntryWriter writes LDAP entries to a file descriptor as LDIF (RFC 2849)
+ *  or as JSON with one entry per line.
+ *
+ *  Output is collected in a buffer and written when the buffer is full, when
+ *  flush is called, or when the writer is released. Searches which are given
+ *  a writer pass each entry to the writer as it is received and the entry is
+ *  written from the BER encoded message without creating an LKEntry.
+ *
+ *  LDIF values which are not safe strings are base64 encoded. JSON entries
+ *  are written as `{"dn":"...","attributes":{"cn":["..."]}}`, and values which
+ *  are not valid UTF-8 are written as `{"base64":"..."}`.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/LKEnumerations.h>
+
+
+#pragma mark LDAP entry writer format
+enum ldap_kit_entry_writer_format
+{
+   LKEntryWriterFormatLDIF     = 0x01,
+   LKEntryWriterFormatJSON     = 0x02
+};
+typedef enum ldap_kit_entry_writer_format LKEntryWriterFormat;
+
+
+@class LKEntry;
+
+@interface LKEntryWriter : NSObject
+{
+   // file information
+   NSString            * path;
+   int                   fileDescriptor;
+   BOOL                  ownsDescriptor;
+   LKEntryWriterFormat   format;
+
+   // write buffer
+   char                * buffer;
+   size_t                bufferSize;
+   size_t                bufferLen;
+   size_t                column;
+   BOOL                  isFirstAttribute;
+
+   // writer state
+   NSUInteger            entryCount;
+   NSString            * errorMessage;
+}
+
+#pragma mark - Object Management Methods
+/// @name Object Management Methods
+
+/// Initialize a new writer which creates or truncates a file.
+///
+/// If the file cannot be opened, the error is reported by `errorMessage` and
+/// entries are discarded.
+/// @param path The path of the file.
+/// @param format The format of the output, either `LKEntryWriterFormatLDIF`
+/// or `LKEntryWriterFormatJSON`.
+- (id) initWithPath:(NSString *)path format:(LKEntryWriterFormat)format;
+
+/// Initialize a new writer for an open file descriptor.
+///
+/// The file descriptor is not closed by the writer.
+/// @param fd The file descriptor to which entries are written.
+/// @param format The format of the output, either `LKEntryWriterFormatLDIF`
+/// or `LKEntryWriterFormatJSON`.
+- (id) initWithFileDescriptor:(int)fd format:(LKEntryWriterFormat)format;
+
+/// Creates a new writer which creates or truncates a file.
+/// @param path The path of the file.
+/// @param format The format of the output.
++ (id) writerWithPath:(NSString *)path format:(LKEntryWriterFormat)format;
+
+/// Creates a new writer for an open file descriptor.
+/// @param fd The file descriptor to which entries are written.
+/// @param format The format of the output.
++ (id) writerWithFileDescriptor:(int)fd format:(LKEntryWriterFormat)format;
+
+
+#pragma mark - Writer information
+/// @name Writer information
+
+/// The path of the file, or `nil` if the writer was initialized with a file
+/// descriptor.
+@property (nonatomic, readonly) NSString            * path;
+
+/// The file descriptor to which entries are written.
+@property (nonatomic, readonly) int                   fileDescriptor;
+
+/// The format of the output.
+@property (nonatomic, readonly) LKEntryWriterFormat   format;
+
+/// The number of entries written.
+@property (atomic, readonly)    NSUInteger            entryCount;
+
+/// A description of the error which stopped the writer, or `nil` if no error
+/// has occurred.
+@property (atomic, readonly)    NSString            * errorMessage;
+
+
+#pragma mark - Writing entries
+/// @name Writing entries
+
+/// Writes an entry.
+/// @param entry The LKEntry to write.
+/// @return Returns `YES` if the entry was written or buffered.
+- (BOOL) writeEntry:(LKEntry *)entry;
+
+/// Writes buffered output to the file descriptor.
+/// @return Returns `YES` if the buffered output was written.
+- (BOOL) flush;
+
+@end
@@ -0,0 +1,953 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKEntryWriter.m - buffered LDIF and JSON output of LDAP entries
+ */
+#import "LKEntryWriter.h"
+#import "LKEntryWriterCategory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#import "LKBerValue.h"
+#import "LKBerValueCategory.h"
+#import "LKEntry.h"
+
+
+#define LK_WRITER_BUFFER_SIZE 65536
+#define LK_LDIF_LINE_LENGTH   76
+
+
+@interface LKEntryWriter ()
+
+/// @name Buffer management
+- (void) appendBase64:(struct berval *)value folded:(BOOL)folded;
+- (void) appendBytes:(const char *)bytes length:(size_t)len;
+- (void) appendFoldedBytes:(const char *)bytes length:(size_t)len;
+- (void) appendJSONString:(const char *)bytes length:(size_t)len;
+- (void) appendLDIFName:(struct berval *)name value:(struct berval *)value;
+- (BOOL) writeBytes:(const char *)bytes length:(size_t)len;
+
+/// @name Encoding entries
+- (void) beginEntry:(struct berval *)dn;
+- (void) endEntry;
+- (BOOL) isSafeString:(struct berval *)value;
+- (BOOL) isUTF8String:(struct berval *)value;
+- (void) writeAttribute:(struct berval *)name values:(BerVarray)vals;
+
+/// @name Errors
+- (void) setErrorWithCode:(int)err;
+
+@end
+
+
+@implementation LKEntryWriter
+
+// writer information
+@synthesize fileDescriptor;
+@synthesize format;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // writes buffered output
+   [self flush];
+
+   // file information
+   [path release];
+   if ( ((ownsDescriptor)) && (fileDescriptor != -1) )
+      close(fileDescriptor);
+
+   // write buffer
+   free(buffer);
+
+   // writer state
+   [errorMessage release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) initWithPath:(NSString *)filePath format:(LKEntryWriterFormat)outputFormat
+{
+   int fd;
+   int err;
+   NSAssert((filePath != nil), @"path must not be nil");
+   fd  = open([filePath fileSystemRepresentation], O_WRONLY|O_CREAT|O_TRUNC, 0644);
+   err = errno;
+   if ((self = [self initWithFileDescriptor:fd format:outputFormat]) == nil)
+   {
+      if (fd != -1)
+         close(fd);
+      return(self);
+   };
+
+   // file information
+   path           = [filePath copy];
+   ownsDescriptor = YES;
+   if (fd == -1)
+   {
+      [errorMessage release];
+      errorMessage = nil;
+      [self setErrorWithCode:err];
+   };
+
+   return(self);
+}
+
+
+- (id) initWithFileDescriptor:(int)fd format:(LKEntryWriterFormat)outputFormat
+{
+   NSAssert( ( (outputFormat == LKEntryWriterFormatLDIF) ||
+               (outputFormat == LKEntryWriterFormatJSON) ),
+             @"format must be LKEntryWriterFormatLDIF or LKEntryWriterFormatJSON");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // file information
+   fileDescriptor = fd;
+   format         = outputFormat;
+
+   // write buffer
+   bufferSize = LK_WRITER_BUFFER_SIZE;
+   if ((buffer = malloc(bufferSize)) == NULL)
+      [self setErrorWithCode:ENOMEM];
+   if (fd == -1)
+      [self setErrorWithCode:EBADF];
+
+   return(self);
+}
+
+
++ (id) writerWithPath:(NSString *)filePath format:(LKEntryWriterFormat)outputFormat
+{
+   return([[[LKEntryWriter alloc] initWithPath:filePath format:outputFormat] autorelease]);
+}
+
+
++ (id) writerWithFileDescriptor:(int)fd format:(LKEntryWriterFormat)outputFormat
+{
+   return([[[LKEntryWriter alloc] initWithFileDescriptor:fd format:outputFormat] autorelease]);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSString *) path
+{
+   return([[path retain] autorelease]);
+}
+
+
+- (NSUInteger) entryCount
+{
+   @synchronized(self)
+   {
+      return(entryCount);
+   };
+}
+
+
+- (NSString *) errorMessage
+{
+   @synchronized(self)
+   {
+      return([[errorMessage retain] autorelease]);
+   };
+}
+
+
+#pragma mark - Writing entries
+
+- (BOOL) flush
+{
+   @synchronized(self)
+   {
+      if (!(bufferLen))
+         return(errorMessage == nil);
+      [self writeBytes:buffer length:bufferLen];
+      bufferLen = 0;
+      return(errorMessage == nil);
+   };
+}
+
+
+- (BOOL) writeEntry:(LKEntry *)entry
+{
+   NSAutoreleasePool * pool;
+   NSString          * attribute;
+   NSArray           * values;
+   NSData            * data;
+   LKBerValue        * value;
+   BerVarray           vals;
+   NSUInteger          pos;
+   struct berval       dn;
+   struct berval       name;
+
+   NSAssert((entry != nil), @"entry must not be nil");
+
+   @synchronized(self)
+   {
+      if ((errorMessage))
+         return(NO);
+
+      pool = [[NSAutoreleasePool alloc] init];
+
+      data      = [entry.dn dataUsingEncoding:NSUTF8StringEncoding];
+      dn.bv_val = (char *)[data bytes];
+      dn.bv_len = [data length];
+      [self beginEntry:&dn];
+
+      // the values reference the bytes of each LKBerValue
+      for(attribute in entry.attributes)
+      {
+         values = [entry valuesForAttribute:attribute];
+         if ((vals = malloc(sizeof(struct berval) * ([values count] + 1))) == NULL)
+         {
+            [self setErrorWithCode:ENOMEM];
+            break;
+         };
+         for(pos = 0; pos < [values count]; pos++)
+         {
+            value             = [values objectAtIndex:pos];
+            vals[pos].bv_val  = (char *)value.bv_val;
+            vals[pos].bv_len  = value.bv_len;
+         };
+         vals[pos].bv_val = NULL;
+         vals[pos].bv_len = 0;
+         name.bv_val = (char *)[attribute UTF8String];
+         name.bv_len = strlen(name.bv_val);
+         [self writeAttribute:&name values:vals];
+         free(vals);
+      };
+
+      [self endEntry];
+
+      [pool release];
+
+      return(errorMessage == nil);
+   };
+}
+
+
+- (BOOL) writeMessage:(LDAPMessage *)msg ld:(LDAP *)ld
+{
+   int             err;
+   BerElement    * ber;
+   BerVarray       vals;
+   struct berval   dn;
+   struct berval   name;
+
+   @synchronized(self)
+   {
+      if ((errorMessage))
+         return(NO);
+
+      // the DN and values are written from the BER buffer of the message
+      if (ldap_get_dn_ber(ld, msg, &ber, &dn) != LDAP_SUCCESS)
+         return(NO);
+      [self beginEntry:&dn];
+      vals = NULL;
+      err  = ldap_get_attribute_ber(ld, msg, ber, &name, &vals);
+      while ((err == LDAP_SUCCESS) && ((name.bv_val)))
+      {
+         [self writeAttribute:&name values:vals];
+         ber_memfree(vals);
+         vals = NULL;
+         err  = ldap_get_attribute_ber(ld, msg, ber, &name, &vals);
+      };
+      ber_free(ber, 0);
+      [self endEntry];
+
+      return(errorMessage == nil);
+   };
+}
+
+
+#pragma mark - Buffer management
+
+- (void) appendBase64:(struct berval *)value folded:(BOOL)folded
+{
+   const char * src;
+   size_t       len;
+   size_t       chunk;
+   size_t       groups;
+   size_t       encLen;
+   size_t       breaks;
+   size_t       count;
+   size_t       run;
+   size_t       col;
+   size_t       pos;
+   size_t       dst;
+
+   src = value->bv_val;
+   len = value->bv_len;
+
+   // values are encoded into the free space of the buffer. Folded output is
+   // encoded past the space needed for its line breaks and each line is then
+   // moved to its final position.
+   while ( (len > 0) && (!(errorMessage)) )
+   {
+      // each group of 3 bytes is encoded as 4 columns, a line of 75 columns
+      // is preceded by at most 2 bytes of line break
+      if ((folded))
+         groups = ((bufferSize - bufferLen) > 2)
+                ? ((((bufferSize - bufferLen) - 2) * (LK_LDIF_LINE_LENGTH - 1)) / ((LK_LDIF_LINE_LENGTH + 1) * 4))
+                : 0;
+      else
+         groups = (bufferSize - bufferLen) / 4;
+      if (groups == 0)
+      {
+         [self writeBytes:buffer length:bufferLen];
+         bufferLen = 0;
+         continue;
+      };
+      chunk  = (len < (groups * 3)) ? len : (groups * 3);
+      encLen = [LKBerValue lengthOfBase64:chunk];
+
+      // counts the line breaks needed by the encoded chunk
+      breaks = 0;
+      if ((folded))
+      {
+         col = column;
+         for(count = encLen; count > 0; count -= run)
+         {
+            if (col >= LK_LDIF_LINE_LENGTH)
+            {
+               breaks++;
+               col = 1;
+            };
+            run  = LK_LDIF_LINE_LENGTH - col;
+            run  = (run < count) ? run : count;
+            col += run;
+         };
+      };
+
+      pos = bufferLen + (breaks * 2);
+      [LKBerValue encodeBase64:src length:chunk buffer:&buffer[pos]];
+      src += chunk;
+      len -= chunk;
+
+      if (!(folded))
+      {
+         bufferLen += encLen;
+         continue;
+      };
+
+      // the line breaks are written behind the encoded characters which have
+      // already been moved, so they never overwrite characters not yet moved
+      dst = bufferLen;
+      for(count = encLen; count > 0; count -= run)
+      {
+         if (column >= LK_LDIF_LINE_LENGTH)
+         {
+            buffer[dst++] = '\n';
+            buffer[dst++] = ' ';
+            column        = 1;
+         };
+         run = LK_LDIF_LINE_LENGTH - column;
+         run = (run < count) ? run : count;
+         memmove(&buffer[dst], &buffer[pos], run);
+         dst    += run;
+         pos    += run;
+         column += run;
+      };
+      bufferLen = dst;
+   };
+
+   return;
+}
+
+
+- (void) appendBytes:(const char *)bytes length:(size_t)len;
+- (void) appendFoldedBytes:(const char *)bytes length:(size_t)len;
+- (void) appendJSONString:(const char *)bytes length:(size_t)len;
+- (void) appendLDIFName:(struct berval *)name value:(struct berval *)value;
+- (BOOL) writeBytes:(const char *)bytes length:(size_t)len;
+
+/// @name Encoding entries
+- (void) beginEntry:(struct berval *)dn;
+- (void) endEntry;
+- (BOOL) isSafeString:(struct berval *)value;
+- (BOOL) isUTF8String:(struct berval *)value;
+- (void) writeAttribute:(struct berval *)name values:(BerVarray)vals;
+
+/// @name Errors
+- (void) setErrorWithCode:(int)err;
+
+@end
+
+
+@implementation LKEntryWriter
+
+// writer information
+@synthesize fileDescriptor;
+@synthesize format;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // writes buffered output
+   [self flush];
+
+   // file information
+   [path release];
+   if ( ((ownsDescriptor)) && (fileDescriptor != -1) )
+      close(fileDescriptor);
+
+   // write buffer
+   free(buffer);
+
+   // writer state
+   [errorMessage release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) initWithPath:(NSString *)filePath format:(LKEntryWriterFormat)outputFormat
+{
+   int fd;
+   int err;
+   NSAssert((filePath != nil), @"path must not be nil");
+   fd  = open([filePath fileSystemRepresentation], O_WRONLY|O_CREAT|O_TRUNC, 0644);
+   err = errno;
+   if ((self = [self initWithFileDescriptor:fd format:outputFormat]) == nil)
+   {
+      if (fd != -1)
+         close(fd);
+      return(self);
+   };
+
+   // file information
+   path           = [filePath copy];
+   ownsDescriptor = YES;
+   if (fd == -1)
+   {
+      [errorMessage release];
+      errorMessage = nil;
+      [self setErrorWithCode:err];
+   };
+
+   return(self);
+}
+
+
+- (id) initWithFileDescriptor:(int)fd format:(LKEntryWriterFormat)outputFormat
+{
+   NSAssert( ( (outputFormat == LKEntryWriterFormatLDIF) ||
+               (outputFormat == LKEntryWriterFormatJSON) ),
+             @"format must be LKEntryWriterFormatLDIF or LKEntryWriterFormatJSON");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // file information
+   fileDescriptor = fd;
+   format         = outputFormat;
+
+   // write buffer
+   bufferSize = LK_WRITER_BUFFER_SIZE;
+   if ((buffer = malloc(bufferSize)) == NULL)
+      [self setErrorWithCode:ENOMEM];
+   if (fd == -1)
+      [self setErrorWithCode:EBADF];
+
+   return(self);
+}
+
+
++ (id) writerWithPath:(NSString *)filePath format:(LKEntryWriterFormat)outputFormat
+{
+   return([[[LKEntryWriter alloc] initWithPath:filePath format:outputFormat] autorelease]);
+}
+
+
++ (id) writerWithFileDescriptor:(int)fd format:(LKEntryWriterFormat)outputFormat
+{
+   return([[[LKEntryWriter alloc] initWithFileDescriptor:fd format:outputFormat] autorelease]);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSString *) path
+{
+   return([[path retain] autorelease]);
+}
+
+
+- (NSUInteger) entryCount
+{
+   @synchronized(self)
+   {
+      return(entryCount);
+   };
+}
+
+
+- (NSString *) errorMessage
+{
+   @synchronized(self)
+   {
+      return([[errorMessage retain] autorelease]);
+   };
+}
+
+
+#pragma mark - Writing entries
+
+- (BOOL) flush
+{
+   @synchronized(self)
+   {
+      if (!(bufferLen))
+         return(errorMessage == nil);
+      [self writeBytes:buffer length:bufferLen];
+      bufferLen = 0;
+      return(errorMessage == nil);
+   };
+}
+
+
+- (BOOL) writeEntry:(LKEntry *)entry
+{
+   NSAutoreleasePool * pool;
+   NSString          * attribute;
+   NSArray           * values;
+   NSData            * data;
+   LKBerValue        * value;
+   BerVarray           vals;
+   NSUInteger          pos;
+   struct berval       dn;
+   struct berval       name;
+
+   NSAssert((entry != nil), @"entry must not be nil");
+
+   @synchronized(self)
+   {
+      if ((errorMessage))
+         return(NO);
+
+      pool = [[NSAutoreleasePool alloc] init];
+
+      data      = [entry.dn dataUsingEncoding:NSUTF8StringEncoding];
+      dn.bv_val = (char *)[data bytes];
+      dn.bv_len = [data length];
+      [self beginEntry:&dn];
+
+      // the values reference the bytes of each LKBerValue
+      for(attribute in entry.attributes)
+      {
+         values = [entry valuesForAttribute:attribute];
+         if ((vals = malloc(sizeof(struct berval) * ([values count] + 1))) == NULL)
+         {
+            [self setErrorWithCode:ENOMEM];
+            break;
+         };
+         for(pos = 0; pos < [values count]; pos++)
+         {
+            value             = [values objectAtIndex:pos];
+            vals[pos].bv_val  = (char *)value.bv_val;
+            vals[pos].bv_len  = value.bv_len;
+         };
+         vals[pos].bv_val = NULL;
+         vals[pos].bv_len = 0;
+         name.bv_val = (char *)[attribute UTF8String];
+         name.bv_len = strlen(name.bv_val);
+         [self writeAttribute:&name values:vals];
+         free(vals);
+      };
+
+      [self endEntry];
+
+      [pool release];
+
+      return(errorMessage == nil);
+   };
+}
+
+
+- (BOOL) writeMessage:(LDAPMessage *)msg ld:(LDAP *)ld
+{
+   int             err;
+   BerElement    * ber;
+   BerVarray       vals;
+   struct berval   dn;
+   struct berval   name;
+
+   @synchronized(self)
+   {
+      if ((errorMessage))
+         return(NO);
+
+      // the DN and values are written from the BER buffer of the message
+      if (ldap_get_dn_ber(ld, msg, &ber, &dn) != LDAP_SUCCESS)
+         return(NO);
+      [self beginEntry:&dn];
+      vals = NULL;
+      err  = ldap_get_attribute_ber(ld, msg, ber, &name, &vals);
+      while ((err == LDAP_SUCCESS) && ((name.bv_val)))
+      {
+         [self writeAttribute:&name values:vals];
+         ber_memfree(vals);
+         vals = NULL;
+         err  = ldap_get_attribute_ber(ld, msg, ber, &name, &vals);
+      };
+      ber_free(ber, 0);
+      [self endEntry];
+
+      return(errorMessage == nil);
+   };
+}
+
+
+#pragma mark - Buffer management
+
+- (void) appendBase64:(struct berval *)value folded:(BOOL)folded
+{
+   char   * encoded;
+   size_t   encLen;
+
+   if ((errorMessage))
+      return;
+
+   if (!(encoded = malloc([LKBerValue lengthOfBase64:value->bv_len] + 1)))
+   {
+      [self setErrorWithCode:ENOMEM];
+      return;
+   };
+   encLen = [LKBerValue encodeBase64:value->bv_val length:value->bv_len buffer:encoded];
+
+   if ((folded))
+      [self appendFoldedBytes:encoded length:encLen];
+   else
+      [self appendBytes:encoded length:encLen];
+
+   free(encoded);
+
+   return;
+}
+
+
+- (void) appendBytes:(const char *)bytes length:(size_t)len
+{
+   if ((errorMessage))
+      return;
+
+   // large values bypass the buffer
+   if (len > (bufferSize - bufferLen))
+   {
+      [self writeBytes:buffer length:bufferLen];
+      bufferLen = 0;
+      if (len > bufferSize)
+      {
+         [self writeBytes:bytes length:len];
+         return;
+      };
+   };
+
+   memcpy(&buffer[bufferLen], bytes, len);
+   bufferLen += len;
+
+   return;
+}
+
+
+- (void) appendFoldedBytes:(const char *)bytes length:(size_t)len
+{
+   size_t count;
+
+   // LDIF lines longer than 76 columns continue on a line beginning with a
+   // single space
+   while (len > 0)
+   {
+      if (column >= LK_LDIF_LINE_LENGTH)
+      {
+         [self appendBytes:"\n " length:2];
+         column = 1;
+      };
+      count = LK_LDIF_LINE_LENGTH - column;
+      if (count > len)
+         count = len;
+      [self appendBytes:bytes length:count];
+      column += count;
+      bytes  += count;
+      len    -= count;
+   };
+
+   return;
+}
+
+
+- (void) appendJSONString:(const char *)bytes length:(size_t)len
+{
+   size_t   pos;
+   size_t   start;
+   char     escape[8];
+
+   [self appendBytes:"\"" length:1];
+
+   // copies runs of characters which do not need to be escaped
+   start = 0;
+   for(pos = 0; pos < len; pos++)
+   {
+      if ( (bytes[pos] != '"') && (bytes[pos] != '\\') &&
+           (((unsigned char)bytes[pos]) >= 0x20) )
+         continue;
+      [self appendBytes:&bytes[start] length:(pos - start)];
+      switch(bytes[pos])
+      {
+         case '"':  [self appendBytes:"\\\"" length:2]; break;
+         case '\\': [self appendBytes:"\\\\" length:2]; break;
+         case '\n': [self appendBytes:"\\n"  length:2]; break;
+         case '\r': [self appendBytes:"\\r"  length:2]; break;
+         case '\t': [self appendBytes:"\\t"  length:2]; break;
+         default:
+         snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)bytes[pos]);
+         [self appendBytes:escape length:6];
+         break;
+      };
+      start = pos + 1;
+   };
+   [self appendBytes:&bytes[start] length:(len - start)];
+
+   [self appendBytes:"\"" length:1];
+
+   return;
+}
+
+
+- (void) appendLDIFName:(struct berval *)name value:(struct berval *)value
+{
+   [self appendFoldedBytes:name->bv_val length:name->bv_len];
+
+   if ( (!(value)) || (!(value->bv_len)) )
+   {
+      [self appendFoldedBytes:":" length:1];
+   }
+   else if ([self isSafeString:value])
+   {
+      [self appendFoldedBytes:": " length:2];
+      [self appendFoldedBytes:value->bv_val length:value->bv_len];
+   } else {
+      [self appendFoldedBytes:":: " length:3];
+      [self appendBase64:value folded:YES];
+   };
+
+   [self appendBytes:"\n" length:1];
+   column = 0;
+
+   return;
+}
+
+
+- (BOOL) writeBytes:(const char *)bytes length:(size_t)len
+{
+   ssize_t count;
+
+   while ( (len > 0) && (!(errorMessage)) )
+   {
+      if ((count = write(fileDescriptor, bytes, len)) == -1)
+      {
+         if (errno != EINTR)
+            [self setErrorWithCode:errno];
+         continue;
+      };
+      bytes += count;
+      len   -= (size_t)count;
+   };
+
+   return(errorMessage == nil);
+}
+
+
+#pragma mark - Encoding entries
+
+- (void) beginEntry:(struct berval *)dn
+{
+   struct berval name;
+
+   switch(format)
+   {
+      case LKEntryWriterFormatJSON:
+      [self appendBytes:"{\"dn\":" length:6];
+      [self appendJSONString:dn->bv_val length:dn->bv_len];
+      [self appendBytes:",\"attributes\":{" length:15];
+      isFirstAttribute = YES;
+      break;
+
+      default:
+      if (!(entryCount))
+         [self appendBytes:"version: 1\n\n" length:12];
+      name.bv_val = (char *)"dn";
+      name.bv_len = 2;
+      [self appendLDIFName:&name value:dn];
+      break;
+   };
+   return;
+}
+
+
+- (void) endEntry
+{
+   if (format == LKEntryWriterFormatJSON)
+      [self appendBytes:"}}\n" length:3];
+   else
+      [self appendBytes:"\n" length:1];
+   if (!(errorMessage))
+      entryCount++;
+   return;
+}
+
+
+- (BOOL) isSafeString:(struct berval *)value
+{
+   const unsigned char * bytes;
+   size_t                pos;
+
+   // RFC 2849 SAFE-INIT-CHAR, SAFE-CHAR, and values ending with a space
+   bytes = (const unsigned char *)value->bv_val;
+   if ( (bytes[0] == ' ') || (bytes[0] == ':') || (bytes[0] == '<') )
+      return(NO);
+   if (bytes[value->bv_len - 1] == ' ')
+      return(NO);
+   for(pos = 0; pos < value->bv_len; pos++)
+      if ( (bytes[pos] == '\0') || (bytes[pos] == '\n') ||
+           (bytes[pos] == '\r') || (bytes[pos] > 0x7f) )
+         return(NO);
+
+   return(YES);
+}
+
+
+- (BOOL) isUTF8String:(struct berval *)value
+{
+   const unsigned char * bytes;
+   size_t                pos;
+   size_t                len;
+   size_t                x;
+
+   bytes = (const unsigned char *)value->bv_val;
+   for(pos = 0; pos < value->bv_len; pos += len + 1)
+   {
+      if (bytes[pos] < 0x80)
+         len = 0;
+      else if ((bytes[pos] >= 0xc2) && (bytes[pos] <= 0xdf))
+         len = 1;
+      else if ((bytes[pos] & 0xf0) == 0xe0)
+         len = 2;
+      else if ((bytes[pos] >= 0xf0) && (bytes[pos] <= 0xf4))
+         len = 3;
+      else
+         return(NO);
+      if ((pos + len) >= value->bv_len)
+         return(NO);
+      for(x = 1; x <= len; x++)
+         if ((bytes[pos + x] & 0xc0) != 0x80)
+            return(NO);
+   };
+
+   return(YES);
+}
+
+
+- (void) writeAttribute:(struct berval *)name values:(BerVarray)vals
+{
+   NSAutoreleasePool * pool;
+   size_t              pos;
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   switch(format)
+   {
+      case LKEntryWriterFormatJSON:
+      if (!(isFirstAttribute))
+         [self appendBytes:"," length:1];
+      isFirstAttribute = NO;
+      [self appendJSONString:name->bv_val length:name->bv_len];
+      [self appendBytes:":[" length:2];
+      for(pos = 0; ((vals)) && ((vals[pos].bv_val)); pos++)
+      {
+         if ((pos))
+            [self appendBytes:"," length:1];
+         if ([self isUTF8String:&vals[pos]])
+         {
+            [self appendJSONString:vals[pos].bv_val length:vals[pos].bv_len];
+            continue;
+         };
+         [self appendBytes:"{\"base64\":\"" length:11];
+         [self appendBase64:&vals[pos] folded:NO];
+         [self appendBytes:"\"}" length:2];
+      };
+      [self appendBytes:"]" length:1];
+      break;
+
+      default:
+      if ( (!(vals)) || (!(vals[0].bv_val)) )
+         [self appendLDIFName:name value:NULL];
+      for(pos = 0; ((vals)) && ((vals[pos].bv_val)); pos++)
+         [self appendLDIFName:name value:&vals[pos]];
+      break;
+   };
+
+   [pool release];
+
+   return;
+}
+
+
+#pragma mark - Errors
+
+- (void) setErrorWithCode:(int)err
+{
+   if ((errorMessage))
+      return;
+   if ((path))
+      errorMessage = [[NSString alloc] initWithFormat:@"%@: %s", path, strerror(err)];
+   else
+      errorMessage = [[NSString alloc] initWithFormat:@"%s", strerror(err)];
+   bufferLen = 0;
+   return;
+}
+
+@end
@@ -0,0 +1,129 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKFilter evaluates the string representation of an LDAP search filter
+ *  (RFC 4515) against LKEntry objects which are already in memory, such as
+ *  the entries of a cached search or of an LKReplica.
+ *
+ *  The filter string is parsed once into an array of nodes which is walked
+ *  for each entry. Attribute descriptions are resolved to the slots of the
+ *  LKAttributeTable shared by the entries of a search, so evaluating an
+ *  entry does not create any objects.
+ *
+ *  Equality, substring, presence, approximate, greater-or-equal, and
+ *  less-or-equal items may be combined with the `&`, `|`, and `!`
+ *  operators. Since the schema of the directory is not known, values are
+ *  compared with the rules of caseIgnoreMatch: ASCII letters are compared
+ *  case-insensitively, and leading, trailing, and repeated spaces are
+ *  ignored. Approximate items are evaluated as equality items. Ordering
+ *  items compare values numerically when both values are integers and
+ *  lexically otherwise. Extensible match items are not supported.
+ *
+ *  LKFilter objects are immutable and may be used by several threads.
+ */
+
+#import <Foundation/Foundation.h>
+#import <ldap.h>
+
+
+#pragma mark - Data Types
+struct ldap_kit_filter_node;
+typedef struct ldap_kit_filter_node LKFilterNode;
+
+
+@class LKEntry;
+
+
+@interface LKFilter : NSObject
+{
+   // filter information
+   NSString               * string;
+   NSMutableArray         * attributes;
+
+   // compiled filter
+   LKFilterNode           * nodes;
+   NSUInteger               nodeCount;
+   NSUInteger               nodeSize;
+   struct berval          * anyValues;
+   NSUInteger               anyCount;
+   NSUInteger               anySize;
+}
+
+#pragma mark - Object Management Methods
+/// @name Object Management Methods
+
+/// Initialize a filter from its string representation.
+/// @param filter The string representation of the filter.
+/// @return Returns `nil` if the filter is not valid or uses an extensible
+/// match item.
+- (id) initWithString:(NSString *)filter;
+
+/// Creates a filter from its string representation.
+/// @param filter The string representation of the filter.
+/// @return Returns `nil` if the filter is not valid or uses an extensible
+/// match item.
++ (id) filterWithString:(NSString *)filter;
+
+
+#pragma mark - Filter information
+/// @name Filter information
+
+/// The string representation of the filter.
+@property (nonatomic, readonly) NSString * string;
+
+/// The attribute descriptions referenced by the filter.
+@property (nonatomic, readonly) NSArray  * attributes;
+
+
+#pragma mark - Evaluating entries
+/// @name Evaluating entries
+
+/// Evaluates the filter against an entry.
+/// @param entry The LKEntry to evaluate.
+/// @return Returns `YES` if the entry matches the filter.
+- (BOOL) matchesEntry:(LKEntry *)entry;
+
+/// Returns the entries of an array which match the filter.
+///
+/// Large arrays are divided into chunks which are evaluated concurrently.
+/// @param entries An array of LKEntry objects.
+/// @return Returns the matching entries in their original order.
+- (NSArray *) filterEntries:(NSArray *)entries;
+
+/// Returns the indexes of the entries of an array which match the filter.
+/// @param entries An array of LKEntry objects.
+/// @return Returns the indexes of the matching entries.
+- (NSIndexSet *) indexesOfMatchingEntries:(NSArray *)entries;
+
+@end
@@ -0,0 +1,851 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKFilter.m compiled search filter
+ */
+#import "LKFilter.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#import "LKAttributeTable.h"
+#import "LKBerValue.h"
+#import "LKEntry.h"
+#import "LKEntryCategory.h"
+
+// number of entries evaluated by each concurrent block
+#define LK_FILTER_CHUNK_SIZE 4096
+
+
+#pragma mark - Data Types
+enum ldap_kit_filter_operation
+{
+   LKFilterOperationAnd             = 0x01,
+   LKFilterOperationOr              = 0x02,
+   LKFilterOperationNot             = 0x03,
+   LKFilterOperationEquality        = 0x04,
+   LKFilterOperationSubstrings      = 0x05,
+   LKFilterOperationGreaterOrEqual  = 0x06,
+   LKFilterOperationLessOrEqual     = 0x07,
+   LKFilterOperationPresent         = 0x08
+};
+
+
+struct ldap_kit_filter_node
+{
+   int                  operation;  // type of the node
+   NSUInteger           length;     // number of nodes in the subtree of the node
+   NSUInteger           attribute;  // index of the attribute description
+   struct berval        value;      // assertion value or initial substring
+   struct berval        final;      // final substring
+   NSUInteger           any;        // index of the first any substring
+   NSUInteger           anyCount;   // number of any substrings
+   BOOL                 isInteger;  // assertion value is an integer
+   long long            integer;    // integer value of the assertion
+};
+
+
+typedef struct ldap_kit_filter_context
+{
+   LKFilterNode       * nodes;      // compiled filter
+   struct berval      * anyValues;  // any substrings of the compiled filter
+   NSArray            * attributes; // attribute descriptions of the filter
+   NSUInteger           attributeCount;
+   LKEntry            * entry;      // entry being evaluated
+   LKAttributeTable   * table;      // attribute table of the resolved identifiers
+   NSUInteger           tableCount; // size of the table when identifiers were resolved
+   NSUInteger         * identifiers;// identifiers of the attribute descriptions
+   char               * buffer;     // normalized value
+   size_t               bufferSize;
+   struct berval      * values;     // values of entries not backed by a message
+   NSUInteger           valueSize;
+} LKFilterContext;
+
+
+@interface LKFilter ()
+
+/// @name Parsing
+- (NSUInteger) appendNode:(int)operation;
+- (NSUInteger) indexOfAttribute:(const char *)name length:(size_t)len;
+- (BOOL) parseFilter:(const char *)str position:(size_t *)posp;
+- (BOOL) parseItem:(const char *)str position:(size_t *)posp;
+
+/// @name Evaluation
+- (BOOL) initializeContext:(LKFilterContext *)ctx;
+- (char *) newMatchesForEntries:(NSArray *)entries;
+
+/// @name C functions
+BOOL lk_filter_evaluate(LKFilterContext * ctx, NSUInteger pos);
+void lk_filter_free_context(LKFilterContext * ctx);
+BOOL lk_filter_integer(const char * src, size_t len, long long * integerp);
+BOOL lk_filter_match(LKFilterContext * ctx, LKFilterNode * node, struct berval * value);
+size_t lk_filter_normalize(const char * src, size_t len, char * dst);
+BOOL lk_filter_unescape(const char * src, size_t len, struct berval * value);
+BerVarray lk_filter_values(LKFilterContext * ctx, NSUInteger attribute);
+
+@end
+
+
+@implementation LKFilter
+
+// filter information
+@synthesize string;
+@synthesize attributes;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   NSUInteger pos;
+
+   // filter information
+   [string     release];
+   [attributes release];
+
+   // compiled filter
+   for(pos = 0; pos < nodeCount; pos++)
+   {
+      free(nodes[pos].value.bv_val);
+      free(nodes[pos].final.bv_val);
+   };
+   free(nodes);
+   for(pos = 0; pos < anyCount; pos++)
+      free(anyValues[pos].bv_val);
+   free(anyValues);
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) initWithString:(NSString *)filter
+{
+   NSString   * trimmed;
+   const char * str;
+   size_t       pos;
+
+   NSAssert((filter != nil), @"filter must not be nil");
+
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // filter information
+   trimmed    = [filter stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+   string     = [trimmed retain];
+   attributes = [[NSMutableArray alloc] initWithCapacity:4];
+
+   // accepts a single item without parentheses, as do the OpenLDAP tools
+   if (!([trimmed hasPrefix:@"("]))
+      trimmed = [NSString stringWithFormat:@"(%@)", trimmed];
+
+   // compiles the filter
+   pos = 0;
+   str = [trimmed UTF8String];
+   if ( (!(str)) || (!([self parseFilter:str position:&pos])) || ((str[pos])) )
+   {
+      [self release];
+      return(nil);
+   };
+
+   return(self);
+}
+
+
++ (id) filterWithString:(NSString *)filter
+{
+   return([[[LKFilter alloc] initWithString:filter] autorelease]);
+}
+
+
+#pragma mark - Evaluating entries
+
+- (NSArray *) filterEntries:(NSArray *)entries
+{
+   char       * matches;
+   id         * objects;
+   NSUInteger   pos;
+   NSUInteger   count;
+   NSArray    * filtered;
+
+   NSAssert((entries != nil), @"entries must not be nil");
+
+   if ((matches = [self newMatchesForEntries:entries]) == NULL)
+      return(nil);
+   if ((objects = malloc(sizeof(id) * ((([entries count])) ? [entries count] : 1))) == NULL)
+   {
+      free(matches);
+      return(nil);
+   };
+
+   count = 0;
+   for(pos = 0; pos < [entries count]; pos++)
+      if ((matches[pos]))
+         objects[count++] = [entries objectAtIndex:pos];
+   filtered = [[NSArray alloc] initWithObjects:objects count:count];
+
+   free(objects);
+   free(matches);
+
+   return([filtered autorelease]);
+}
+
+
+- (NSIndexSet *) indexesOfMatchingEntries:(NSArray *)entries
+{
+   char              * matches;
+   NSUInteger          pos;
+   NSMutableIndexSet * indexes;
+
+   NSAssert((entries != nil), @"entries must not be nil");
+
+   if ((matches = [self newMatchesForEntries:entries]) == NULL)
+      return(nil);
+
+   indexes = [[NSMutableIndexSet alloc] init];
+   for(pos = 0; pos < [entries count]; pos++)
+      if ((matches[pos]))
+         [indexes addIndex:pos];
+
+   free(matches);
+
+   return([indexes autorelease]);
+}
+
+
+- (BOOL) matchesEntry:(LKEntry *)entry
+{
+   LKFilterContext ctx;
+   BOOL            isMatch;
+
+   NSAssert((entry != nil), @"entry must not be nil");
+
+   if (!([self initializeContext:&ctx]))
+      return(NO);
+   ctx.entry = entry;
+   isMatch   = lk_filter_evaluate(&ctx, 0);
+   lk_filter_free_context(&ctx);
+
+   return(isMatch);
+}
+
+
+- (BOOL) initializeContext:(LKFilterContext *)ctx
+{
+   NSUInteger pos;
+
+   memset(ctx, 0, sizeof(LKFilterContext));
+   ctx->nodes          = nodes;
+   ctx->anyValues      = anyValues;
+   ctx->attributes     = attributes;
+   ctx->attributeCount = [attributes count];
+   ctx->bufferSize     = 256;
+   ctx->identifiers    = malloc(sizeof(NSUInteger) * (((ctx->attributeCount)) ? ctx->attributeCount : 1));
+   ctx->buffer         = malloc(ctx->bufferSize);
+   if ( (!(ctx->identifiers)) || (!(ctx->buffer)) )
+   {
+      lk_filter_free_context(ctx);
+      return(NO);
+   };
+   for(pos = 0; pos < ctx->attributeCount; pos++)
+      ctx->identifiers[pos] = NSNotFound;
+
+   return(YES);
+}
+
+
+- (char *) newMatchesForEntries:(NSArray *)entries
+{
+   char          * matches;
+   NSUInteger      count;
+   NSUInteger      chunks;
+   NSIndexSet    * indexes;
+
+   count = [entries count];
+   if ((matches = calloc(((count)) ? count : 1, sizeof(char))) == NULL)
+      return(NULL);
+
+   // evaluates chunks of entries concurrently, each chunk has its own
+   // context so the blocks do not share any mutable state
+   chunks  = (count + LK_FILTER_CHUNK_SIZE - 1) / LK_FILTER_CHUNK_SIZE;
+   indexes = [[NSIndexSet alloc] initWithIndexesInRange:NSMakeRange(0, chunks)];
+   [indexes enumerateIndexesWithOptions:((chunks > 1)) ? NSEnumerationConcurrent : 0
+      usingBlock:^(NSUInteger chunk, BOOL * stop)
+   {
+      NSAutoreleasePool * pool;
+      LKFilterContext     ctx;
+      NSUInteger          pos;
+      NSUInteger          end;
+
+      pool = [[NSAutoreleasePool alloc] init];
+      if ([self initializeContext:&ctx])
+      {
+         end = (chunk + 1) * LK_FILTER_CHUNK_SIZE;
+         if (end > count)
+            end = count;
+         for(pos = chunk * LK_FILTER_CHUNK_SIZE; pos < end; pos++)
+         {
+            ctx.entry    = [entries objectAtIndex:pos];
+            matches[pos] = (char)lk_filter_evaluate(&ctx, 0);
+         };
+         lk_filter_free_context(&ctx);
+      };
+      [pool release];
+   }];
+   [indexes release];
+
+   return(matches);
+}
+
+
+#pragma mark - Parsing
+
+- (NSUInteger) appendNode:(int)operation
+{
+   void * ptr;
+
+   if (nodeCount >= nodeSize)
+   {
+      if ((ptr = realloc(nodes, sizeof(LKFilterNode) * (nodeSize + 16))) == NULL)
+         return(NSNotFound);
+      nodes     = ptr;
+      nodeSize += 16;
+   };
+
+   memset(&nodes[nodeCount], 0, sizeof(LKFilterNode));
+   nodes[nodeCount].operation = operation;
+   nodes[nodeCount].length    = 1;
+
+   return(nodeCount++);
+}
+
+
+- (NSUInteger) indexOfAttribute:(const char *)name length:(size_t)len
+{
+   NSString   * attribute;
+   NSUInteger   pos;
+
+   if ((attribute = [[NSString alloc] initWithBytes:name length:len encoding:NSUTF8StringEncoding]) == nil)
+      return(NSNotFound);
+
+   // attribute descriptions are compared case-insensitively
+   for(pos = 0; pos < [attributes count]; pos++)
+      if ([[attributes objectAtIndex:pos] caseInsensitiveCompare:attribute] == NSOrderedSame)
+         break;
+   if (pos == [attributes count])
+      [attributes addObject:attribute];
+   [attribute release];
+
+   return(pos);
+}
+
+
+- (BOOL) parseFilter:(const char *)str position:(size_t *)posp
+{
+   int          operation;
+   NSUInteger   index;
+   NSUInteger   count;
+
+   // filter = LPAREN filtercomp RPAREN
+   if (str[*posp] != '(')
+      return(NO);
+   (*posp)++;
+
+   switch(str[*posp])
+   {
+      case '&':
+      operation = LKFilterOperationAnd;
+      break;
+
+      case '|':
+      operation = LKFilterOperationOr;
+      break;
+
+      case '!':
+      operation = LKFilterOperationNot;
+      break;
+
+      default:
+      if (!([self parseItem:str position:posp]))
+         return(NO);
+      if (str[*posp] != ')')
+         return(NO);
+      (*posp)++;
+      return(YES);
+   };
+   (*posp)++;
+
+   // parses the filters of the set, "(&)" and "(|)" are the absolute true
+   // and false filters of RFC 4526
+   if ((index = [self appendNode:operation]) == NSNotFound)
+      return(NO);
+   count = 0;
+   while (str[*posp] == '(')
+   {
+      if (!([self parseFilter:str position:posp]))
+         return(NO);
+      count++;
+   };
+   if ( (operation == LKFilterOperationNot) && (count != 1) )
+      return(NO);
+   if (str[*posp] != ')')
+      return(NO);
+   (*posp)++;
+   nodes[index].length = nodeCount - index;
+
+   return(YES);
+}
+
+
+- (BOOL) parseItem:(const char *)str position:(size_t *)posp
+{
+   char            type;
+   size_t          start;
+   size_t          pos;
+   size_t          end;
+   NSUInteger      index;
+   NSUInteger      attribute;
+   BOOL            isSubstring;
+   BOOL            isInitial;
+   void          * ptr;
+   LKFilterNode  * node;
+
+   // attribute description
+   start = *posp;
+   for(pos = start; ( ((isalnum((unsigned char)str[pos]))) || (str[pos] == '-') ||
+                      (str[pos] == ';') || (str[pos] == '.') ); pos++);
+   if (pos == start)
+      return(NO);
+   if ((attribute = [self indexOfAttribute:&str[start] length:(pos - start)]) == NSNotFound)
+      return(NO);
+
+   // filter type, extensible match items are not supported
+   type = str[pos];
+   switch(type)
+   {
+      case '=':
+      pos++;
+      break;
+
+      case '~':
+      case '>':
+      case '<':
+      if (str[pos+1] != '=')
+         return(NO);
+      pos += 2;
+      break;
+
+      default:
+      return(NO);
+   };
+
+   // locates the end of the assertion value
+   isSubstring = NO;
+   for(end = pos; (str[end] != ')'); end++)
+   {
+      if ( (str[end] == '\0') || (str[end] == '(') )
+         return(NO);
+      if (str[end] == '*')
+         isSubstring = YES;
+      if ( (str[end] == '\\') && ((str[end+1])) )
+         end++;
+   };
+   *posp = end;
+   if ( ((isSubstring)) && (type != '=') )
+      return(NO);
+
+   // present = attr EQUALS ASTERISK
+   if ( ((isSubstring)) && ((end - pos) == 1) )
+   {
+      if ((index = [self appendNode:LKFilterOperationPresent]) == NSNotFound)
+         return(NO);
+      nodes[index].attribute = attribute;
+      return(YES);
+   };
+
+   // simple items
+   if (!(isSubstring))
+   {
+      switch(type)
+      {
+         case '>':
+         index = [self appendNode:LKFilterOperationGreaterOrEqual];
+         break;
+
+         case '<':
+         index = [self appendNode:LKFilterOperationLessOrEqual];
+         break;
+
+         default:
+         index = [self appendNode:LKFilterOperationEquality];
+         break;
+      };
+      if (index == NSNotFound)
+         return(NO);
+      node            = &nodes[index];
+      node->attribute = attribute;
+      if (!(lk_filter_unescape(&str[pos], end - pos, &node->value)))
+         return(NO);
+      node->isInteger = lk_filter_integer(node->value.bv_val, node->value.bv_len, &node->integer);
+      return(YES);
+   };
+
+   // substring = attr EQUALS [initial] any [final]
+   if ((index = [self appendNode:LKFilterOperationSubstrings]) == NSNotFound)
+      return(NO);
+   node            = &nodes[index];
+   node->attribute = attribute;
+   node->any       = anyCount;
+   isInitial       = YES;
+   for(start = pos; pos <= end; pos++)
+   {
+      if ( (pos < end) && (str[pos] == '\\') )
+      {
+         pos++;
+         continue;
+      };
+      if ( (pos < end) && (str[pos] != '*') )
+         continue;
+
+      if ((isInitial))
+      {
+         if ( (pos > start) && (!(lk_filter_unescape(&str[start], pos - start, &node->value))) )
+            return(NO);
+      }
+      else if (pos == end)
+      {
+         if ( (pos > start) && (!(lk_filter_unescape(&str[start], pos - start, &node->final))) )
+            return(NO);
+      }
+      else if (pos > start)
+      {
+         if (anyCount >= anySize)
+         {
+            if ((ptr = realloc(anyValues, sizeof(struct berval) * (anySize + 8))) == NULL)
+               return(NO);
+            anyValues  = ptr;
+            anySize   += 8;
+         };
+         if (!(lk_filter_unescape(&str[start], pos - start, &anyValues[anyCount])))
+            return(NO);
+         anyCount++;
+         node->anyCount++;
+      };
+      isInitial = NO;
+      start     = pos + 1;
+   };
+
+   return(YES);
+}
+
+
+#pragma mark - C functions
+
+BOOL lk_filter_evaluate(LKFilterContext * ctx, NSUInteger pos)
+{
+   NSUInteger     child;
+   NSUInteger     end;
+   BerVarray      vals;
+   LKFilterNode * node;
+
+   node = &ctx->nodes[pos];
+   end  = pos + node->length;
+
+   switch(node->operation)
+   {
+      case LKFilterOperationAnd:
+      for(child = pos + 1; child < end; child += ctx->nodes[child].length)
+         if (!(lk_filter_evaluate(ctx, child)))
+            return(NO);
+      return(YES);
+
+      case LKFilterOperationOr:
+      for(child = pos + 1; child < end; child += ctx->nodes[child].length)
+         if ((lk_filter_evaluate(ctx, child)))
+            return(YES);
+      return(NO);
+
+      case LKFilterOperationNot:
+      return(!(lk_filter_evaluate(ctx, pos + 1)));
+
+      case LKFilterOperationPresent:
+      vals = lk_filter_values(ctx, node->attribute);
+      return( ((vals)) && ((vals[0].bv_val)) );
+
+      default:
+      if ((vals = lk_filter_values(ctx, node->attribute)) == NULL)
+         return(NO);
+      for(; ((vals->bv_val)); vals++)
+         if ((lk_filter_match(ctx, node, vals)))
+            return(YES);
+      return(NO);
+   };
+}
+
+
+void lk_filter_free_context(LKFilterContext * ctx)
+{
+   free(ctx->identifiers);
+   free(ctx->buffer);
+   free(ctx->values);
+   memset(ctx, 0, sizeof(LKFilterContext));
+   return;
+}
+
+
+BOOL lk_filter_integer(const char * src, size_t len, long long * integerp)
+{
+   size_t      pos;
+   long long   integer;
+
+   // accepts integers which do not overflow a long long
+   pos = ((len)) && (src[0] == '-') ? 1 : 0;
+   if ( (pos == len) || ((len - pos) > 18) )
+      return(NO);
+   for(integer = 0; pos < len; pos++)
+   {
+      if ( (src[pos] < '0') || (src[pos] > '9') )
+         return(NO);
+      integer = (integer * 10) + (src[pos] - '0');
+   };
+   *integerp = (src[0] == '-') ? -integer : integer;
+
+   return(YES);
+}
+
+
+BOOL lk_filter_match(LKFilterContext * ctx, LKFilterNode * node, struct berval * value)
+{
+   int               rc;
+   char            * buf;
+   char            * ptr;
+   size_t            len;
+   size_t            pos;
+   size_t            min;
+   NSUInteger        x;
+   long long         integer;
+   struct berval   * any;
+
+   // normalizes the value into the buffer of the context
+   if (value->bv_len > ctx->bufferSize)
+   {
+      if ((buf = realloc(ctx->buffer, value->bv_len)) == NULL)
+         return(NO);
+      ctx->buffer     = buf;
+      ctx->bufferSize = value->bv_len;
+   };
+   buf = ctx->buffer;
+   len = lk_filter_normalize(value->bv_val, value->bv_len, buf);
+
+   switch(node->operation)
+   {
+      case LKFilterOperationEquality:
+      return( (len == node->value.bv_len) && (!(memcmp(buf, node->value.bv_val, len))) );
+
+      case LKFilterOperationGreaterOrEqual:
+      case LKFilterOperationLessOrEqual:
+      if ( ((node->isInteger)) && ((lk_filter_integer(buf, len, &integer))) )
+      {
+         rc = (integer < node->integer) ? -1 : ((integer > node->integer) ? 1 : 0);
+      } else {
+         min = (len < node->value.bv_len) ? len : node->value.bv_len;
+         rc  = memcmp(buf, node->value.bv_val, min);
+         if (!(rc))
+            rc = (len < node->value.bv_len) ? -1 : ((len > node->value.bv_len) ? 1 : 0);
+      };
+      if (node->operation == LKFilterOperationGreaterOrEqual)
+         return(rc >= 0);
+      return(rc <= 0);
+
+      case LKFilterOperationSubstrings:
+      // initial and final substrings may not overlap
+      if ((node->value.bv_len + node->final.bv_len) > len)
+         return(NO);
+      if ( ((node->value.bv_len)) && ((memcmp(buf, node->value.bv_val, node->value.bv_len))) )
+         return(NO);
+      if ( ((node->final.bv_len)) &&
+           ((memcmp(&buf[len - node->final.bv_len], node->final.bv_val, node->final.bv_len))) )
+         return(NO);
+
+      // any substrings appear in order between the initial and final substrings
+      pos  = node->value.bv_len;
+      len -= node->final.bv_len;
+      for(x = 0; x < node->anyCount; x++)
+      {
+         any = &ctx->anyValues[node->any + x];
+         if ((ptr = memmem(&buf[pos], len - pos, any->bv_val, any->bv_len)) == NULL)
+            return(NO);
+         pos = (size_t)(ptr - buf) + any->bv_len;
+      };
+      return(YES);
+
+      default:
+      break;
+   };
+
+   return(NO);
+}
+
+
+size_t lk_filter_normalize(const char * src, size_t len, char * dst)
+{
+   size_t   pos;
+   size_t   out;
+   BOOL     isSpace;
+
+   // folds ASCII letters and removes leading, trailing, and repeated spaces
+   out     = 0;
+   isSpace = NO;
+   for(pos = 0; pos < len; pos++)
+   {
+      if (src[pos] == ' ')
+      {
+         isSpace = ((out)) ? YES : NO;
+         continue;
+      };
+      if ((isSpace))
+         dst[out++] = ' ';
+      isSpace    = NO;
+      dst[out++] = ((src[pos] >= 'A') && (src[pos] <= 'Z')) ? (src[pos] + 32) : src[pos];
+   };
+
+   return(out);
+}
+
+
+BOOL lk_filter_unescape(const char * src, size_t len, struct berval * value)
+{
+   size_t   pos;
+   size_t   out;
+   char   * dst;
+   char     hex[3];
+
+   if ((dst = malloc(len + 1)) == NULL)
+      return(NO);
+
+   // decodes "\XX" escapes (RFC 4515), other escaped characters are copied
+   hex[2] = '\0';
+   for(pos = 0, out = 0; pos < len; pos++)
+   {
+      if ( (src[pos] == '\\') && ((pos + 2) < len) && ((isxdigit((unsigned char)src[pos+1]))) &&
+           ((isxdigit((unsigned char)src[pos+2]))) )
+      {
+         hex[0]     = src[pos+1];
+         hex[1]     = src[pos+2];
+         dst[out++] = (char)strtol(hex, NULL, 16);
+         pos       += 2;
+      }
+      else if ( (src[pos] == '\\') && ((pos + 1) < len) )
+      {
+         dst[out++] = src[++pos];
+      } else {
+         dst[out++] = src[pos];
+      };
+   };
+
+   value->bv_len = lk_filter_normalize(dst, out, dst);
+   value->bv_val = dst;
+   dst[value->bv_len] = '\0';
+
+   return(YES);
+}
+
+
+BerVarray lk_filter_values(LKFilterContext * ctx, NSUInteger attribute)
+{
+   NSUInteger           pos;
+   NSUInteger           count;
+   NSString           * name;
+   NSString           * description;
+   NSArray            * values;
+   LKBerValue         * value;
+   LKAttributeTable   * table;
+   void               * ptr;
+
+   // entries returned by a search share the attribute table of the search,
+   // identifiers are resolved once for each table
+   if ((table = [ctx->entry berAttributeTable]) != nil)
+   {
+      if (table != ctx->table)
+      {
+         for(pos = 0; pos < ctx->attributeCount; pos++)
+            ctx->identifiers[pos] = [table identifierForName:[ctx->attributes objectAtIndex:pos]];
+         ctx->table      = table;
+         ctx->tableCount = [table count];
+      };
+
+      // descriptions may be interned after they were resolved
+      if ( (ctx->identifiers[attribute] == NSNotFound) && ([table count] != ctx->tableCount) )
+      {
+         for(pos = 0; pos < ctx->attributeCount; pos++)
+            if (ctx->identifiers[pos] == NSNotFound)
+               ctx->identifiers[pos] = [table identifierForName:[ctx->attributes objectAtIndex:pos]];
+         ctx->tableCount = [table count];
+      };
+      if (ctx->identifiers[attribute] == NSNotFound)
+         return(NULL);
+      return([ctx->entry berValuesForIdentifier:ctx->identifiers[attribute]]);
+   };
+
+   // other entries store LKBerValue objects keyed by attribute description
+   name = [ctx->attributes objectAtIndex:attribute];
+   if ((values = [ctx->entry valuesForAttribute:name]) == nil)
+      for(description in ctx->entry.attributes)
+         if ([description caseInsensitiveCompare:name] == NSOrderedSame)
+            values = [ctx->entry valuesForAttribute:description];
+   if (!(values))
+      return(NULL);
+
+   count = [values count];
+   if ((count + 1) > ctx->valueSize)
+   {
+      if ((ptr = realloc(ctx->values, sizeof(struct berval) * (count + 1))) == NULL)
+         return(NULL);
+      ctx->values    = ptr;
+      ctx->valueSize = count + 1;
+   };
+   for(pos = 0; pos < count; pos++)
+   {
+      value                  = [values objectAtIndex:pos];
+      ctx->values[pos].bv_val = (char *)value.bv_val;
+      ctx->values[pos].bv_len = value.bv_len;
+   };
+   ctx->values[count].bv_val = NULL;
+   ctx->values[count].bv_len = 0;
+
+   return(ctx->values);
+}
+
+@end
@@ -0,0 +1,133 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKHedgePolicy decides when a search of an LKLdap object sends a duplicate
+ *  request to reduce the latency added by a server which stalls.
+ *
+ *  While hedging is enabled, the time between sending a search and
+ *  receiving its first response is recorded for the most recent searches.
+ *  If a search has not received a response within `percentile` of the
+ *  recorded times, the search is sent again on a second connection. When
+ *  [LKLdap ldapServerURIs] lists several servers, the second connection is
+ *  opened to another healthy server. The request whose connection responds
+ *  first is used and the other request is abandoned.
+ *
+ *  Hedges are limited by a budget. Each search adds `budget` percent of a
+ *  hedge to the budget and each hedge uses a whole hedge, so that the
+ *  number of hedges does not exceed `budget` percent of the searches, apart
+ *  from a burst of at most four hedges.
+ *
+ *  Only the first request of a search of a single base DN is hedged, and
+ *  only when a second connection is available without waiting. Searches
+ *  which continue a virtual list view, synchronizations, and requests
+ *  multiplexed on a shared connection are not hedged.
+ */
+
+#import <Foundation/Foundation.h>
+
+
+@interface LKHedgePolicy : NSObject
+{
+   // hedging settings
+   BOOL                     isEnabled;
+   double                   percentile;
+   double                   budget;
+   NSTimeInterval           minimumDelay;
+
+   // latency history
+   double                 * samples;
+   NSUInteger               sampleCount;
+   NSUInteger               sampleIndex;
+   NSUInteger               samplesSinceUpdate;
+   NSTimeInterval           delay;
+
+   // budget state
+   double                   tokens;
+
+   // statistics
+   NSUInteger               readCount;
+   NSUInteger               hedgeCount;
+   NSUInteger               hedgeWinCount;
+}
+
+#pragma mark - Hedging settings
+/// @name Hedging settings
+
+/// Whether searches may be hedged.
+///
+/// The default value is `NO`.
+@property (nonatomic, assign)   BOOL                     isEnabled;
+
+/// The percentile (between 1 and 100) of the recent response times after
+/// which a search is hedged.
+///
+/// The default value is 95.
+@property (nonatomic, assign)   double                   percentile;
+
+/// The largest percentage of searches which may be hedged.
+///
+/// The default value is 5.
+@property (nonatomic, assign)   double                   budget;
+
+/// The shortest time (in seconds) a search waits before it is hedged.
+///
+/// The default value is 0.001.
+@property (nonatomic, assign)   NSTimeInterval           minimumDelay;
+
+
+#pragma mark - Hedging state
+/// @name Hedging state
+
+/// The time (in seconds) a search currently waits before it is hedged, or 0
+/// if too few response times have been recorded.
+@property (nonatomic, readonly) NSTimeInterval           delay;
+
+
+#pragma mark - Statistics
+/// @name Statistics
+
+/// The number of searches which could have been hedged.
+@property (nonatomic, readonly) NSUInteger               readCount;
+
+/// The number of searches which sent a duplicate request.
+@property (nonatomic, readonly) NSUInteger               hedgeCount;
+
+/// The number of hedged searches in which the duplicate request responded
+/// first.
+@property (nonatomic, readonly) NSUInteger               hedgeWinCount;
+
+/// Resets the counters and the recorded response times.
+- (void) resetStatistics;
+
+@end
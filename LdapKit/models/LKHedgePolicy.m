@@ -0,0 +1,345 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKHedgePolicy.m decides when searches send duplicate requests
+ */
+#import "LKHedgePolicy.h"
+#import "LKHedgePolicyCategory.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+
+// number of recent response times used to calculate the delay
+#define LK_HEDGE_SAMPLE_COUNT 256
+
+// response times required before searches are hedged
+#define LK_HEDGE_MINIMUM_SAMPLES 20
+
+// response times recorded between calculations of the delay
+#define LK_HEDGE_UPDATE_INTERVAL 16
+
+// largest number of hedges which may be sent in a burst
+#define LK_HEDGE_TOKEN_LIMIT 4.0
+
+
+static int lk_hedge_compare(const void * a, const void * b);
+
+
+@interface LKHedgePolicy ()
+
+/// @name Hedging state
+- (void) calculateDelay;
+
+@end
+
+
+@implementation LKHedgePolicy
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   free(samples);
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   if ((self = [super init]) == nil)
+      return(self);
+
+   if ((samples = calloc(LK_HEDGE_SAMPLE_COUNT, sizeof(double))) == NULL)
+   {
+      [self release];
+      return(nil);
+   };
+
+   // hedging settings
+   isEnabled    = NO;
+   percentile   = 95.0;
+   budget       = 5.0;
+   minimumDelay = 0.001;
+
+   return(self);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (double) budget
+{
+   @synchronized(self)
+   {
+      return(budget);
+   };
+}
+- (void) setBudget:(double)percent
+{
+   NSAssert( ((percent >= 0.0) && (percent <= 100.0)), @"hedge budget must be between 0 and 100");
+   @synchronized(self)
+   {
+      budget = percent;
+   };
+   return;
+}
+
+
+- (NSTimeInterval) delay
+{
+   @synchronized(self)
+   {
+      return(delay);
+   };
+}
+
+
+- (NSUInteger) hedgeCount
+{
+   @synchronized(self)
+   {
+      return(hedgeCount);
+   };
+}
+
+
+- (NSUInteger) hedgeWinCount
+{
+   @synchronized(self)
+   {
+      return(hedgeWinCount);
+   };
+}
+
+
+- (BOOL) isEnabled
+{
+   @synchronized(self)
+   {
+      return(isEnabled);
+   };
+}
+- (void) setIsEnabled:(BOOL)enabled
+{
+   @synchronized(self)
+   {
+      isEnabled = enabled;
+   };
+   return;
+}
+
+
+- (NSTimeInterval) minimumDelay
+{
+   @synchronized(self)
+   {
+      return(minimumDelay);
+   };
+}
+- (void) setMinimumDelay:(NSTimeInterval)seconds
+{
+   NSAssert((seconds >= 0), @"minimum hedge delay must not be negative");
+   @synchronized(self)
+   {
+      minimumDelay = seconds;
+      if (sampleCount >= LK_HEDGE_MINIMUM_SAMPLES)
+         [self calculateDelay];
+   };
+   return;
+}
+
+
+- (double) percentile
+{
+   @synchronized(self)
+   {
+      return(percentile);
+   };
+}
+- (void) setPercentile:(double)value
+{
+   NSAssert( ((value >= 1.0) && (value <= 100.0)), @"hedge percentile must be between 1 and 100");
+   @synchronized(self)
+   {
+      percentile = value;
+      if (sampleCount >= LK_HEDGE_MINIMUM_SAMPLES)
+         [self calculateDelay];
+   };
+   return;
+}
+
+
+- (NSUInteger) readCount
+{
+   @synchronized(self)
+   {
+      return(readCount);
+   };
+}
+
+
+#pragma mark - Hedging state
+
+- (void) calculateDelay
+{
+   double     * sorted;
+   NSUInteger   pos;
+
+   // must be called while holding the lock of the policy
+   samplesSinceUpdate = 0;
+   if ((sorted = malloc(sizeof(double) * sampleCount)) == NULL)
+      return;
+   memcpy(sorted, samples, sizeof(double) * sampleCount);
+   qsort(sorted, sampleCount, sizeof(double), lk_hedge_compare);
+
+   // nearest rank of the percentile
+   pos = (NSUInteger)ceil((percentile / 100.0) * (double)sampleCount);
+   if (pos > 0)
+      pos--;
+   if (pos >= sampleCount)
+      pos = sampleCount - 1;
+   delay = (sorted[pos] > minimumDelay) ? sorted[pos] : minimumDelay;
+
+   free(sorted);
+
+   return;
+}
+
+
+- (BOOL) consumeHedge
+{
+   @synchronized(self)
+   {
+      if (tokens < 1.0)
+         return(NO);
+      tokens -= 1.0;
+      hedgeCount++;
+   };
+   return(YES);
+}
+
+
+- (NSTimeInterval) delayForRead
+{
+   @synchronized(self)
+   {
+      if (!(isEnabled))
+         return(0);
+
+      // each search adds its share of a hedge to the budget
+      readCount++;
+      tokens += budget / 100.0;
+      if (tokens > LK_HEDGE_TOKEN_LIMIT)
+         tokens = LK_HEDGE_TOKEN_LIMIT;
+
+      return(delay);
+   };
+}
+
+
+- (void) recordHedgeWon:(BOOL)won
+{
+   @synchronized(self)
+   {
+      if ((won))
+         hedgeWinCount++;
+   };
+   return;
+}
+
+
+- (void) recordLatency:(NSTimeInterval)seconds
+{
+   @synchronized(self)
+   {
+      if (!(isEnabled))
+         return;
+
+      // replaces the oldest response time
+      samples[sampleIndex] = seconds;
+      sampleIndex = (sampleIndex + 1) % LK_HEDGE_SAMPLE_COUNT;
+      if (sampleCount < LK_HEDGE_SAMPLE_COUNT)
+         sampleCount++;
+
+      // the percentile is calculated again after several response times
+      samplesSinceUpdate++;
+      if (sampleCount < LK_HEDGE_MINIMUM_SAMPLES)
+         return;
+      if ( (samplesSinceUpdate >= LK_HEDGE_UPDATE_INTERVAL) || (delay <= 0) )
+         [self calculateDelay];
+   };
+   return;
+}
+
+
+- (void) resetStatistics
+{
+   @synchronized(self)
+   {
+      readCount          = 0;
+      hedgeCount         = 0;
+      hedgeWinCount      = 0;
+      sampleCount        = 0;
+      sampleIndex        = 0;
+      samplesSinceUpdate = 0;
+      delay              = 0;
+      tokens             = 0;
+   };
+   return;
+}
+
+
+#pragma mark - C functions
+
+int lk_hedge_compare(const void * a, const void * b)
+{
+   double x;
+   double y;
+
+   x = *((const double *)a);
+   y = *((const double *)b);
+
+   if (x < y)
+      return(-1);
+   if (x > y)
+      return(1);
+   return(0);
+}
+
+@end
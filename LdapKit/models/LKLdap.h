@@ -38,18 +38,55 @@
 
 #import <Foundation/Foundation.h>
 #import <LdapKit/LKEnumerations.h>
+#import <LdapKit/models/LKMessage.h>
 
+@class LKConnection;
 @class LKEntry;
+@class LKEntryWriter;
+@class LKHedgePolicy;
 @class LKMessage;
+@class LKMetrics;
 @class LKMod;
+@class LKReplica;
+@class LKScheduler;
+@class LKSearchCache;
+@class LKServer;
 @class LKUrl;
 
 @interface LKLdap : NSObject
 {
    // Server State
-   LDAP                   * ld;
    NSOperationQueue       * queue;
    BOOL                     isConnected;
+   BOOL                     ownsQueue;
+
+   // Connection Pool
+   NSCondition            * poolCondition;
+   NSMutableArray         * poolConnections;
+   NSMutableArray         * poolIdleConnections;
+   NSMutableArray         * poolWaiters;
+   NSUInteger               poolGeneration;
+   NSInteger                ldapPoolSize;
+   NSInteger                ldapPoolMinimumSize;
+   NSInteger                ldapPoolIdleTimeout;
+   BOOL                     ldapMultiplexRequests;
+   NSInteger                ldapConnectionProbeInterval;
+
+   // Search Cache
+   LKSearchCache          * ldapSearchCache;
+
+   // Metrics
+   LKMetrics              * ldapMetrics;
+
+   // Scheduler
+   LKScheduler            * ldapScheduler;
+
+   // Replica Routing
+   NSArray                * ldapServers;
+   NSInteger                ldapServerRetryInterval;
+
+   // Hedging
+   LKHedgePolicy          * ldapHedgePolicy;
 
    // Server Information
    NSString               * ldapURI;
@@ -64,6 +101,7 @@
 
    // Timeouts & Limits
    NSInteger                ldapSizeLimit;
+   NSInteger                ldapSearchPageSize;
    NSInteger                ldapSearchTimeout;
    NSInteger                ldapNetworkTimeout;
 
@@ -213,6 +251,17 @@
 /// The maximum number of entries to be returned by a search operation.
 @property (nonatomic, assign)   NSInteger                ldapSearchSizeLimit;
 
+/// The number of entries requested per page using the simple paged results
+/// control (RFC 2696).
+///
+/// When set, searches retrieve their results one page at a time. The next page
+/// is requested as soon as a page is complete, and the entries of the page are
+/// then delivered while the server is preparing the next page. Streaming
+/// searches pass each page to their entry handler. The control is not marked
+/// critical, so servers which do not support paging return every entry in a
+/// single page. Setting the value to 0 disables paging, which is the default.
+@property (nonatomic, assign)   NSInteger                ldapSearchPageSize;
+
 /// The time limit (in seconds) after which a search operation should be
 /// terminated by the server.
 @property (nonatomic, assign)   NSInteger                ldapSearchTimeLimit;
@@ -223,6 +272,164 @@
 @property (nonatomic, assign)   NSInteger                ldapNetworkTimeout;
 
 
+#pragma mark - Connection Pool
+/// @name Connection Pool
+
+/// The maximum number of connections opened to the directory server.
+///
+/// Each LKMessage borrows a connection from the pool while it is executing
+/// and returns the connection when it finishes. Connections are bound with
+/// the credentials of the LKLdap object. If every connection is in use,
+/// messages wait for a connection in the order they requested one. The
+/// default value is 1.
+///
+/// @note If the LKLdap object created its own operation queue, the
+/// `maxConcurrentOperationCount` of the queue is updated to match the pool
+/// size. Shared operation queues are not modified.
+@property (nonatomic, assign)   NSInteger                ldapPoolSize;
+
+/// The minimum number of connections kept open when idle connections are
+/// evicted.
+///
+/// The default value is 1.
+@property (nonatomic, assign)   NSInteger                ldapPoolMinimumSize;
+
+/// The time (in seconds) after which an unused connection is closed.
+///
+/// Connections are never closed while the pool contains
+/// `ldapPoolMinimumSize` or fewer connections. Setting the value to 0
+/// disables idle eviction, which is the default.
+@property (nonatomic, assign)   NSInteger                ldapPoolIdleTimeout;
+
+/// Determines whether messages share connections.
+///
+/// When enabled, a dispatcher thread reads every response received on a
+/// connection and routes it to the LKMessage which sent the request. This
+/// allows many requests to be outstanding on a single connection, so a slow
+/// request does not delay the requests queued behind it. Messages are
+/// assigned to the least busy connection and a new connection is only opened
+/// when every connection is busy and the pool has not reached `ldapPoolSize`.
+/// The default value is NO.
+///
+/// @note If the LKLdap object created its own operation queue, the
+/// `maxConcurrentOperationCount` of the queue is no longer limited to the
+/// pool size while requests are multiplexed.
+@property (nonatomic, assign)   BOOL                     ldapMultiplexRequests;
+
+/// The time (in seconds) a connection may go without receiving a response
+/// before it is verified with a search of the root DSE.
+///
+/// Connections which have been active recently are assumed to be alive.
+/// Closed connections are detected from socket errors and `LDAP_SERVER_DOWN`
+/// results; when a connection is found to be closed, it is reopened and the
+/// operation is replayed once. Searches are replayed if no entries were
+/// received before the failure, other operations are only replayed if the
+/// request could not be sent. Setting the value to 0 disables probing. The
+/// default value is 60.
+@property (nonatomic, assign)   NSInteger                ldapConnectionProbeInterval;
+
+
+#pragma mark - Search Cache
+/// @name Search Cache
+
+/// The cache of search results.
+///
+/// The cache is used by ldapSearchBaseDN:scope:filter:attributes:attributesOnly:
+/// and ldapSearchUrl:attributesOnly:. A search answered from the cache returns
+/// an LKMessage which completes without contacting the directory server, and
+/// its entries are shared with every other search answered by the same
+/// result. Adds, deletes, modifications, and renames sent through this object
+/// remove the results which may include the changed entry, and every result
+/// is removed by ldapRebind and ldapUnbind. Changes made by other clients are
+/// not detected before a result expires. The hit and miss counters of the
+/// cache may be used to measure its effectiveness.
+@property (nonatomic, readonly) LKSearchCache          * ldapSearchCache;
+
+/// The time (in seconds) a cached search result remains valid.
+///
+/// Setting the value to 0 disables the cache, which is the default.
+@property (nonatomic, assign)   NSInteger                ldapSearchCacheTimeout;
+
+/// The maximum estimated size (in bytes) of the cached entries.
+///
+/// The least recently used results are evicted when the limit is exceeded.
+/// The default value is 4 MiB.
+@property (nonatomic, assign)   NSUInteger               ldapSearchCacheSizeLimit;
+
+
+#pragma mark - Metrics
+/// @name Metrics
+
+/// The latency and throughput of the operations performed by this object.
+///
+/// Collection is disabled by default and is enabled by setting the
+/// `isEnabled` property of the LKMetrics object. Only messages which are
+/// queued while collection is enabled are measured. The collected values
+/// may be read with `[LKMetrics snapshot]` or exported with
+/// `[LKMetrics prometheusText]`.
+@property (nonatomic, readonly) LKMetrics              * ldapMetrics;
+
+
+#pragma mark - Scheduler
+/// @name Scheduler
+
+/// The scheduler which orders the messages of this object.
+///
+/// Searches, writes, and imports are placed in interactive, bulk, and write
+/// lanes which share the connections of the pool by weight, so that long
+/// running bulk reads do not delay short searches queued after them. The
+/// weights and concurrency limits of the lanes may be changed, and the
+/// scheduler reports the time messages wait in each lane.
+@property (nonatomic, readonly) LKScheduler            * ldapScheduler;
+
+
+#pragma mark - Replica Routing
+/// @name Replica Routing
+
+/// The URIs of a primary directory server and its replicas.
+///
+/// Each item is either an NSString or an LKUrl. The first server is the
+/// primary server which receives every add, delete, modification, rename,
+/// batch of changes, and import. Searches, synchronizations, and binds are
+/// sent to the healthy server with the lowest measured latency. When a
+/// connection to a server fails or a request sent to a server times out, the
+/// server is marked as unhealthy and the message is retried on the next
+/// server, unless it must be sent to the primary server.
+///
+/// Setting a list of servers overrides `ldapURI`, setting `nil` or an empty
+/// list connects to `ldapURI` again. The connections of the pool are closed
+/// when the list is changed. The encryption scheme of a server with an
+/// `ldaps` URI is always `LKLdapEncryptionSchemeSSL`.
+@property (nonatomic, copy)     NSArray                * ldapServerURIs;
+
+/// The LKServer objects describing the latency and health of each server of
+/// `ldapServerURIs`, in the same order.
+@property (nonatomic, readonly) NSArray                * ldapServers;
+
+/// The number of seconds an unhealthy server is skipped before messages are
+/// routed to it again.
+///
+/// The interval doubles with each consecutive failure of the server. A
+/// latency which has not been measured within the interval is measured
+/// again. The default value is 5.
+@property (nonatomic, assign)   NSInteger                ldapServerRetryInterval;
+
+
+#pragma mark - Hedging
+/// @name Hedging
+
+/// The policy which decides when a search sends a duplicate request.
+///
+/// Hedging is disabled by default and is enabled by setting the `isEnabled`
+/// property of the LKHedgePolicy object. A search which has not received a
+/// response within a percentile of the recent response times is sent again
+/// on a second connection, preferably to another server of
+/// `ldapServerURIs`, and the slower request is abandoned. Hedges use
+/// connections which would otherwise be idle and are limited to a
+/// percentage of the searches.
+@property (nonatomic, readonly) LKHedgePolicy          * ldapHedgePolicy;
+
+
 #pragma mark - Authentication Credentials
 /// @name Authentication Credentials
 
@@ -280,6 +487,59 @@
 #pragma mark - LDAP Tasks
 /// @name LDAP Tasks
 
+/// Initiates an add request for an LDAP entry.
+/// @param dn The DN of the entry to be added.
+/// @param attributes An array of LKMod objects containing the attributes and
+/// values of the entry.
+/// @return Returns the LKMessage object executing the add request.
+- (LKMessage *) ldapAddDN:(NSString *)dn attributes:(NSArray *)attributes;
+
+/// Initiates an add request for an LDAP entry.
+///
+/// The attributes and values of the entry are sent without being copied, so
+/// an entry returned by a search of one server may be added to another.
+/// @param entry An LKEntry object of the entry to be added.
+/// @return Returns the LKMessage object executing the add request.
+- (LKMessage *) ldapAddEntry:(LKEntry *)entry;
+
+/// Initiates a batch of write requests.
+///
+/// Up to windowSize requests are outstanding on the connection at once, and a
+/// new request is sent each time a result is received. The result of each
+/// change is stored in its LKChange object. The returned LKMessage only
+/// reports an error if the batch could not be completed, for example because
+/// the connection was lost or the message was cancelled. In that case the
+/// error is also recorded on every change which did not receive a result.
+/// Changes are not replayed after the connection is lost.
+/// @param changes An array of LKChange objects.
+/// @param windowSize The maximum number of outstanding requests.
+/// @param handler An optional block invoked on the thread executing the
+/// LKMessage each time a change completes.
+/// @return Returns the LKMessage object executing the batch of requests.
+- (LKMessage *) ldapApplyChanges:(NSArray *)changes windowSize:(NSUInteger)windowSize
+                progressHandler:(LKMessageProgressHandler)handler;
+
+/// Initiates the write requests described by an LDIF file.
+///
+/// Records are read from the file as the requests are sent and released once
+/// their results are received, so the memory used by the import does not grow
+/// with the size of the file. Requests are pipelined in the same manner as
+/// ldapApplyChanges:windowSize:progressHandler:. If continueOnError is `NO`,
+/// no further requests are sent after a change fails and the returned
+/// LKMessage reports the error of the failed change. A malformed record or a
+/// file which cannot be read ends the import with `LDAP_DECODING_ERROR` and
+/// the error of the LKLdifReader is stored in the diagnosticMessage of the
+/// LKMessage.
+/// @param path The path of the LDIF file.
+/// @param windowSize The maximum number of outstanding requests.
+/// @param continueOnError Set to `YES` to continue after a change fails.
+/// @param handler An optional block invoked on the thread executing the
+/// LKMessage with each LKChange once it completes.
+/// @return Returns the LKMessage object executing the import.
+- (LKMessage *) ldapImportLdifFile:(NSString *)path windowSize:(NSUInteger)windowSize
+                continueOnError:(BOOL)continueOnError
+                changeHandler:(LKMessageChangeHandler)handler;
+
 /// Initiates a bind request to the remote server.
 ///
 /// If not already connected to the remote server, this will cause a connection
@@ -287,6 +547,21 @@
 /// @return Returns the LKMessage object executing the bind request.
 - (LKMessage *) ldapBind;
 
+/// Opens connections before they are needed by other requests.
+///
+/// Opening a connection requires a TCP connection, a TLS negotiation, and a
+/// bind, which would otherwise delay the first requests sent on each
+/// connection. One message is queued for each connection up to
+/// ldapPoolMinimumSize (at least one, at most ldapPoolSize) and the
+/// messages run concurrently when the queue allows it. Messages which find
+/// the pool already full do nothing. Call this method once the server and
+/// authentication information have been configured.
+///
+/// The time spent in each phase is reported by the connection timing
+/// properties of the messages.
+/// @return Returns an array of the LKMessage objects opening connections.
+- (NSArray *) ldapPrewarmConnections;
+
 /// Initiates a delete request for an LDAP DN.
 /// @param dn The DN to be deleted.
 /// @return Returns the LKMessage object executing the delete request.
@@ -345,6 +620,161 @@
                 attributes:(NSArray *)attributes
                 attributesOnly:(BOOL)attributesOnly;
 
+/// Performs LDAP search operations on multiple base DNs concurrently.
+///
+/// The searches of all bases are issued at once and entries are merged in the
+/// order they are received. When uniqueEntries is `YES`, an entry returned by
+/// more than one base is only reported once. The ldapSearchSizeLimit applies to
+/// the combined results and outstanding searches are abandoned once it is
+/// reached.
+/// @param bases An array of DNs of the entries at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param uniqueEntries Set to `YES` to remove entries with duplicate DNs.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)bases
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly uniqueEntries:(BOOL)uniqueEntries;
+
+/// Performs a streaming LDAP search operation on a single base DN.
+///
+/// Entries are passed to the handler in batches as they are received instead
+/// of being stored in the `entries` property of the LKMessage, so the memory
+/// used by the search does not grow with the number of matching entries. The
+/// handler is invoked on the thread executing the LKMessage and the last
+/// batch may contain fewer than batchSize entries.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search and should be one of
+/// `LKLdapSearchScopeBase`, `LKLdapSearchScopeOneLevel`,
+/// `LKLdapSearchScopeSubTree`, or `LKLdapSearchScopeChildren`.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.  The default is to return all attribute descriptions.
+/// @param attributesOnly  The attrsonly parameter should be set to `YES` value
+/// if  only  attribute  descriptions  are  wanted. It should be set to `NO`
+/// if both attributes descriptions and attribute values are wanted.
+/// @param batchSize The maximum number of entries passed to each invocation of
+/// the handler.
+/// @param handler The block invoked with each batch of LKEntry objects.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)handler;
+
+/// Performs streaming LDAP search operations on multiple base DNs.
+///
+/// See ldapSearchBaseDN:scope:filter:attributes:attributesOnly:batchSize:entryHandler:
+/// for a description of streaming searches.
+/// @param bases An array of DNs of the entries at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param batchSize The maximum number of entries passed to each invocation of
+/// the handler.
+/// @param handler The block invoked with each batch of LKEntry objects.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)bases
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)handler;
+
+/// Performs an LDAP search operation which exports entries to a writer.
+///
+/// Each entry is written from the received BER message as it arrives and the
+/// message is released immediately, so a search of an entire directory holds
+/// one entry in memory at a time. The writer is flushed when the search
+/// completes. If the writer fails, the LKMessage reports `LDAP_LOCAL_ERROR`
+/// and the error of the writer is stored in its diagnosticMessage.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param writer The LKEntryWriter to which entries are written.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer;
+
+/// Performs LDAP search operations on multiple base DNs which export entries
+/// to a writer.
+///
+/// See ldapSearchBaseDN:scope:filter:attributes:attributesOnly:writer: for a
+/// description of exports. An entry returned by more than one base is only
+/// written once.
+/// @param bases An array of DNs of the entries at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param writer The LKEntryWriter to which entries are written.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)bases
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer;
+
+/// Performs an LDAP search operation whose entries are sorted by the
+/// directory server (RFC 2891).
+///
+/// Each sort key is an attribute description, optionally prefixed with `-`
+/// to reverse the order and followed by `:` and the name of an ordering
+/// matching rule (for example `@"-sn:caseIgnoreOrderingMatch"`). Entries are
+/// ordered by the first key and ties are ordered by the following keys. The
+/// sort control is marked critical, so the search fails if the server is
+/// unable to sort the entries.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param sortKeys An array of sort keys.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys;
+
+/// Performs an LDAP search operation which returns a window of the entries
+/// sorted by the directory server using the virtual list view control.
+///
+/// The entries at positions `window.location` through
+/// `window.location + window.length - 1` (starting at 0) of the sorted result
+/// are stored in the `entries` property of the LKMessage. The message also
+/// reports the position of the window and the number of entries in the
+/// result, which the server may estimate, in its `vlvOffset` and
+/// `vlvContentCount` properties. Passing the `vlvContextID` of the previous
+/// window of the same search allows the server to reuse its sorted result, so
+/// that scrolling through a large result only transfers the entries of each
+/// window. ldapSearchPageSize is ignored by windowed searches.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param sortKeys An array of sort keys, see
+/// ldapSearchBaseDN:scope:filter:attributes:sortKeys:.
+/// @param window The positions of the entries to return.
+/// @param contextID The context ID returned with the previous window, or `nil`.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys window:(NSRange)window
+                contextID:(NSData *)contextID;
+
 /// Initiates a renaming of an LDAP DN
 /// @param dn The DN to be renamed.
 /// @param newrdn The new relative DN of the entry.
@@ -366,10 +796,36 @@
 /// @return Returns the LKMessage object executing the search request.
 - (LKMessage *) ldapSearchUrl:(LKUrl *)url attributesOnly:(BOOL)attributesOnly;
 
+/// Synchronizes a local replica with the entries of a subtree using the
+/// LDAP Content Synchronization Operation (RFC 4533).
+///
+/// The first synchronization of a replica transfers every matching entry.
+/// Later synchronizations send the cookie stored in the replica so that the
+/// server only returns the changes made since the previous synchronization.
+/// If `persist` is `YES` the message keeps its connection after the refresh
+/// and applies changes to the replica as they are made on the server until
+/// the message is cancelled. Persisting synchronizations are not limited by
+/// ldapNetworkTimeout, ldapSearchSizeLimit, or ldapSearchTimeLimit.
+/// @param base The DN of the entry at which to start the synchronization.
+/// @param scope The scope of the synchronization.
+/// @param filter The string representation of the filter of the entries to
+/// replicate.
+/// @param attributes An array of attribute descriptions to replicate.
+/// @param replica The LKReplica which receives the entries.
+/// @param persist Set to `YES` to continue receiving changes after the
+/// refresh.
+/// @return Returns the LKMessage object executing the synchronization.
+- (LKMessage *) ldapSyncBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                replica:(LKReplica *)replica persist:(BOOL)persist;
+
 /// Initiates a rebind request to the remote server.
 ///
-/// This will cause the current connection (if one exists) to be terminated
-/// and a new connection to be established.
+/// The other connections of the pool are closed. The connection used by the
+/// request is authenticated again without being reopened if it was opened
+/// with the current URI and encryption scheme and neither the previous nor
+/// the new bind uses SASL. Otherwise the connection is terminated and a new
+/// connection is established.
 /// @return Returns the LKMessage object executing the rebind request.
 - (LKMessage *) ldapRebind;
 
@@ -379,4 +835,361 @@
 /// @return Returns the LKMessage object executing the unbind request.
 - (LKMessage *) ldapUnbind;
 
+
+#pragma mark - Asynchronous LDAP Tasks
+/// @name Asynchronous LDAP Tasks
+
+// The following methods initiate the same requests as the LDAP tasks above
+// and invoke a completion handler on a queue chosen by the caller once the
+// returned LKMessage has finished, including when it is cancelled before it
+// starts. Entry, progress, and change handlers of these requests are also
+// invoked on the queue, and the message waits for each invocation to return
+// before continuing. The messages do not post key-value observing
+// notifications for their entries, referrals, or matched DNs, so results
+// should be read from the message passed to the completion handler.
+
+/// Initiates an add request for an LDAP entry.
+/// @param dn The DN of the entry to be added.
+/// @param attributes An array of LKMod objects.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the add request.
+- (LKMessage *) ldapAddDN:(NSString *)dn attributes:(NSArray *)attributes
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates an add request for an LDAP entry.
+/// @param entry An LKEntry object of the entry to be added.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the add request.
+- (LKMessage *) ldapAddEntry:(LKEntry *)entry queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a batch of write requests.
+///
+/// See ldapApplyChanges:windowSize:progressHandler: for a description of
+/// batches.
+/// @param changes An array of LKChange objects.
+/// @param windowSize The maximum number of outstanding requests.
+/// @param progressHandler An optional block invoked on the queue each time a
+/// change completes.
+/// @param queue The queue on which the handlers are invoked.
+/// @param handler The block invoked once the batch has finished.
+/// @return Returns the LKMessage object executing the batch of requests.
+- (LKMessage *) ldapApplyChanges:(NSArray *)changes windowSize:(NSUInteger)windowSize
+                progressHandler:(LKMessageProgressHandler)progressHandler
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates the write requests described by an LDIF file.
+///
+/// See ldapImportLdifFile:windowSize:continueOnError:changeHandler: for a
+/// description of imports.
+/// @param path The path of the LDIF file.
+/// @param windowSize The maximum number of outstanding requests.
+/// @param continueOnError Set to `YES` to continue after a change fails.
+/// @param changeHandler An optional block invoked on the queue with each
+/// LKChange once it completes.
+/// @param queue The queue on which the handlers are invoked.
+/// @param handler The block invoked once the import has finished.
+/// @return Returns the LKMessage object executing the import.
+- (LKMessage *) ldapImportLdifFile:(NSString *)path windowSize:(NSUInteger)windowSize
+                continueOnError:(BOOL)continueOnError
+                changeHandler:(LKMessageChangeHandler)changeHandler
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a bind request to the remote server.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the bind request.
+- (LKMessage *) ldapBindWithQueue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Opens connections before they are needed by other requests.
+///
+/// The handler is invoked once for each of the returned messages.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked as each message finishes.
+/// @return Returns an array of the LKMessage objects opening connections.
+- (NSArray *) ldapPrewarmConnectionsWithQueue:(dispatch_queue_t)queue
+              completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a delete request for an LDAP DN.
+/// @param dn The DN to be deleted.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the delete request.
+- (LKMessage *) ldapDeleteDN:(NSString *)dn queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a delete request for an LDAP entry.
+/// @param entry An LKEntry object of the DN to be deleted.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the delete request.
+- (LKMessage *) ldapDeleteEntry:(LKEntry *)entry queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a modify request for an LDAP entry.
+/// @param dn The DN to be modified.
+/// @param mod An LKMod object.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the modify request.
+- (LKMessage *) ldapModifyDN:(NSString *)dn modification:(LKMod *)mod
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a modify request for an LDAP entry.
+/// @param dn The DN to be modified.
+/// @param mods An array of LKMod objects.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the modify request.
+- (LKMessage *) ldapModifyDN:(NSString *)dn modifications:(NSArray *)mods
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs an LDAP search operation on a single base DN.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs LDAP search operations on multiple base DNs.
+/// @param bases An array of DNs of the entries at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)bases
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs LDAP search operations on multiple base DNs concurrently.
+///
+/// See ldapSearchBaseDNList:scope:filter:attributes:attributesOnly:uniqueEntries:
+/// for a description of the merged results.
+/// @param bases An array of DNs of the entries at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param uniqueEntries Set to `YES` to remove entries with duplicate DNs.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)bases
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly uniqueEntries:(BOOL)uniqueEntries
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs a streaming LDAP search operation on a single base DN.
+///
+/// See ldapSearchBaseDN:scope:filter:attributes:attributesOnly:batchSize:entryHandler:
+/// for a description of streaming searches. The entry handler is invoked on
+/// the queue before the completion handler.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param batchSize The maximum number of entries passed to each invocation of
+/// the entry handler.
+/// @param entryHandler The block invoked with each batch of LKEntry objects.
+/// @param queue The queue on which the handlers are invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)entryHandler
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs streaming LDAP search operations on multiple base DNs.
+/// @param bases An array of DNs of the entries at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param batchSize The maximum number of entries passed to each invocation of
+/// the entry handler.
+/// @param entryHandler The block invoked with each batch of LKEntry objects.
+/// @param queue The queue on which the handlers are invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)bases
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)entryHandler
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs an LDAP search operation which exports entries to a writer.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param writer The LKEntryWriter to which entries are written.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the export has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs LDAP search operations on multiple base DNs which export entries
+/// to a writer.
+/// @param bases An array of DNs of the entries at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param writer The LKEntryWriter to which entries are written.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the export has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)bases
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs an LDAP search operation whose entries are sorted by the
+/// directory server (RFC 2891).
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param sortKeys An array of sort keys, see
+/// ldapSearchBaseDN:scope:filter:attributes:sortKeys:.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs an LDAP search operation which returns a window of the entries
+/// sorted by the directory server using the virtual list view control.
+///
+/// See ldapSearchBaseDN:scope:filter:attributes:sortKeys:window:contextID:
+/// for a description of windowed searches.
+/// @param base The DN of the entry at which to start the search.
+/// @param scope The scope of the search.
+/// @param filter The string representation of the filter to apply in the search.
+/// @param attributes An array of attribute descriptions to return from matching
+/// entries.
+/// @param sortKeys An array of sort keys.
+/// @param window The positions of the entries to return.
+/// @param contextID The context ID returned with the previous window, or `nil`.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys window:(NSRange)window
+                contextID:(NSData *)contextID queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a renaming of an LDAP DN.
+/// @param dn The DN to be renamed.
+/// @param newrdn The new relative DN of the entry.
+/// @param newSuperior The new superior DN of the entry, or `nil`.
+/// @param deleteOldRDN If non-zero, delete the old relative DN attribute from
+/// the entry.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the rename request.
+- (LKMessage *) ldapRenameDN:(NSString *)dn newRDN:(NSString *)newrdn
+                newSuperior:(NSString *)newSuperior
+                deleteOldRDN:(NSInteger)deleteOldRDN queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Performs an LDAP search operation using parameters from an LKUrl object.
+/// @param url  The URL used to specify the search parameters.
+/// @param attributesOnly  Set to `YES` if only attribute descriptions are
+/// wanted.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the search has finished.
+/// @return Returns the LKMessage object executing the search request.
+- (LKMessage *) ldapSearchUrl:(LKUrl *)url attributesOnly:(BOOL)attributesOnly
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Synchronizes a local replica with the entries of a subtree.
+///
+/// See ldapSyncBaseDN:scope:filter:attributes:replica:persist: for a
+/// description of synchronizations. The handler of a persisting
+/// synchronization is invoked once the message is cancelled.
+/// @param base The DN of the entry at which to start the synchronization.
+/// @param scope The scope of the synchronization.
+/// @param filter The string representation of the filter of the entries to
+/// replicate.
+/// @param attributes An array of attribute descriptions to replicate.
+/// @param replica The LKReplica which receives the entries.
+/// @param persist Set to `YES` to continue receiving changes after the
+/// refresh.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the synchronization has finished.
+/// @return Returns the LKMessage object executing the synchronization.
+- (LKMessage *) ldapSyncBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                replica:(LKReplica *)replica persist:(BOOL)persist
+                queue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates a rebind request to the remote server.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the rebind request.
+- (LKMessage *) ldapRebindWithQueue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
+/// Initiates an unbind request to the remote server.
+/// @param queue The queue on which the handler is invoked.
+/// @param handler The block invoked once the request has finished.
+/// @return Returns the LKMessage object executing the unbind request.
+- (LKMessage *) ldapUnbindWithQueue:(dispatch_queue_t)queue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
 @end
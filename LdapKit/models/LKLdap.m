@@ -37,10 +37,23 @@
 #import "LKLdap.h"
 #import "LKLdapCategory.h"
 
+#import "LKChange.h"
+#import "LKConnection.h"
 #import "LKEntry.h"
+#import "LKEntryWriter.h"
+#import "LKHedgePolicy.h"
+#import "LKLdifReader.h"
 #import "LKMessage.h"
 #import "LKMessageCategory.h"
+#import "LKMetrics.h"
 #import "LKMod.h"
+#import "LKReplica.h"
+#import "LKScheduler.h"
+#import "LKSchedulerCategory.h"
+#import "LKSearchCache.h"
+#import "LKSearchCacheCategory.h"
+#import "LKServer.h"
+#import "LKServerCategory.h"
 #import "LKUrl.h"
 
 @interface LKLdap ()
@@ -49,13 +62,32 @@
 - (void) calculateBindMethod;
 - (void) calculateLdapURL;
 
+/// @name connection pool
+- (NSArray *) evictIdleConnections;
+- (LKConnection *) idleConnectionForServer:(LKServer *)server;
+- (LKConnection *) sharedConnectionForServer:(LKServer *)server;
+
+/// @name replica routing
+- (LKServer *) fastestServerExcept:(LKServer *)excluded;
+- (LKServer *) serverForMessage:(LKMessage *)message;
+
+/// @name LDAP operations
+- (void) enqueueMessage:(LKMessage *)message
+         completionHandler:(LKMessageCompletionHandler)handler
+         queue:(dispatch_queue_t)callbackQueue;
+
+/// @name search cache
+- (LKMessage *) searchWithCacheBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler;
+
 @end
 
 
 @implementation LKLdap
 
 // server state
-@synthesize ld;
 @synthesize isConnected;
 @synthesize operationQueue = queue;
 
@@ -67,9 +99,22 @@
 
 // timeout & limit information
 @synthesize ldapSearchSizeLimit;
+@synthesize ldapSearchPageSize;
 @synthesize ldapSearchTimeLimit;
 @synthesize ldapNetworkTimeout;
 
+// search cache
+@synthesize ldapSearchCache;
+
+// metrics
+@synthesize ldapMetrics;
+
+// scheduler
+@synthesize ldapScheduler;
+
+// hedging
+@synthesize ldapHedgePolicy;
+
 // authentication information
 @synthesize ldapBindMethod;
 
@@ -78,14 +123,37 @@
 
 - (void) dealloc
 {
-   // unbind from LDAP server
-   if ((ld))
-      ldap_unbind_ext(ld, NULL, NULL);
-   ld = NULL;
+   LKConnection * connection;
 
    // server state
    [queue      release];
 
+   // connection pool, the dispatcher threads retain their connections until
+   // the connections are unbound
+   for(connection in poolConnections)
+      [connection unbind];
+   for(connection in poolConnections)
+      [connection waitForDispatcher];
+   [poolCondition       release];
+   [poolConnections     release];
+   [poolIdleConnections release];
+   [poolWaiters         release];
+
+   // search cache
+   [ldapSearchCache release];
+
+   // metrics
+   [ldapMetrics release];
+
+   // scheduler
+   [ldapScheduler release];
+
+   // replica routing
+   [ldapServers release];
+
+   // hedging
+   [ldapHedgePolicy release];
+
    // server information
    [ldapURI  release];
    [ldapHost release];
@@ -115,6 +183,33 @@
    // server state
    queue   = [[NSOperationQueue alloc] init];
    queue.maxConcurrentOperationCount = 1;
+   ownsQueue = YES;
+
+   // connection pool
+   poolCondition         = [[NSCondition alloc] init];
+   poolConnections       = [[NSMutableArray alloc] initWithCapacity:1];
+   poolIdleConnections   = [[NSMutableArray alloc] initWithCapacity:1];
+   poolWaiters           = [[NSMutableArray alloc] initWithCapacity:1];
+   ldapPoolSize          = 1;
+   ldapPoolMinimumSize   = 1;
+   ldapPoolIdleTimeout   = 0;
+   ldapMultiplexRequests = NO;
+   ldapConnectionProbeInterval = 60;
+
+   // search cache
+   ldapSearchCache = [[LKSearchCache alloc] init];
+
+   // metrics
+   ldapMetrics = [[LKMetrics alloc] init];
+
+   // scheduler
+   ldapScheduler = [[LKScheduler alloc] initWithQueue:queue];
+
+   // replica routing
+   ldapServerRetryInterval = 5;
+
+   // hedging
+   ldapHedgePolicy = [[LKHedgePolicy alloc] init];
 
    // server information
    self.ldapURI        = @"ldap://localhost/";
@@ -137,7 +232,9 @@
 
    // retains queue
    [queue release];
-   queue = [newQueue retain];
+   queue     = [newQueue retain];
+   ownsQueue = NO;
+   [ldapScheduler setQueue:queue];
 
    return(self);
 }
@@ -154,7 +251,9 @@
 
    // retains queue
    [queue release];
-   queue = [newQueue retain];
+   queue     = [newQueue retain];
+   ownsQueue = NO;
+   [ldapScheduler setQueue:queue];
 
    // configures server information from LKUrl
    self.ldapURI = url.ldapConnectionUrl;
@@ -340,6 +439,112 @@
 }
 
 
+- (NSInteger) ldapPoolSize
+{
+   @synchronized(self)
+   {
+      return(ldapPoolSize);
+   }
+}
+- (void) setLdapPoolSize:(NSInteger)size
+{
+   NSAssert((size > 0), @"LDAP pool size must be greater than zero");
+   @synchronized(self)
+   {
+      [poolCondition lock];
+      ldapPoolSize = size;
+      [poolCondition broadcast];
+      [poolCondition unlock];
+      if ( ((ownsQueue)) && (!(ldapMultiplexRequests)) )
+         queue.maxConcurrentOperationCount = size;
+      if (!(ldapMultiplexRequests))
+         [ldapScheduler setCapacity:(NSUInteger)size];
+   }
+   return;
+}
+
+
+- (BOOL) ldapMultiplexRequests
+{
+   @synchronized(self)
+   {
+      return(ldapMultiplexRequests);
+   };
+}
+- (void) setLdapMultiplexRequests:(BOOL)multiplex
+{
+   @synchronized(self)
+   {
+      [poolCondition lock];
+      ldapMultiplexRequests = multiplex;
+      [poolCondition broadcast];
+      [poolCondition unlock];
+      if ((ownsQueue))
+         queue.maxConcurrentOperationCount = ((multiplex)) ? NSOperationQueueDefaultMaxConcurrentOperationCount : ldapPoolSize;
+      [ldapScheduler setCapacity:((multiplex)) ? 0 : (NSUInteger)ldapPoolSize];
+   };
+   return;
+}
+
+
+- (NSInteger) ldapPoolMinimumSize
+{
+   @synchronized(self)
+   {
+      return(ldapPoolMinimumSize);
+   }
+}
+- (void) setLdapPoolMinimumSize:(NSInteger)size
+{
+   NSAssert((size >= 0), @"LDAP pool minimum size must not be negative");
+   @synchronized(self)
+   {
+      [poolCondition lock];
+      ldapPoolMinimumSize = size;
+      [poolCondition unlock];
+   }
+   return;
+}
+
+
+- (NSInteger) ldapConnectionProbeInterval
+{
+   @synchronized(self)
+   {
+      return(ldapConnectionProbeInterval);
+   }
+}
+- (void) setLdapConnectionProbeInterval:(NSInteger)interval
+{
+   NSAssert((interval >= 0), @"LDAP connection probe interval must not be negative");
+   @synchronized(self)
+   {
+      ldapConnectionProbeInterval = interval;
+   }
+   return;
+}
+
+
+- (NSInteger) ldapPoolIdleTimeout
+{
+   @synchronized(self)
+   {
+      return(ldapPoolIdleTimeout);
+   }
+}
+- (void) setLdapPoolIdleTimeout:(NSInteger)timeout
+{
+   NSAssert((timeout >= 0), @"LDAP pool idle timeout must not be negative");
+   @synchronized(self)
+   {
+      [poolCondition lock];
+      ldapPoolIdleTimeout = timeout;
+      [poolCondition unlock];
+   }
+   return;
+}
+
+
 - (NSString *) ldapHost
 {
    @synchronized(self)
@@ -450,7 +655,9 @@
    };
 
    // generates new host
-   newHost = [NSString stringWithUTF8String:ludp->lud_host];
+   newHost = @"";
+   if ((ludp->lud_host))
+      newHost = [NSString stringWithUTF8String:ludp->lud_host];
 
    @synchronized(self)
    {
@@ -477,6 +684,113 @@
 }
 
 
+- (NSArray *) ldapServers
+{
+   NSArray * servers;
+   [poolCondition lock];
+   servers = [[ldapServers retain] autorelease];
+   [poolCondition unlock];
+   return(servers);
+}
+
+
+- (NSArray *) ldapServerURIs
+{
+   NSArray * servers;
+   if (!([(servers = self.ldapServers) count]))
+      return(nil);
+   return([servers valueForKey:@"uri"]);
+}
+- (void) setLdapServerURIs:(NSArray *)uris
+{
+   NSAutoreleasePool * pool;
+   NSMutableArray    * servers;
+   NSString          * uri;
+   LKServer          * server;
+   id                  item;
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   // the first valid URI is the primary server
+   servers = [NSMutableArray arrayWithCapacity:[uris count]];
+   for(item in uris)
+   {
+      uri = item;
+      if ([item isKindOfClass:[LKUrl class]])
+         uri = ((LKUrl *)item).ldapConnectionUrl;
+      NSAssert([uri isKindOfClass:[NSString class]], @"LDAP server must be an NSString or LKUrl");
+      if ((server = [[LKServer alloc] initWithURI:uri primary:(![servers count])]) == nil)
+      {
+         NSLog(@"Invalid LDAP URL: %@", uri);
+         continue;
+      };
+      [servers addObject:server];
+      [server release];
+   };
+
+   @synchronized(self)
+   {
+      [poolCondition lock];
+      [ldapServers release];
+      ldapServers = (([servers count])) ? [servers copy] : nil;
+      [poolCondition unlock];
+
+      // connections to the previous servers are closed
+      [self resetConnectionsExcept:nil];
+   };
+
+   [pool release];
+
+   return;
+}
+
+
+- (NSInteger) ldapServerRetryInterval
+{
+   @synchronized(self)
+   {
+      return(ldapServerRetryInterval);
+   }
+}
+- (void) setLdapServerRetryInterval:(NSInteger)interval
+{
+   NSAssert((interval >= 0), @"LDAP server retry interval must not be negative");
+   @synchronized(self)
+   {
+      [poolCondition lock];
+      ldapServerRetryInterval = interval;
+      [poolCondition unlock];
+   }
+   return;
+}
+
+
+- (NSInteger) ldapSearchCacheTimeout
+{
+   return(ldapSearchCache.timeout);
+}
+
+
+- (void) setLdapSearchCacheTimeout:(NSInteger)timeout
+{
+   ldapSearchCache.timeout = timeout;
+   return;
+}
+
+
+- (NSUInteger) ldapSearchCacheSizeLimit
+{
+   return(ldapSearchCache.sizeLimit);
+}
+
+
+- (void) setLdapSearchCacheSizeLimit:(NSUInteger)limit
+{
+   ldapSearchCache.sizeLimit = limit;
+   return;
+}
+
+
 #pragma mark - Manages internal state
 
 - (void) calculateBindMethod
@@ -505,6 +819,7 @@
 - (void) calculateLdapURL
 {
    NSString * scheme;
+   NSString * path;
 
    // determines string representation of scheme
    switch(ldapProtocolScheme)
@@ -523,127 +838,708 @@
    };
 
    [ldapURI release];
+
+   // the host of an ldapi URL is the percent encoded path of a socket
+   if (ldapProtocolScheme == LKLdapProtocolSchemeLDAPI)
+   {
+      path    = [ldapHost stringByReplacingOccurrencesOfString:@"%" withString:@"%25"];
+      path    = [path stringByReplacingOccurrencesOfString:@"/" withString:@"%2F"];
+      ldapURI = [[NSString alloc] initWithFormat:@"%@://%@/", scheme, path];
+      return;
+   };
+
    ldapURI = [[NSString alloc] initWithFormat:@"%@://%@:%i", scheme, ldapHost, ldapPort];
 
    return;
 }
 
 
-#pragma mark - LDAP operations
+#pragma mark - connection pool
 
-- (LKMessage *) ldapBind
+- (LKConnection *) checkoutConnectionForMessage:(LKMessage *)message
 {
-   LKMessage * message;
-   @synchronized(self)
+   LKConnection * connection;
+   LKConnection * replaced;
+   LKServer     * server;
+   NSArray      * evicted;
+
+   connection = nil;
+   replaced   = nil;
+
+   [poolCondition lock];
+
+   // waits in line until a connection is available
+   [poolWaiters addObject:message];
+   while (!(connection))
    {
-      message = [[LKMessage alloc] initBindWithSession:self];
-      message.queuePriority = NSOperationQueuePriorityHigh;
-      [queue addOperation:message];
-      return([message autorelease]);
+      if ((message.isCancelled))
+         break;
+      if ([poolWaiters objectAtIndex:0] == message)
+      {
+         // the server is chosen again each time the message is at the head
+         // of the line, since the health of the servers may have changed
+         server = [self serverForMessage:message];
+
+         // shares a connection if requests are multiplexed
+         if ((ldapMultiplexRequests))
+            connection = [self sharedConnectionForServer:server];
+         else
+            connection = [self idleConnectionForServer:server];
+
+         // closes the least recently used idle connection to another server
+         // if the pool is full
+         if ( (!(connection)) && ((server)) && ([poolIdleConnections count] > 0) &&
+              ((NSInteger)[poolConnections count] >= ldapPoolSize) )
+         {
+            replaced = [[poolIdleConnections objectAtIndex:0] retain];
+            [poolIdleConnections removeObjectAtIndex:0];
+            [poolConnections removeObjectIdenticalTo:replaced];
+         };
+
+         // opens a new connection if the pool is not full
+         if ( (!(connection)) && ((NSInteger)[poolConnections count] < ldapPoolSize) )
+         {
+            connection = [[[LKConnection alloc] init] autorelease];
+            connection.generation = poolGeneration;
+            connection.server     = server;
+            [poolConnections addObject:connection];
+         };
+
+         if ((connection))
+         {
+            [connection retain];
+            [poolIdleConnections removeObjectIdenticalTo:connection];
+            connection.borrowCount = connection.borrowCount + 1;
+         };
+      };
+      if (!(connection))
+         [poolCondition wait];
    };
+   [poolWaiters removeObjectIdenticalTo:message];
+
+   // allows the next message in line to check for a connection
+   [poolCondition broadcast];
+
+   evicted = [self evictIdleConnections];
+
+   [poolCondition unlock];
+
+   [replaced unbind];
+   [replaced release];
+   [evicted makeObjectsPerformSelector:@selector(unbind)];
+
+   return([connection autorelease]);
 }
 
 
-- (LKMessage *) ldapDeleteDN:(NSString *)dn
+- (void) checkinConnection:(LKConnection *)connection
 {
-   LKMessage * message;
-   NSAssert((dn != nil), @"dn must not be nil");
-   @synchronized(self)
+   NSArray * evicted;
+   BOOL      discard;
+
+   if (!(connection))
+      return;
+   [[connection retain] autorelease];
+
+   [poolCondition lock];
+
+   // shared connections remain busy until every borrower returns them
+   discard = NO;
+   if (connection.borrowCount > 0)
+      connection.borrowCount = connection.borrowCount - 1;
+   if (connection.borrowCount == 0)
    {
-      message = [[LKMessage alloc] initDeleteWithSession:self dn:dn];
-      [queue addOperation:message];
-      return([message autorelease]);
+      // discards connections from before a reset or above the pool size
+      if (connection.generation != poolGeneration)
+         discard = YES;
+      if ((NSInteger)[poolConnections count] > ldapPoolSize)
+         discard = YES;
+
+      if ((discard))
+      {
+         [poolConnections removeObjectIdenticalTo:connection];
+      } else {
+         // a connection which is not shared may still run the dispatcher of
+         // a message which failed over while waiting for responses
+         if (!(ldapMultiplexRequests))
+            [connection stopDispatcherIfIdle];
+         connection.lastUsed = [NSDate timeIntervalSinceReferenceDate];
+         [poolIdleConnections addObject:connection];
+      };
    };
+
+   evicted = [self evictIdleConnections];
+
+   [poolCondition broadcast];
+   [poolCondition unlock];
+
+   if ((discard))
+      [connection unbind];
+   [evicted makeObjectsPerformSelector:@selector(unbind)];
+
+   return;
 }
 
 
-- (LKMessage *) ldapDeleteEntry:(LKEntry *)entry
+- (LKConnection *) checkoutHedgeConnectionExceptServer:(LKServer *)original
 {
-   LKMessage * message;
-   NSAssert((entry != nil), @"entry must not be nil");
-   @synchronized(self)
+   LKConnection * connection;
+   LKServer     * server;
+
+   [poolCondition lock];
+
+   // hedges never wait for a connection and do not share connections
+   connection = nil;
+   if ((ldapMultiplexRequests))
    {
-      message = [[LKMessage alloc] initDeleteWithSession:self dn:entry.dn];
-      [queue addOperation:message];
-      return([message autorelease]);
+      [poolCondition unlock];
+      return(nil);
    };
-}
 
+   // prefers another healthy server
+   server = [self fastestServerExcept:original];
+   if ( (!(server)) || (!(server.isHealthy)) )
+      server = original;
 
-- (LKMessage *) ldapModifyDN:(NSString *)dn modification:(LKMod *)mod
-{
-   LKMessage * message;
-   NSArray   * mods;
-   NSAssert((dn != nil), @"dn must not be nil");
-   NSAssert((mod != nil), @"mod must not be nil");
-   @synchronized(self)
+   // uses an idle connection or opens a new connection if the pool is not full
+   if ((connection = [self idleConnectionForServer:server]) != nil)
    {
-      mods = [[NSArray alloc] initWithObjects:mod, nil];
-      message = [[LKMessage alloc] initModifyWithSession:self dn:dn mods:mods];
-      [mods release];
-      [queue addOperation:message];
-      return([message autorelease]);
+      [connection retain];
+      [poolIdleConnections removeObjectIdenticalTo:connection];
+      connection.borrowCount = connection.borrowCount + 1;
+   }
+   else if ((NSInteger)[poolConnections count] < ldapPoolSize)
+   {
+      connection = [[LKConnection alloc] init];
+      connection.generation  = poolGeneration;
+      connection.borrowCount = 1;
+      connection.server      = server;
+      [poolConnections addObject:connection];
    };
+
+   [poolCondition unlock];
+
+   return([connection autorelease]);
 }
 
 
-- (LKMessage *) ldapModifyDN:(NSString *)dn modifications:(NSArray *)mods
+- (LKConnection *) checkoutNewConnection
 {
-   LKMessage  * message;
-   NSUInteger   pos;
-   NSAssert((dn != nil), @"dn must not be nil");
-   NSAssert((mods != nil), @"mods must not be nil");
-   for(pos = 0; pos < [mods count]; pos++)
-      NSAssert( ( (([[mods objectAtIndex:pos] isKindOfClass:[LKMod class]])) ||
-                  (([[mods objectAtIndex:pos] isKindOfClass:[NSString class]])) ||
-                  (([[mods objectAtIndex:pos] isKindOfClass:[NSData class]])) ),
-         @"mods array must contain only NSData, NSString, or LKMod objects");
-   @synchronized(self)
+   LKConnection * connection;
+
+   [poolCondition lock];
+
+   // only adds connections to a pool which is not full
+   connection = nil;
+   if ((NSInteger)[poolConnections count] < ldapPoolSize)
    {
-      message = [[LKMessage alloc] initModifyWithSession:self dn:dn mods:mods];
-      [queue addOperation:message];
-      return([message autorelease]);
+      connection = [[LKConnection alloc] init];
+      connection.generation  = poolGeneration;
+      connection.borrowCount = 1;
+      connection.server      = [self serverForMessage:nil];
+      [poolConnections addObject:connection];
    };
+
+   [poolCondition unlock];
+
+   return([connection autorelease]);
 }
 
 
-- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
-                filter:(NSString *)filter attributes:(NSArray *)attributes
-                attributesOnly:(BOOL)attributesOnly
+- (NSArray *) evictIdleConnections
 {
-   LKMessage  * message;
-   NSUInteger   pos;
-   NSAssert((dn != nil),         @"dn must not be nil");
-   NSAssert((filter != nil),     @"filter must not be nil");
-   if ((attributes))
-   {
-      for(pos = 0; pos < [attributes count]; pos++)
-         NSAssert([[attributes objectAtIndex:pos] isKindOfClass:[NSString class]],
-            @"attributes must only contain NSString objects");
-   };
-   @synchronized(self)
+   NSMutableArray * evicted;
+   LKConnection   * connection;
+   NSTimeInterval   limit;
+
+   // must be called while holding poolCondition
+   if (ldapPoolIdleTimeout < 1)
+      return(nil);
+   limit   = [NSDate timeIntervalSinceReferenceDate] - ldapPoolIdleTimeout;
+   evicted = nil;
+
+   // idle connections are ordered from least to most recently used
+   while ( ([poolIdleConnections count] > 0) &&
+           ((NSInteger)[poolConnections count] > ldapPoolMinimumSize) )
    {
-      message = [[LKMessage alloc] initSearchWithSession:self baseDN:dn
-                  scope:scope filter:filter attributes:attributes
-                  attributesOnly:attributesOnly];
-      [queue addOperation:message];
-      return([message autorelease]);
+      connection = [poolIdleConnections objectAtIndex:0];
+      if (connection.lastUsed > limit)
+         break;
+      if (!(evicted))
+         evicted = [NSMutableArray arrayWithCapacity:1];
+      [evicted addObject:connection];
+      [poolIdleConnections removeObjectAtIndex:0];
+      [poolConnections removeObjectIdenticalTo:connection];
    };
+
+   return(evicted);
 }
 
 
-- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
-                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
-                attributes:(NSArray *)attributes
-                attributesOnly:(BOOL)attributesOnly
+- (LKConnection *) idleConnectionForServer:(LKServer *)server
 {
-   LKMessage  * message;
-   NSUInteger   pos;
-   NSAssert((dnList != nil), @"dnList must not be nil");
-   NSAssert((filter != nil), @"filter must not be nil");
+   LKConnection * connection;
+
+   // must be called while holding poolCondition, prefers the most recently
+   // used connection
+   for(connection in [poolIdleConnections reverseObjectEnumerator])
+      if (connection.server == server)
+         return(connection);
+
+   return(nil);
+}
+
+
+- (LKConnection *) sharedConnectionForServer:(LKServer *)server
+{
+   LKConnection * connection;
+   LKConnection * shared;
+
+   // must be called while holding poolCondition
+   shared = nil;
+   for(connection in poolConnections)
+   {
+      if (connection.generation != poolGeneration)
+         continue;
+      if (connection.server != server)
+         continue;
+      if ( (!(shared)) || (connection.borrowCount < shared.borrowCount) )
+         shared = connection;
+   };
+
+   // prefers opening a new connection over sharing a busy connection
+   if ( ((shared)) && (shared.borrowCount > 0) &&
+        ((NSInteger)[poolConnections count] < ldapPoolSize) )
+      return(nil);
+
+   return(shared);
+}
+
+
+- (void) resetConnectionsExcept:(LKConnection *)connection
+{
+   NSArray * idle;
+
+   [poolCondition lock];
+
+   // connections currently lent to messages are discarded when returned
+   poolGeneration++;
+   connection.generation = poolGeneration;
+   idle = [NSArray arrayWithArray:poolIdleConnections];
+   [poolIdleConnections removeAllObjects];
+   [poolConnections removeObjectsInArray:idle];
+
+   [poolCondition broadcast];
+   [poolCondition unlock];
+
+   [idle makeObjectsPerformSelector:@selector(unbind)];
+
+   return;
+}
+
+
+- (void) signalConnectionWaiters
+{
+   [poolCondition lock];
+   [poolCondition broadcast];
+   [poolCondition unlock];
+   return;
+}
+
+
+#pragma mark - replica routing
+
+- (LKServer *) fastestServerExcept:(LKServer *)excluded
+{
+   LKServer       * server;
+   LKServer       * fastest;
+   LKServer       * retry;
+   NSTimeInterval   latency;
+   NSTimeInterval   fastestLatency;
+
+   // must be called while holding poolCondition, chooses the healthy server
+   // with the lowest latency, a server whose latency is unknown or out of
+   // date is measured
+   fastest        = nil;
+   retry          = nil;
+   fastestLatency = 0;
+   for(server in ldapServers)
+   {
+      if (server == excluded)
+         continue;
+      if (!(server.isHealthy))
+      {
+         if ( (!(retry)) || (server.retryTime < retry.retryTime) )
+            retry = server;
+         continue;
+      };
+      latency = [server latencyWithLifetime:ldapServerRetryInterval];
+      if ( (!(fastest)) || (latency < fastestLatency) )
+      {
+         fastest        = server;
+         fastestLatency = latency;
+      };
+   };
+
+   // uses the server which may be retried first if every server is unhealthy
+   return(((fastest)) ? fastest : retry);
+}
+
+
+- (LKServer *) serverForMessage:(LKMessage *)message
+{
+   // must be called while holding poolCondition
+   if (!([ldapServers count]))
+      return(nil);
+
+   // writes are only sent to the primary server
+   if (([message requiresPrimaryServer]))
+      return([ldapServers objectAtIndex:0]);
+
+   return([self fastestServerExcept:nil]);
+}
+
+
+#pragma mark - LDAP operations
+
+- (void) enqueueMessage:(LKMessage *)message
+         completionHandler:(LKMessageCompletionHandler)handler
+         queue:(dispatch_queue_t)callbackQueue
+{
+   NSUInteger lane;
+   NSAssert(((handler == nil) || (callbackQueue != NULL)), @"queue must not be NULL");
+
+   // the time in the queue is only measured while collection is enabled
+   if ((ldapMetrics.isEnabled))
+      [message enableMetrics];
+
+   // attaches the handler of an asynchronous request before it may start
+   if ((handler))
+      [message setCompletionHandler:handler queue:callbackQueue];
+
+   // messages which are not placed in a lane are queued immediately
+   lane = [message schedulerLaneWithInteractiveSizeLimit:ldapScheduler.interactiveSizeLimit];
+   if (lane == NSNotFound)
+      [queue addOperation:message];
+   else
+      [ldapScheduler scheduleMessage:message lane:(LKSchedulerLane)lane];
+
+   return;
+}
+
+
+- (LKMessage *) ldapAddDN:(NSString *)dn attributes:(NSArray *)attributes
+{
+   return([self ldapAddDN:dn attributes:attributes queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapAddDN:(NSString *)dn attributes:(NSArray *)attributes
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage  * message;
+   NSUInteger   pos;
+   NSAssert((dn != nil), @"dn must not be nil");
+   NSAssert((attributes != nil), @"attributes must not be nil");
+   for(pos = 0; pos < [attributes count]; pos++)
+      NSAssert([[attributes objectAtIndex:pos] isKindOfClass:[LKMod class]],
+         @"attributes must only contain LKMod objects");
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initAddWithSession:self dn:dn mods:attributes];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapAddEntry:(LKEntry *)entry
+{
+   return([self ldapAddEntry:entry queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapAddEntry:(LKEntry *)entry queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage      * message;
+   LKMod          * mod;
+   NSString       * attribute;
+   NSMutableArray * mods;
+   NSAssert((entry != nil), @"entry must not be nil");
+
+   // the values reference the entry's BER buffer
+   mods = [[NSMutableArray alloc] init];
+   for(attribute in entry.attributes)
+   {
+      mod = [[LKMod alloc] initWithOperation:LKLdapModOperationAdd
+               type:attribute values:[entry valuesForAttribute:attribute]];
+      [mods addObject:mod];
+      [mod release];
+   };
+
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initAddWithSession:self dn:entry.dn mods:mods];
+      [mods release];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapBind
+{
+   return([self ldapBindWithQueue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapBindWithQueue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage * message;
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initBindWithSession:self];
+      message.queuePriority = NSOperationQueuePriorityHigh;
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (NSArray *) ldapPrewarmConnections
+{
+   return([self ldapPrewarmConnectionsWithQueue:NULL completionHandler:nil]);
+}
+- (NSArray *) ldapPrewarmConnectionsWithQueue:(dispatch_queue_t)callbackQueue
+              completionHandler:(LKMessageCompletionHandler)handler
+{
+   NSMutableArray * messages;
+   LKMessage      * message;
+   NSInteger        count;
+   NSInteger        pos;
+   @synchronized(self)
+   {
+      // opens the minimum number of connections of the pool, at least one
+      count = (ldapPoolMinimumSize > 0) ? ldapPoolMinimumSize : 1;
+      if (count > ldapPoolSize)
+         count = ldapPoolSize;
+      messages = [NSMutableArray arrayWithCapacity:count];
+      for(pos = 0; pos < count; pos++)
+      {
+         // every message opening a connection receives the handler
+         message = [[LKMessage alloc] initPrewarmWithSession:self];
+         [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+         [messages addObject:message];
+         [message release];
+      };
+      return(messages);
+   };
+}
+
+
+- (LKMessage *) ldapApplyChanges:(NSArray *)changes windowSize:(NSUInteger)windowSize
+                progressHandler:(LKMessageProgressHandler)handler
+{
+   return([self ldapApplyChanges:changes windowSize:windowSize
+            progressHandler:handler queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapApplyChanges:(NSArray *)changes windowSize:(NSUInteger)windowSize
+                progressHandler:(LKMessageProgressHandler)progressHandler
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage  * message;
+   NSUInteger   pos;
+   NSAssert((changes != nil),  @"changes must not be nil");
+   NSAssert((windowSize > 0),  @"windowSize must be greater than zero");
+   for(pos = 0; pos < [changes count]; pos++)
+      NSAssert([[changes objectAtIndex:pos] isKindOfClass:[LKChange class]],
+         @"changes must only contain LKChange objects");
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initBatchWithSession:self changes:changes
+                  windowSize:windowSize progressHandler:progressHandler];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapImportLdifFile:(NSString *)path windowSize:(NSUInteger)windowSize
+                continueOnError:(BOOL)continueOnError
+                changeHandler:(LKMessageChangeHandler)handler
+{
+   return([self ldapImportLdifFile:path windowSize:windowSize
+            continueOnError:continueOnError changeHandler:handler
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapImportLdifFile:(NSString *)path windowSize:(NSUInteger)windowSize
+                continueOnError:(BOOL)continueOnError
+                changeHandler:(LKMessageChangeHandler)changeHandler
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage    * message;
+   LKLdifReader * reader;
+   NSAssert((path != nil),    @"path must not be nil");
+   NSAssert((windowSize > 0), @"windowSize must be greater than zero");
+   @synchronized(self)
+   {
+      reader  = [[LKLdifReader alloc] initWithPath:path];
+      message = [[LKMessage alloc] initImportWithSession:self reader:reader
+                  windowSize:windowSize continueOnError:continueOnError
+                  changeHandler:changeHandler];
+      [reader release];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapDeleteDN:(NSString *)dn
+{
+   return([self ldapDeleteDN:dn queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapDeleteDN:(NSString *)dn queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage * message;
+   NSAssert((dn != nil), @"dn must not be nil");
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initDeleteWithSession:self dn:dn];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapDeleteEntry:(LKEntry *)entry
+{
+   return([self ldapDeleteEntry:entry queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapDeleteEntry:(LKEntry *)entry queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   NSAssert((entry != nil), @"entry must not be nil");
+   return([self ldapDeleteDN:entry.dn queue:callbackQueue completionHandler:handler]);
+}
+
+
+- (LKMessage *) ldapModifyDN:(NSString *)dn modification:(LKMod *)mod
+{
+   return([self ldapModifyDN:dn modification:mod queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapModifyDN:(NSString *)dn modification:(LKMod *)mod
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage * message;
+   NSArray   * mods;
+   NSAssert((dn != nil), @"dn must not be nil");
+   NSAssert((mod != nil), @"mod must not be nil");
+   mods    = [[NSArray alloc] initWithObjects:mod, nil];
+   message = [self ldapModifyDN:dn modifications:mods queue:callbackQueue
+               completionHandler:handler];
+   [mods release];
+   return(message);
+}
+
+
+- (LKMessage *) ldapModifyDN:(NSString *)dn modifications:(NSArray *)mods
+{
+   return([self ldapModifyDN:dn modifications:mods queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapModifyDN:(NSString *)dn modifications:(NSArray *)mods
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage  * message;
+   NSUInteger   pos;
+   NSAssert((dn != nil), @"dn must not be nil");
+   NSAssert((mods != nil), @"mods must not be nil");
+   for(pos = 0; pos < [mods count]; pos++)
+      NSAssert( ( (([[mods objectAtIndex:pos] isKindOfClass:[LKMod class]])) ||
+                  (([[mods objectAtIndex:pos] isKindOfClass:[NSString class]])) ||
+                  (([[mods objectAtIndex:pos] isKindOfClass:[NSData class]])) ),
+         @"mods array must contain only NSData, NSString, or LKMod objects");
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initModifyWithSession:self dn:dn mods:mods];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly
+{
+   return([self ldapSearchBaseDN:dn scope:scope filter:filter attributes:attributes
+            attributesOnly:attributesOnly queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   NSUInteger   pos;
+   NSAssert((dn != nil),         @"dn must not be nil");
+   NSAssert((filter != nil),     @"filter must not be nil");
+   if ((attributes))
+   {
+      for(pos = 0; pos < [attributes count]; pos++)
+         NSAssert([[attributes objectAtIndex:pos] isKindOfClass:[NSString class]],
+            @"attributes must only contain NSString objects");
+   };
+   return([self searchWithCacheBaseDN:dn scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly
+            queue:callbackQueue completionHandler:handler]);
+}
+
+
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly
+{
+   return([self ldapSearchBaseDNList:dnList scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly
+            uniqueEntries:NO queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   return([self ldapSearchBaseDNList:dnList scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly
+            uniqueEntries:NO queue:callbackQueue completionHandler:handler]);
+}
+
+
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly uniqueEntries:(BOOL)uniqueEntries
+{
+   return([self ldapSearchBaseDNList:dnList scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly
+            uniqueEntries:uniqueEntries queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly uniqueEntries:(BOOL)uniqueEntries
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage  * message;
+   NSUInteger   pos;
+   NSAssert((dnList != nil), @"dnList must not be nil");
+   NSAssert((filter != nil), @"filter must not be nil");
    for(pos = 0; pos < [dnList count]; pos++)
       NSAssert([[dnList objectAtIndex:pos] isKindOfClass:[NSString class]],
-         @"attributes must only contain NSString objects");
+         @"dnList must only contain NSString objects");
    if ((attributes))
    {
       for(pos = 0; pos < [attributes count]; pos++)
@@ -654,23 +1550,249 @@
    {
       message = [[LKMessage alloc] initSearchWithSession:self baseDnList:dnList
                   scope:scope filter:filter attributes:attributes
-                  attributesOnly:attributesOnly];
-      [queue addOperation:message];
+                  attributesOnly:attributesOnly uniqueEntries:uniqueEntries];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
       return([message autorelease]);
    };
 }
 
 
-- (LKMessage *) ldapSearchUrl:(LKUrl *)url attributesOnly:(BOOL)attributesOnly
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)handler
+{
+   return([self ldapSearchBaseDN:dn scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly
+            batchSize:batchSize entryHandler:handler
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)entryHandler
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
 {
    LKMessage * message;
+   NSArray   * dnList;
+   NSAssert((dn != nil), @"dn must not be nil");
+   dnList  = [[NSArray alloc] initWithObjects:dn, nil];
+   message = [self ldapSearchBaseDNList:dnList scope:scope filter:filter
+               attributes:attributes attributesOnly:attributesOnly
+               batchSize:batchSize entryHandler:entryHandler
+               queue:callbackQueue completionHandler:handler];
+   [dnList release];
+   return(message);
+}
+
+
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)handler
+{
+   return([self ldapSearchBaseDNList:dnList scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly
+            batchSize:batchSize entryHandler:handler
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly batchSize:(NSUInteger)batchSize
+                entryHandler:(LKMessageEntryHandler)entryHandler
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage  * message;
+   NSUInteger   pos;
+   NSAssert((dnList != nil),       @"dnList must not be nil");
+   NSAssert((filter != nil),       @"filter must not be nil");
+   NSAssert((entryHandler != nil), @"handler must not be nil");
+   NSAssert((batchSize > 0),       @"batchSize must be greater than zero");
+   for(pos = 0; pos < [dnList count]; pos++)
+      NSAssert([[dnList objectAtIndex:pos] isKindOfClass:[NSString class]],
+         @"dnList must only contain NSString objects");
+   if ((attributes))
+   {
+      for(pos = 0; pos < [attributes count]; pos++)
+         NSAssert([[attributes objectAtIndex:pos] isKindOfClass:[NSString class]],
+            @"attributes must only contain NSString objects");
+   };
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initSearchWithSession:self baseDnList:dnList
+                  scope:scope filter:filter attributes:attributes
+                  attributesOnly:attributesOnly batchSize:batchSize
+                  entryHandler:entryHandler];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer
+{
+   return([self ldapSearchBaseDN:dn scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly writer:writer
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage * message;
+   NSArray   * dnList;
+   NSAssert((dn != nil), @"dn must not be nil");
+   dnList  = [[NSArray alloc] initWithObjects:dn, nil];
+   message = [self ldapSearchBaseDNList:dnList scope:scope filter:filter
+               attributes:attributes attributesOnly:attributesOnly writer:writer
+               queue:callbackQueue completionHandler:handler];
+   [dnList release];
+   return(message);
+}
+
+
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer
+{
+   return([self ldapSearchBaseDNList:dnList scope:scope filter:filter
+            attributes:attributes attributesOnly:attributesOnly writer:writer
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDNList:(NSArray *)dnList
+                scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+                attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly writer:(LKEntryWriter *)writer
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage  * message;
+   NSUInteger   pos;
+   NSAssert((dnList != nil), @"dnList must not be nil");
+   NSAssert((filter != nil), @"filter must not be nil");
+   NSAssert((writer != nil), @"writer must not be nil");
+   for(pos = 0; pos < [dnList count]; pos++)
+      NSAssert([[dnList objectAtIndex:pos] isKindOfClass:[NSString class]],
+         @"dnList must only contain NSString objects");
+   if ((attributes))
+   {
+      for(pos = 0; pos < [attributes count]; pos++)
+         NSAssert([[attributes objectAtIndex:pos] isKindOfClass:[NSString class]],
+            @"attributes must only contain NSString objects");
+   };
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initSearchWithSession:self baseDnList:dnList
+                  scope:scope filter:filter attributes:attributes
+                  attributesOnly:attributesOnly writer:writer];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys
+{
+   return([self ldapSearchBaseDN:dn scope:scope filter:filter attributes:attributes
+            sortKeys:sortKeys window:NSMakeRange(0, 0) contextID:nil
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   return([self ldapSearchBaseDN:dn scope:scope filter:filter attributes:attributes
+            sortKeys:sortKeys window:NSMakeRange(0, 0) contextID:nil
+            queue:callbackQueue completionHandler:handler]);
+}
+
+
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys window:(NSRange)window
+                contextID:(NSData *)contextID
+{
+   return([self ldapSearchBaseDN:dn scope:scope filter:filter attributes:attributes
+            sortKeys:sortKeys window:window contextID:contextID
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                sortKeys:(NSArray *)sortKeys window:(NSRange)window
+                contextID:(NSData *)contextID queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage  * message;
+   NSUInteger   pos;
+   NSAssert((dn != nil),                @"dn must not be nil");
+   NSAssert((filter != nil),            @"filter must not be nil");
+   NSAssert(([sortKeys count] > 0),     @"sortKeys must not be empty");
+   for(pos = 0; pos < [sortKeys count]; pos++)
+      NSAssert([[sortKeys objectAtIndex:pos] isKindOfClass:[NSString class]],
+         @"sortKeys must only contain NSString objects");
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initSearchWithSession:self baseDN:dn
+                  scope:scope filter:filter attributes:attributes
+                  sortKeys:sortKeys window:window contextID:contextID];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) ldapSearchUrl:(LKUrl *)url attributesOnly:(BOOL)attributesOnly
+{
+   return([self ldapSearchUrl:url attributesOnly:attributesOnly
+            queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSearchUrl:(LKUrl *)url attributesOnly:(BOOL)attributesOnly
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
    NSAssert((url != nil), @"url must not be nil");
+   return([self searchWithCacheBaseDN:url.ldapDn scope:url.ldapScope
+            filter:url.ldapFilter attributes:url.ldapAttributes
+            attributesOnly:attributesOnly queue:callbackQueue
+            completionHandler:handler]);
+}
+
+
+- (LKMessage *) ldapSyncBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                replica:(LKReplica *)replica persist:(BOOL)persist
+{
+   return([self ldapSyncBaseDN:base scope:scope filter:filter attributes:attributes
+            replica:replica persist:persist queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapSyncBaseDN:(NSString *)base scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                replica:(LKReplica *)replica persist:(BOOL)persist
+                queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage * message;
+   NSAssert((base != nil),    @"base must not be nil");
+   NSAssert((filter != nil),  @"filter must not be nil");
+   NSAssert((replica != nil), @"replica must not be nil");
    @synchronized(self)
    {
-      message = [[LKMessage alloc] initSearchWithSession:self baseDN:url.ldapDn
-                  scope:url.ldapScope filter:url.ldapFilter attributes:url.ldapAttributes
-                  attributesOnly:attributesOnly];
-      [queue addOperation:message];
+      message = [[LKMessage alloc] initSyncWithSession:self baseDN:base
+                  scope:scope filter:filter attributes:attributes
+                  replica:replica persist:persist];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
       return([message autorelease]);
    };
 }
@@ -679,6 +1801,14 @@
 - (LKMessage *) ldapRenameDN:(NSString *)dn newRDN:(NSString *)newrdn
         newSuperior:(NSString *)newSuperior
         deleteOldRDN:(NSInteger)deleteOldRDN
+{
+   return([self ldapRenameDN:dn newRDN:newrdn newSuperior:newSuperior
+            deleteOldRDN:deleteOldRDN queue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapRenameDN:(NSString *)dn newRDN:(NSString *)newrdn
+                newSuperior:(NSString *)newSuperior
+                deleteOldRDN:(NSInteger)deleteOldRDN queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
 {
    LKMessage * message;
    NSAssert((dn != nil), @"dn must not be nil");
@@ -687,31 +1817,76 @@
    {
       message = [[LKMessage alloc] initRenameWithSession:self dn:dn
          newRDN:newrdn newSuperior:newSuperior deleteOldRDN:deleteOldRDN];
-      [queue addOperation:message];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
+      return([message autorelease]);
+   };
+}
+
+
+- (LKMessage *) searchWithCacheBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+                filter:(NSString *)filter attributes:(NSArray *)attributes
+                attributesOnly:(BOOL)attributesOnly queue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
+{
+   LKMessage * message;
+   NSString  * key;
+   NSArray   * cached;
+   @synchronized(self)
+   {
+      message = [[LKMessage alloc] initSearchWithSession:self baseDN:dn
+                  scope:scope filter:filter attributes:attributes
+                  attributesOnly:attributesOnly];
+
+      // answers the search from the cache or records the state of the cache
+      // so that the result is only stored if no writes occur while searching
+      key = [ldapSearchCache keyForBaseDN:dn scope:scope filter:filter
+               attributes:attributes attributesOnly:attributesOnly
+               sizeLimit:self.ldapSearchSizeLimit];
+      if ((key))
+      {
+         if ((cached = [ldapSearchCache entriesForKey:key]) != nil)
+            [message setCachedEntries:cached];
+         else
+            [message setSearchCacheKey:key generation:[ldapSearchCache generation]];
+      };
+
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
       return([message autorelease]);
    };
 }
 
 
 - (LKMessage *) ldapRebind
+{
+   return([self ldapRebindWithQueue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapRebindWithQueue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
 {
    LKMessage * message;
+   [ldapSearchCache removeAllResults];
    @synchronized(self)
    {
       message = [[LKMessage alloc] initRebindWithSession:self];
-      [queue addOperation:message];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
       return([message autorelease]);
    };
 }
 
 
 - (LKMessage *) ldapUnbind
+{
+   return([self ldapUnbindWithQueue:NULL completionHandler:nil]);
+}
+- (LKMessage *) ldapUnbindWithQueue:(dispatch_queue_t)callbackQueue
+                completionHandler:(LKMessageCompletionHandler)handler
 {
    LKMessage * message;
+   [ldapSearchCache removeAllResults];
    @synchronized(self)
    {
       message = [[LKMessage alloc] initUnbindWithSession:self];
-      [queue addOperation:message];
+      [self enqueueMessage:message completionHandler:handler queue:callbackQueue];
       return([message autorelease]);
    };
 }
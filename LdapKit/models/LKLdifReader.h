@@ -0,0 +1,111 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKLdifReader parses LDIF files (RFC 2849) incrementally. Each record is
+ *  returned as an LKChange as it is read, so the memory used by the reader
+ *  depends on the size of the largest record instead of the size of the
+ *  file.
+ *
+ *  Content records and change records with a changetype of `add`, `delete`,
+ *  `modify`, `modrdn`, and `moddn` are supported. Values may be specified
+ *  directly, base64 encoded, or by a `file://` URL. Controls are ignored.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/LKEnumerations.h>
+
+@class LKChange;
+
+@interface LKLdifReader : NSObject
+{
+   // file information
+   NSString         * path;
+   int                fd;
+   BOOL               isEOF;
+
+   // read buffer
+   char             * buffer;
+   size_t             bufferSize;
+   size_t             bufferLen;
+   size_t             bufferPos;
+   NSMutableData    * line;
+
+   // parser state
+   NSUInteger         lineNumber;
+   NSUInteger         recordLineNumber;
+   NSUInteger         recordCount;
+   NSString         * errorMessage;
+}
+
+#pragma mark - Object Management Methods
+/// @name Object Management Methods
+
+/// Initialize a new reader for an LDIF file.
+///
+/// If the file cannot be opened, the error is reported by `errorMessage`
+/// and nextChange returns `nil`.
+/// @param path The path of the LDIF file.
+- (id) initWithPath:(NSString *)path;
+
+/// Creates a new reader for an LDIF file.
+/// @param path The path of the LDIF file.
++ (id) readerWithPath:(NSString *)path;
+
+
+#pragma mark - Reader information
+/// @name Reader information
+
+/// The path of the LDIF file.
+@property (nonatomic, readonly) NSString         * path;
+
+/// The number of the last line read from the file.
+@property (nonatomic, readonly) NSUInteger         lineNumber;
+
+/// The number of records returned by the reader.
+@property (nonatomic, readonly) NSUInteger         recordCount;
+
+/// A description of the error which stopped the reader, or `nil` if no error
+/// has occurred.
+@property (nonatomic, readonly) NSString         * errorMessage;
+
+
+#pragma mark - Reading records
+/// @name Reading records
+
+/// Reads the next record from the file.
+/// @return Returns an LKChange describing the record, or `nil` at the end of
+/// the file or if an error occurred.
+- (LKChange *) nextChange;
+
+@end
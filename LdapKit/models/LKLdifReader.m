@@ -0,0 +1,573 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKLdifReader.m - incremental LDIF parser
+ */
+#import "LKLdifReader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#import "LKBerValue.h"
+#import "LKChange.h"
+#import "LKMod.h"
+
+
+#define LK_LDIF_BUFFER_SIZE 65536
+
+
+@interface LKLdifReader ()
+
+/// @name Reading lines
+- (BOOL) appendPhysicalLine;
+- (int) peekByte;
+- (BOOL) readLine;
+
+/// @name Parsing records
+- (NSArray *) addModsWithNames:(NSArray *)names values:(NSArray *)values
+              index:(NSUInteger)pos;
+- (LKChange *) changeWithNames:(NSArray *)names values:(NSArray *)values;
+- (NSArray *) modifyModsWithNames:(NSArray *)names values:(NSArray *)values
+              index:(NSUInteger)pos;
+- (BOOL) parseLine:(NSString **)namep value:(NSData **)valuep;
+- (void) setErrorAtLine:(NSUInteger)number message:(NSString *)message;
+- (NSString *) stringWithValue:(NSData *)value;
+
+@end
+
+
+@implementation LKLdifReader
+
+// reader information
+@synthesize lineNumber;
+@synthesize recordCount;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // file information
+   [path release];
+   if (fd != -1)
+      close(fd);
+
+   // read buffer
+   free(buffer);
+   [line release];
+
+   // parser state
+   [errorMessage release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) initWithPath:(NSString *)filePath
+{
+   NSAssert((filePath != nil), @"path must not be nil");
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // file information
+   path = [filePath copy];
+   if ((fd = open([path fileSystemRepresentation], O_RDONLY)) == -1)
+   {
+      errorMessage = [[NSString alloc] initWithFormat:@"%@: %s", path, strerror(errno)];
+      return(self);
+   };
+
+   // read buffer
+   bufferSize = LK_LDIF_BUFFER_SIZE;
+   if ((buffer = malloc(bufferSize)) == NULL)
+   {
+      errorMessage = [[NSString alloc] initWithFormat:@"%@: %s", path, strerror(ENOMEM)];
+      return(self);
+   };
+   line = [[NSMutableData alloc] initWithCapacity:256];
+
+   return(self);
+}
+
+
++ (id) readerWithPath:(NSString *)filePath
+{
+   return([[[LKLdifReader alloc] initWithPath:filePath] autorelease]);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSString *) path
+{
+   return([[path retain] autorelease]);
+}
+
+
+- (NSString *) errorMessage
+{
+   return([[errorMessage retain] autorelease]);
+}
+
+
+#pragma mark - Reading records
+
+- (LKChange *) nextChange
+{
+   NSAutoreleasePool * pool;
+   NSMutableArray    * names;
+   NSMutableArray    * values;
+   NSString          * name;
+   NSData            * value;
+   LKChange          * change;
+   const char        * bytes;
+
+   if ((errorMessage))
+      return(nil);
+
+   pool   = [[NSAutoreleasePool alloc] init];
+   names  = [NSMutableArray arrayWithCapacity:16];
+   values = [NSMutableArray arrayWithCapacity:16];
+
+   // collects the lines of the next record, records are separated by blank
+   // lines and comments may appear anywhere
+   while ((errorMessage == nil) && ((([self readLine]))))
+   {
+      bytes = [line bytes];
+      if (![line length])
+      {
+         if (([names count]))
+            break;
+         continue;
+      };
+      if (bytes[0] == '#')
+         continue;
+      if (!([names count]))
+         recordLineNumber = lineNumber;
+      if (!([self parseLine:&name value:&value]))
+         break;
+
+      // the optional version line precedes the first record
+      if ( (!(recordCount)) && (!([names count])) &&
+           ([name caseInsensitiveCompare:@"version"] == NSOrderedSame) )
+      {
+         if (!([[self stringWithValue:value] isEqualToString:@"1"]))
+            [self setErrorAtLine:lineNumber message:@"unsupported LDIF version"];
+         continue;
+      };
+      [names  addObject:name];
+      [values addObject:value];
+   };
+
+   change = nil;
+   if ( (!(errorMessage)) && (([names count])) )
+   {
+      if ((change = [[self changeWithNames:names values:values] retain]) != nil)
+         recordCount++;
+   };
+
+   [pool release];
+
+   return([change autorelease]);
+}
+
+
+#pragma mark - Reading lines
+
+- (BOOL) appendPhysicalLine
+{
+   const char * start;
+   const char * end;
+   size_t       len;
+
+   // copies bytes from the buffer until the end of the line is found
+   while ([self peekByte] != -1)
+   {
+      start = &buffer[bufferPos];
+      len   = bufferLen - bufferPos;
+      if ((end = memchr(start, '\n', len)) != NULL)
+      {
+         [line appendBytes:start length:(size_t)(end - start)];
+         bufferPos += (size_t)(end - start) + 1;
+         break;
+      };
+      [line appendBytes:start length:len];
+      bufferPos = bufferLen;
+   };
+   lineNumber++;
+
+   // removes the carriage return of CRLF line endings
+   len = [line length];
+   if ( ((len)) && (((const char *)[line bytes])[len-1] == '\r') )
+      [line setLength:(len - 1)];
+
+   return(errorMessage == nil);
+}
+
+
+- (int) peekByte
+{
+   ssize_t len;
+
+   if (bufferPos < bufferLen)
+      return((unsigned char)buffer[bufferPos]);
+   if ((isEOF))
+      return(-1);
+
+   // refills the buffer with the next chunk of the file
+   bufferPos = 0;
+   bufferLen = 0;
+   while ((len = read(fd, buffer, bufferSize)) == -1)
+   {
+      if (errno == EINTR)
+         continue;
+      [self setErrorAtLine:lineNumber message:[NSString stringWithUTF8String:strerror(errno)]];
+      isEOF = YES;
+      return(-1);
+   };
+   if (len == 0)
+   {
+      isEOF = YES;
+      return(-1);
+   };
+   bufferLen = (size_t)len;
+
+   return((unsigned char)buffer[bufferPos]);
+}
+
+
+- (BOOL) readLine
+{
+   [line setLength:0];
+   if ([self peekByte] == -1)
+      return(NO);
+
+   // lines beginning with a single space continue the previous line
+   if (!([self appendPhysicalLine]))
+      return(NO);
+   while ([self peekByte] == ' ')
+   {
+      bufferPos++;
+      if (!([self appendPhysicalLine]))
+         return(NO);
+   };
+
+   return(YES);
+}
+
+
+#pragma mark - Parsing records
+
+- (NSArray *) addModsWithNames:(NSArray *)names values:(NSArray *)values
+              index:(NSUInteger)pos
+{
+   NSMutableArray      * mods;
+   NSMutableDictionary * types;
+   NSString            * name;
+   NSString            * key;
+   LKMod               * mod;
+
+   mods  = [NSMutableArray arrayWithCapacity:([names count] - pos)];
+   types = [NSMutableDictionary dictionaryWithCapacity:([names count] - pos)];
+
+   // the values of each attribute are collected in a single LKMod
+   for(; pos < [names count]; pos++)
+   {
+      name = [names objectAtIndex:pos];
+      if ([name isEqualToString:@"-"])
+      {
+         [self setErrorAtLine:recordLineNumber message:@"unexpected '-' in add record"];
+         return(nil);
+      };
+      key = [name lowercaseString];
+      if ((mod = [types objectForKey:key]) != nil)
+      {
+         [mod addValue:[values objectAtIndex:pos]];
+         continue;
+      };
+      mod = [LKMod modWithOperation:LKLdapModOperationAdd type:name
+               value:[values objectAtIndex:pos]];
+      [types setObject:mod forKey:key];
+      [mods addObject:mod];
+   };
+   if (!([mods count]))
+   {
+      [self setErrorAtLine:recordLineNumber message:@"add record does not contain attributes"];
+      return(nil);
+   };
+
+   return(mods);
+}
+
+
+- (LKChange *) changeWithNames:(NSArray *)names values:(NSArray *)values
+{
+   NSString   * dn;
+   NSString   * changeType;
+   NSString   * newRDN;
+   NSString   * newSuperior;
+   NSString   * deleteOldRDN;
+   NSArray    * mods;
+   NSUInteger   count;
+   NSUInteger   pos;
+
+   count = [names count];
+
+   // every record starts with the DN of the entry
+   if ([[names objectAtIndex:0] caseInsensitiveCompare:@"dn"] != NSOrderedSame)
+   {
+      [self setErrorAtLine:recordLineNumber message:@"record does not begin with a dn"];
+      return(nil);
+   };
+   if ((dn = [self stringWithValue:[values objectAtIndex:0]]) == nil)
+   {
+      [self setErrorAtLine:recordLineNumber message:@"invalid dn"];
+      return(nil);
+   };
+
+   // controls are ignored
+   for(pos = 1; pos < count; pos++)
+      if ([[names objectAtIndex:pos] caseInsensitiveCompare:@"control"] != NSOrderedSame)
+         break;
+
+   // records without a changetype contain the content of an entry
+   changeType = @"add";
+   if ( (pos < count) &&
+        ([[names objectAtIndex:pos] caseInsensitiveCompare:@"changetype"] == NSOrderedSame) )
+   {
+      changeType = [[self stringWithValue:[values objectAtIndex:pos]] lowercaseString];
+      pos++;
+   };
+
+   if ([changeType isEqualToString:@"add"])
+   {
+      if ((mods = [self addModsWithNames:names values:values index:pos]) == nil)
+         return(nil);
+      return([LKChange changeAddWithDN:dn attributes:mods]);
+   };
+
+   if ([changeType isEqualToString:@"delete"])
+   {
+      if (pos < count)
+      {
+         [self setErrorAtLine:recordLineNumber message:@"delete record contains attributes"];
+         return(nil);
+      };
+      return([LKChange changeDeleteWithDN:dn]);
+   };
+
+   if ([changeType isEqualToString:@"modify"])
+   {
+      if ((mods = [self modifyModsWithNames:names values:values index:pos]) == nil)
+         return(nil);
+      return([LKChange changeModifyWithDN:dn modifications:mods]);
+   };
+
+   if ( ([changeType isEqualToString:@"modrdn"]) || ([changeType isEqualToString:@"moddn"]) )
+   {
+      newRDN       = nil;
+      deleteOldRDN = nil;
+      newSuperior  = nil;
+      if ( (pos < count) &&
+           ([[names objectAtIndex:pos] caseInsensitiveCompare:@"newrdn"] == NSOrderedSame) )
+         newRDN = [self stringWithValue:[values objectAtIndex:pos++]];
+      if ( (pos < count) &&
+           ([[names objectAtIndex:pos] caseInsensitiveCompare:@"deleteoldrdn"] == NSOrderedSame) )
+         deleteOldRDN = [self stringWithValue:[values objectAtIndex:pos++]];
+      if ( (pos < count) &&
+           ([[names objectAtIndex:pos] caseInsensitiveCompare:@"newsuperior"] == NSOrderedSame) )
+         newSuperior = [self stringWithValue:[values objectAtIndex:pos++]];
+      if ( (!(newRDN)) || (!(deleteOldRDN)) || (pos < count) ||
+           ( (!([deleteOldRDN isEqualToString:@"0"])) && (!([deleteOldRDN isEqualToString:@"1"])) ) )
+      {
+         [self setErrorAtLine:recordLineNumber message:@"invalid modrdn record"];
+         return(nil);
+      };
+      return([LKChange changeRenameWithDN:dn newRDN:newRDN newSuperior:newSuperior
+               deleteOldRDN:[deleteOldRDN integerValue]]);
+   };
+
+   [self setErrorAtLine:recordLineNumber message:@"unsupported changetype"];
+
+   return(nil);
+}
+
+
+- (NSArray *) modifyModsWithNames:(NSArray *)names values:(NSArray *)values
+              index:(NSUInteger)pos
+{
+   NSMutableArray     * mods;
+   NSMutableArray     * modValues;
+   NSString           * name;
+   NSString           * type;
+   LKMod              * mod;
+   LKLdapModOperation   op;
+
+   mods      = [NSMutableArray arrayWithCapacity:4];
+   modValues = [NSMutableArray arrayWithCapacity:4];
+
+   // each modification names an attribute, lists its values, and ends with '-'
+   while (pos < [names count])
+   {
+      name = [names objectAtIndex:pos];
+      if ([name caseInsensitiveCompare:@"add"] == NSOrderedSame)
+         op = LKLdapModOperationAdd;
+      else if ([name caseInsensitiveCompare:@"delete"] == NSOrderedSame)
+         op = LKLdapModOperationDelete;
+      else if ([name caseInsensitiveCompare:@"replace"] == NSOrderedSame)
+         op = LKLdapModOperationReplace;
+      else
+      {
+         [self setErrorAtLine:recordLineNumber message:@"expected add, delete, or replace"];
+         return(nil);
+      };
+      if (!([(type = [self stringWithValue:[values objectAtIndex:pos]]) length]))
+      {
+         [self setErrorAtLine:recordLineNumber message:@"modification does not name an attribute"];
+         return(nil);
+      };
+
+      // collects the values of the modification
+      [modValues removeAllObjects];
+      for(pos++; pos < [names count]; pos++)
+      {
+         name = [names objectAtIndex:pos];
+         if ([name isEqualToString:@"-"])
+            break;
+         if ([name caseInsensitiveCompare:type] != NSOrderedSame)
+         {
+            [self setErrorAtLine:recordLineNumber message:@"value does not match the attribute of the modification"];
+            return(nil);
+         };
+         [modValues addObject:[values objectAtIndex:pos]];
+      };
+      pos++;
+
+      if ( (op == LKLdapModOperationAdd) && (!([modValues count])) )
+      {
+         [self setErrorAtLine:recordLineNumber message:@"add modification does not contain values"];
+         return(nil);
+      };
+      if (([modValues count]))
+         mod = [LKMod modWithOperation:op type:type values:modValues];
+      else
+         mod = [LKMod modWithOperation:op type:type];
+      [mods addObject:mod];
+   };
+
+   return(mods);
+}
+
+
+- (BOOL) parseLine:(NSString **)namep value:(NSData **)valuep
+{
+   const char * bytes;
+   size_t       len;
+   size_t       pos;
+   char         type;
+   NSString   * url;
+
+   bytes   = [line bytes];
+   len     = [line length];
+   *namep  = nil;
+   *valuep = nil;
+
+   // separates the modifications of a change record
+   if ((len == 1) && (bytes[0] == '-'))
+   {
+      *namep  = @"-";
+      *valuep = [NSData data];
+      return(YES);
+   };
+
+   // the attribute description is followed by ':', '::' or ':<'
+   for(pos = 0; (pos < len) && (bytes[pos] != ':'); pos++);
+   if ( (!(pos)) || (pos >= len) ||
+        ((*namep = [[[NSString alloc] initWithBytes:bytes length:pos
+                     encoding:NSUTF8StringEncoding] autorelease]) == nil) )
+   {
+      [self setErrorAtLine:lineNumber message:@"expected an attribute description followed by ':'"];
+      return(NO);
+   };
+   pos++;
+   type = (pos < len) ? bytes[pos] : '\0';
+   if ((type == ':') || (type == '<'))
+      pos++;
+   while ((pos < len) && (bytes[pos] == ' '))
+      pos++;
+
+   switch(type)
+   {
+      case ':':
+      if ((*valuep = [LKBerValue dataWithBase64Bytes:&bytes[pos]
+                        length:(len - pos)]) == nil)
+         [self setErrorAtLine:lineNumber message:@"invalid base64 value"];
+      break;
+
+      case '<':
+      url = [[[NSString alloc] initWithBytes:&bytes[pos] length:(len - pos)
+               encoding:NSUTF8StringEncoding] autorelease];
+      if ( (!([url hasPrefix:@"file://"])) ||
+           ((*valuep = [NSData dataWithContentsOfFile:[[NSURL URLWithString:url] path]]) == nil) )
+         [self setErrorAtLine:lineNumber message:@"unable to read value from URL"];
+      break;
+
+      default:
+      *valuep = [NSData dataWithBytes:&bytes[pos] length:(len - pos)];
+      break;
+   };
+
+   return(*valuep != nil);
+}
+
+
+- (void) setErrorAtLine:(NSUInteger)number message:(NSString *)message
+{
+   if ((errorMessage))
+      return;
+   errorMessage = [[NSString alloc] initWithFormat:@"%@:%lu: %@", path,
+                     (unsigned long)number, message];
+   return;
+}
+
+
+- (NSString *) stringWithValue:(NSData *)value
+{
+   return([[[NSString alloc] initWithData:value encoding:NSUTF8StringEncoding] autorelease]);
+}
+
+@end
@@ -67,19 +67,57 @@ enum ldap_kit_ldap_message_type
    LKLdapMessageTypeRename            = 0x06,
    LKLdapMessageTypeModify            = 0x07,
    LKLdapMessageTypeWhoAmI            = 0x08,
+   LKLdapMessageTypeBatch             = 0x09,
+   LKLdapMessageTypeAdd               = 0x0A,
+   LKLdapMessageTypeImport            = 0x0B,
+   LKLdapMessageTypeSync              = 0x0C,
+   LKLdapMessageTypePrewarm           = 0x0D,
    LKLdapMessageTypeUnknown           = 0x00
 };
 typedef enum ldap_kit_ldap_message_type LKLdapMessageType;
 
 
+@class LKAttributeTable;
+@class LKChange;
+@class LKConnection;
+@class LKEntryWriter;
 @class LKLdap;
+@class LKLdifReader;
+@class LKMessage;
+@class LKReplica;
+
+
+#pragma mark LDAP entry handler
+/// Block invoked by streaming searches with a batch of LKEntry objects.
+typedef void (^LKMessageEntryHandler)(LKMessage * message, NSArray * entries);
+
+#pragma mark LDAP progress handler
+/// Block invoked by batches of changes each time a change completes.
+typedef void (^LKMessageProgressHandler)(LKMessage * message, NSUInteger completed,
+                                         NSUInteger total);
+
+#pragma mark LDAP change handler
+/// Block invoked by imports each time a change completes.
+typedef void (^LKMessageChangeHandler)(LKMessage * message, LKChange * change);
+
+#pragma mark LDAP completion handler
+/// Block invoked once a message has finished.
+typedef void (^LKMessageCompletionHandler)(LKMessage * message);
 
 
 @interface LKMessage : NSOperation
 {
    // state information
    LKLdap                 * session;
+   LKConnection           * connection;
    LKLdapMessageType        messageType;
+   BOOL                     hasReconnected;
+   NSUInteger               failoverCount;
+
+   // connection timing
+   NSTimeInterval           bindConnectTime;
+   NSTimeInterval           bindStartTLSTime;
+   NSTimeInterval           bindAuthenticateTime;
 
    // error information
    NSInteger                errorCode;
@@ -114,6 +152,23 @@ typedef enum ldap_kit_ldap_message_type LKLdapMessageType;
    NSArray                * searchAttributes;
    BOOL                     searchAttributesOnly;
    LKLdapSearchScope        searchScope;
+   LKMessageEntryHandler    searchEntryHandler;
+   NSMutableArray         * searchEntryBatch;
+   NSUInteger               searchBatchSize;
+   NSInteger                searchPageSize;
+   NSMutableSet           * searchEntryDNs;
+   LKEntryWriter          * searchWriter;
+   NSString               * searchCacheKey;
+   NSUInteger               searchCacheGeneration;
+   BOOL                     searchIsCached;
+   NSArray                * searchSortKeys;
+   NSRange                  searchWindow;
+   NSData                 * searchContextID;
+   NSTimeInterval           searchRequestTime;
+
+   // synchronization information
+   LKReplica              * syncReplica;
+   BOOL                     syncPersist;
 
    // modify information
    NSString               * modifyDn;
@@ -122,14 +177,49 @@ typedef enum ldap_kit_ldap_message_type LKLdapMessageType;
    NSInteger                modifyDeleteOldRdn;
    NSArray                * modifyList;
 
+   // batch information
+   NSArray                * changeList;
+   NSUInteger               changeWindowSize;
+   NSUInteger               changesCompleted;
+   NSUInteger               changesFailed;
+   NSUInteger               changesSent;
+   LKMessageProgressHandler changeProgressHandler;
+   LKMessageChangeHandler   changeHandler;
+   LKLdifReader           * changeReader;
+   BOOL                     changeContinueOnError;
+
    // results
    NSMutableArray         * referrals;
    NSMutableArray         * entries;
    NSMutableArray         * matchedDNs;
+   NSUInteger               entryCount;
+   LKAttributeTable       * attributeTable;
+
+   // virtual list view results
+   NSUInteger               vlvOffset;
+   NSUInteger               vlvContentCount;
+   NSData                 * vlvContextID;
 
    // client information
    NSInteger                tag;
    id                       object;
+
+   // cancellation information
+   int                      cancelPipe[2];
+   BOOL                     hasCancelPipe;
+
+   // multiplexing information
+   NSCondition            * mailboxCondition;
+   NSMutableArray         * mailbox;
+   NSInteger                mailboxError;
+   NSMutableSet           * mailboxMessageIDs;
+
+   // metrics information
+   struct ldap_kit_metrics_sample * metricsSample;
+
+   // completion information
+   LKMessageCompletionHandler completionHandler;
+   dispatch_queue_t           callbackQueue;
 }
 
 #pragma mark - Message information
@@ -141,17 +231,43 @@ typedef enum ldap_kit_ldap_message_type LKLdapMessageType;
 ///
 /// LKLdapMessageType         | Description
 /// --------------------------|-------------------------
+/// `LKLdapMessageTypeAdd`    | LDAP add request
+/// `LKLdapMessageTypeBatch`  | batch of LDAP write requests
 /// `LKLdapMessageTypeBind`   | LDAP bind request
 /// `LKLdapMessageTypeDelete` | LDAP delete request
+/// `LKLdapMessageTypeImport` | LDAP write requests read from an LDIF file
 /// `LKLdapMessageTypeModify` | LDAP modify request
+/// `LKLdapMessageTypePrewarm`| connection opened before it is needed
 /// `LKLdapMessageTypeRename` | LDAP rename request
 /// `LKLdapMessageTypeRebind` | LDAP unbind and bind request
 /// `LKLdapMessageTypeSearch` | LDAP search request
+/// `LKLdapMessageTypeSync`   | LDAP content synchronization of a replica
 /// `LKLdapMessageTypeUnbind` | LDAP unbind request
 /// `LKLdapMessageTypeWhoAmI` | LDAP whoami request
 @property (nonatomic, readonly) LKLdapMessageType        messageType;
 
 
+#pragma mark - Connection timing
+/// @name Connection timing
+
+/// The number of seconds spent initializing the LDAP handle and connecting
+/// to the server while the message opened a connection.
+///
+/// The connection timing properties are zero if the message used a
+/// connection which was already open. If the OpenLDAP library does not
+/// provide ldap_connect(), the TCP connection is opened by the next phase
+/// and included in its time.
+@property (nonatomic, readonly) NSTimeInterval           bindConnectTime;
+
+/// The number of seconds spent negotiating TLS with the StartTLS extended
+/// operation while the message opened a connection.
+@property (nonatomic, readonly) NSTimeInterval           bindStartTLSTime;
+
+/// The number of seconds spent authenticating while the message opened or
+/// re-authenticated a connection.
+@property (nonatomic, readonly) NSTimeInterval           bindAuthenticateTime;
+
+
 #pragma mark - Errors
 /// @name Errors
 
@@ -178,6 +294,9 @@ typedef enum ldap_kit_ldap_message_type LKLdapMessageType;
 /// @name Results
 
 /// An array of LKEntry objects returned by a search request.
+///
+/// Streaming searches pass entries to their entry handler or writer instead,
+/// and this property is `nil` for such searches.
 @property (nonatomic, readonly) NSArray                * entries;
 
 /// An array of LDAP referrals returned by an LDAP request.
@@ -185,6 +304,39 @@ typedef enum ldap_kit_ldap_message_type LKLdapMessageType;
 
 @property (nonatomic, readonly) NSArray                * matchedDNs;
 
+/// An array of the LKChange objects submitted by a batch of changes. The
+/// result of each change is stored in the LKChange object.
+///
+/// Imports do not retain their changes and this property is `nil` for such
+/// messages.
+@property (nonatomic, readonly) NSArray                * changes;
+
+/// The number of changes in a batch for which a result has been received.
+@property (atomic, readonly)    NSUInteger               changesCompleted;
+
+/// The number of changes in a batch which were not applied successfully.
+@property (atomic, readonly)    NSUInteger               changesFailed;
+
+
+#pragma mark - Virtual list view
+/// @name Virtual list view
+
+/// The position (starting at 0) of the first entry of a windowed search in
+/// the sorted result, as reported by the directory server.
+@property (nonatomic, readonly) NSUInteger               vlvOffset;
+
+/// The number of entries in the sorted result of a windowed search, as
+/// estimated by the directory server.
+@property (nonatomic, readonly) NSUInteger               vlvContentCount;
+
+/// The context ID returned by the directory server for a windowed search.
+///
+/// Passing the context ID to the next windowed search of the same result
+/// allows the server to reuse the sorted result instead of sorting the
+/// entries again. The value is `nil` if the server did not return a
+/// context ID.
+@property (nonatomic, readonly) NSData                 * vlvContextID;
+
 
 #pragma mark - Identifying the LKMessage
 /// @name Identifying the LKMessage
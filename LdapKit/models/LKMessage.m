@@ -40,12 +40,34 @@
 #import <signal.h>
 #import <sasl/sasl.h>
 #include <sys/socket.h>
-
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#import "LKAttributeTable.h"
+#import "LKChange.h"
+#import "LKChangeCategory.h"
+#import "LKConnection.h"
 #import "LKEntry.h"
 #import "LKEntryCategory.h"
+#import "LKEntryWriter.h"
+#import "LKEntryWriterCategory.h"
+#import "LKHedgePolicy.h"
+#import "LKHedgePolicyCategory.h"
 #import "LKLdap.h"
 #import "LKLdapCategory.h"
+#import "LKLdifReader.h"
+#import "LKMetrics.h"
+#import "LKMetricsCategory.h"
 #import "LKMod.h"
+#import "LKReplica.h"
+#import "LKReplicaCategory.h"
+#import "LKScheduler.h"
+#import "LKSchedulerCategory.h"
+#import "LKSearchCache.h"
+#import "LKSearchCacheCategory.h"
+#import "LKServer.h"
+#import "LKServerCategory.h"
 
 
 #pragma mark - Data Types
@@ -74,32 +96,85 @@ typedef struct ldap_kit_ldap_auth_data LKLdapAuthData;
 /// @name copies LDAP information
 - (void) copySessionInformation;
 
+/// @name cancellation
+- (BOOL) openCancelPipe;
+
+/// @name connection health
+- (BOOL) failoverAfterError;
+- (BOOL) reconnectAfterError;
+- (void) recordResponseLatencySince:(NSTimeInterval)start;
+- (void) updateConnectionHealth;
+
+/// @name search cache
+- (void) removeCachedResults;
+
+/// @name metrics
+- (void) metricsAddPhase:(LKMetricsPhase)phase start:(NSTimeInterval)start;
+- (NSTimeInterval) metricsStart;
+- (void) recordMetrics;
+
+/// @name multiplexing
+- (void) abandonMessageID:(int)msgid;
+- (void) registerMessageID:(int)msgid;
+- (LDAPMessage *) resultFromMailboxWithResultEntries:(NSMutableArray *)resultEntries;
+
 /// @name LDAP tasks
+- (BOOL) ldapAdd;
+- (BOOL) ldapBatch;
 - (BOOL) ldapBind;
 - (BOOL) ldapDelete;
 - (BOOL) ldapModify;
 - (BOOL) ldapRename;
 - (BOOL) ldapSearch;
+- (BOOL) ldapSearchBaseDN:(NSString *)baseDN attributes:(char **)attrs;
+- (BOOL) ldapSearchBaseDNList:(NSArray *)dnList attributes:(char **)attrs;
+- (BOOL) ldapSync;
 - (BOOL) ldapTestConnection;
 - (BOOL) ldapRebind;
 - (BOOL) ldapUnbind;
 
 /// @name LDAP subtasks
+- (int) addDN:(NSString *)dn mods:(NSArray *)mods;
 - (LDAP *) bindAuthenticate:(LDAP *)ld;
+- (BOOL) bindConnection;
 - (LDAP *) bindFinish:(LDAP *)ld;
 - (LDAP *) bindInitialize;
 - (LDAP *) bindStartTLS:(LDAP *)ld;
+- (void) completeChange:(LKChange *)change total:(NSUInteger)total;
 - (int) deleteDN:(NSString *)dn;
+- (int) hedgeSearchBaseDN:(NSString *)dn attributes:(char **)attrs
+        messageID:(int)msgid;
 - (int) modifyDN:(NSString *)dn mods:(NSArray *)mods;
 - (int) renameDN:(NSString *)dn newRDN:(NSString *)rdn
         newSuperior:(NSString *)newSuperior
         deleteOldRDN:(NSInteger)deleteOldRDN;
-- (BOOL)   parseResult:(LDAPMessage *)res referrals:(NSMutableArray *)referrals;
+- (LKEntry *) newEntryWithMessage:(LDAPMessage *)msg;
+- (void) receiveEntry:(LDAPMessage *)msg batch:(NSMutableArray *)batch;
+- (BOOL) isDuplicateEntryDN:(NSString *)dn;
+- (BOOL)   parseResult:(LDAPMessage *)res referrals:(NSMutableArray *)referrals
+           controls:(LDAPControl ***)controls;
+- (void)   parseReference:(LDAPMessage *)msg;
+- (void)   receiveIntermediate:(LDAPMessage *)msg;
 - (LDAPMessage *) resultWithMessageID:(int)msgid
                   resultEntries:(NSMutableArray *)resultEntries;
+- (void) storeEntries:(NSMutableArray *)batch
+         resultEntries:(NSMutableArray *)resultEntries;
+- (void) flushEntries;
 - (int)  searchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
          filter:(NSString *)filter attributes:(char **)attrs
-         attributesOnly:(BOOL)attributesOnly;
+         attributesOnly:(BOOL)attributesOnly cookie:(struct berval *)cookie;
+- (LKChange *) nextChange;
+- (int)  sendChange:(LKChange *)change;
+
+/// @name sort subtasks
+- (int)  createSortControls:(LDAPControl **)ctrls;
+- (void) parseSortControls:(LDAPControl **)ctrls;
+
+/// @name synchronization subtasks
+- (void) receiveSyncDone:(LDAPControl **)ctrls;
+- (void) receiveSyncEntry:(LDAPMessage *)msg;
+- (int)  syncBaseDN:(NSString *)dn attributes:(char **)attrs;
+- (NSData *) syncCookieWithBer:(BerElement *)ber;
 
 /// @name memory methods
 - (char **) newAttributeArray:(NSArray *)attributes;
@@ -118,6 +193,16 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 // state information
 @synthesize messageType;
 
+// virtual list view results
+@synthesize vlvOffset;
+@synthesize vlvContentCount;
+@synthesize vlvContextID;
+
+// connection timing
+@synthesize bindConnectTime;
+@synthesize bindStartTLSTime;
+@synthesize bindAuthenticateTime;
+
 // error information
 @synthesize errorCode;
 @synthesize errorTitle;
@@ -133,8 +218,11 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 
 - (void) dealloc
 {
+   NSValue * value;
+
    // server state
-   [session release];
+   [session    release];
+   [connection release];
 
    // server information
    [ldapURI release];
@@ -149,9 +237,19 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    [ldapBindSaslRealm         release];
 
    // search information
-   [searchDnList     release];
-   [searchFilter     release];
-   [searchAttributes release];
+   [searchDnList       release];
+   [searchFilter       release];
+   [searchAttributes   release];
+   [searchEntryHandler release];
+   [searchEntryBatch   release];
+   [searchEntryDNs     release];
+   [searchWriter       release];
+   [searchCacheKey     release];
+   [searchSortKeys     release];
+   [searchContextID    release];
+
+   // synchronization information
+   [syncReplica release];
 
    // modify information
    [modifyDn          release];
@@ -159,12 +257,43 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    [modifyNewSuperior release];
    [modifyList        release];
 
+   // batch information
+   [changeList            release];
+   [changeProgressHandler release];
+   [changeHandler         release];
+   [changeReader          release];
+
    // results
-   [referrals release];
+   [referrals      release];
+   [entries        release];
+   [attributeTable release];
+   [vlvContextID   release];
 
    // client information
    [object release];
 
+   // cancellation information
+   if ((hasCancelPipe))
+   {
+      close(cancelPipe[0]);
+      close(cancelPipe[1]);
+   };
+
+   // multiplexing information
+   for(value in mailbox)
+      ldap_msgfree([value pointerValue]);
+   [mailbox           release];
+   [mailboxCondition  release];
+   [mailboxMessageIDs release];
+
+   // metrics information
+   free(metricsSample);
+
+   // completion information
+   [completionHandler release];
+   if ((callbackQueue))
+      dispatch_release(callbackQueue);
+
    [super dealloc];
 
    return;
@@ -202,6 +331,25 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 }
 
 
+- (id) initAddWithSession:(LKLdap *)data dn:(NSString *)dn
+       mods:(NSArray *)mods
+{
+   // initialize super
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // state information
+   session     = [data retain];
+   messageType = LKLdapMessageTypeAdd;
+
+   // modify information
+   modifyDn   = [[NSString alloc] initWithString:dn];
+   modifyList = [[NSArray alloc] initWithArray:mods copyItems:YES];
+
+   return(self);
+}
+
+
 - (id) initDeleteWithSession:(LKLdap *)data dn:(NSString *)dn
 {
    // initialize super
@@ -296,6 +444,164 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 
    return(self);
 }
+- (id) initSearchWithSession:(LKLdap *)data baseDnList:(NSArray *)dnList
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes attributesOnly:(BOOL)attributesOnly
+       batchSize:(NSUInteger)batchSize entryHandler:(LKMessageEntryHandler)handler
+{
+   if ((self = [self initSearchWithSession:data baseDnList:dnList scope:scope
+         filter:filter attributes:attributes attributesOnly:attributesOnly]) == nil)
+      return(self);
+
+   // streaming information
+   searchEntryHandler = [handler copy];
+   searchEntryBatch   = [[NSMutableArray alloc] initWithCapacity:batchSize];
+   searchBatchSize    = batchSize;
+
+   return(self);
+}
+
+
+- (id) initSearchWithSession:(LKLdap *)data baseDnList:(NSArray *)dnList
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes attributesOnly:(BOOL)attributesOnly
+       uniqueEntries:(BOOL)uniqueEntries
+{
+   if ((self = [self initSearchWithSession:data baseDnList:dnList scope:scope
+         filter:filter attributes:attributes attributesOnly:attributesOnly]) == nil)
+      return(self);
+
+   // tracks the DNs of returned entries to remove duplicates
+   if ((uniqueEntries))
+      searchEntryDNs = [[NSMutableSet alloc] init];
+
+   return(self);
+}
+
+
+- (id) initSearchWithSession:(LKLdap *)data baseDnList:(NSArray *)dnList
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes attributesOnly:(BOOL)attributesOnly
+       writer:(LKEntryWriter *)writer
+{
+   if ((self = [self initSearchWithSession:data baseDnList:dnList scope:scope
+         filter:filter attributes:attributes attributesOnly:attributesOnly]) == nil)
+      return(self);
+
+   // export information
+   searchWriter = [writer retain];
+
+   // an entry returned by more than one base DN is only written once
+   if ([dnList count] > 1)
+      searchEntryDNs = [[NSMutableSet alloc] init];
+
+   return(self);
+}
+
+
+- (id) initSearchWithSession:(LKLdap *)data baseDN:(NSString *)dn
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes sortKeys:(NSArray *)sortKeys
+       window:(NSRange)window contextID:(NSData *)contextID
+{
+   if ((self = [self initSearchWithSession:data baseDN:dn scope:scope
+         filter:filter attributes:attributes attributesOnly:NO]) == nil)
+      return(self);
+
+   // sort information
+   searchSortKeys  = [[NSArray alloc] initWithArray:sortKeys copyItems:YES];
+   searchWindow    = window;
+   searchContextID = [contextID copy];
+
+   return(self);
+}
+
+
+- (id) initSyncWithSession:(LKLdap *)data baseDN:(NSString *)dn
+       scope:(LKLdapSearchScope)scope filter:(NSString *)filter
+       attributes:(NSArray *)attributes replica:(LKReplica *)replica
+       persist:(BOOL)persist
+{
+   if ((self = [self initSearchWithSession:data baseDN:dn scope:scope
+         filter:filter attributes:attributes attributesOnly:NO]) == nil)
+      return(self);
+
+   // state information
+   messageType = LKLdapMessageTypeSync;
+
+   // synchronization information
+   syncReplica = [replica retain];
+   syncPersist = persist;
+
+   return(self);
+}
+
+
+- (id) initBatchWithSession:(LKLdap *)data changes:(NSArray *)changes
+       windowSize:(NSUInteger)windowSize
+       progressHandler:(LKMessageProgressHandler)handler
+{
+   // initialize super
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // state information
+   session     = [data retain];
+   messageType = LKLdapMessageTypeBatch;
+
+   // resets error
+   [self resetError];
+
+   // batch information
+   changeList            = [[NSArray alloc] initWithArray:changes];
+   changeWindowSize      = windowSize;
+   changeProgressHandler = [handler copy];
+   changeContinueOnError = YES;
+
+   return(self);
+}
+
+
+- (id) initImportWithSession:(LKLdap *)data reader:(LKLdifReader *)reader
+       windowSize:(NSUInteger)windowSize continueOnError:(BOOL)continueOnError
+       changeHandler:(LKMessageChangeHandler)handler
+{
+   // initialize super
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // state information
+   session     = [data retain];
+   messageType = LKLdapMessageTypeImport;
+
+   // resets error
+   [self resetError];
+
+   // batch information
+   changeReader          = [reader retain];
+   changeWindowSize      = windowSize;
+   changeHandler         = [handler copy];
+   changeContinueOnError = continueOnError;
+
+   return(self);
+}
+
+
+- (id) initPrewarmWithSession:(LKLdap *)data
+{
+   // initialize super
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // state information
+   session     = [data retain];
+   messageType = LKLdapMessageTypePrewarm;
+
+   // resets error
+   [self resetError];
+
+   return(self);
+}
 
 
 - (id) initRebindWithSession:(LKLdap *)data
@@ -357,6 +663,30 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 }
 
 
+- (NSArray *) changes
+{
+   return([[changeList retain] autorelease]);
+}
+
+
+- (NSUInteger) changesCompleted
+{
+   @synchronized(self)
+   {
+      return(changesCompleted);
+   };
+}
+
+
+- (NSUInteger) changesFailed
+{
+   @synchronized(self)
+   {
+      return(changesFailed);
+   };
+}
+
+
 - (NSArray *) entries
 {
    @synchronized(self)
@@ -383,6 +713,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    pool = [[NSAutoreleasePool alloc] init];
    @synchronized(self)
    {
+      [errorMessage release];
       errorCode = code;
       errorMessage = [[NSString stringWithUTF8String:ldap_err2string(code)] retain];
    };
@@ -505,19 +836,41 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 - (void) copySessionInformation
 {
    NSAutoreleasePool * pool;
+   LKServer          * server;
 
    pool = [[NSAutoreleasePool alloc] init];
 
-   // server information
+   // server information, a connection routed to one of several servers
+   // connects to the server it was opened for
+   server = connection.server;
    [ldapURI release];
-   ldapURI             = [session.ldapURI retain];
-   ldapProtocolScheme  = session.ldapProtocolScheme;
+   ldapURI             = [(((server)) ? server.uri : session.ldapURI) retain];
+   ldapProtocolScheme  = ((server)) ? server.protocolScheme : session.ldapProtocolScheme;
    ldapProtocolVersion = session.ldapProtocolVersion;
 
    // encryption information
    [ldapCACertificateFile release];
    ldapEncryptionScheme  = session.ldapEncryptionScheme;
    ldapCACertificateFile = [session.ldapCACertificateFile retain];
+   if ((server))
+   {
+      switch(server.protocolScheme)
+      {
+         case LKLdapProtocolSchemeLDAPS:
+         ldapEncryptionScheme = LKLdapEncryptionSchemeSSL;
+         break;
+
+         case LKLdapProtocolSchemeLDAPI:
+         ldapEncryptionScheme = LKLdapEncryptionSchemeNone;
+         break;
+
+         // a server without SSL still requires encryption
+         default:
+         if (ldapEncryptionScheme == LKLdapEncryptionSchemeSSL)
+            ldapEncryptionScheme = LKLdapEncryptionSchemeTLS;
+         break;
+      };
+   };
 
    // timeout information
    ldapSearchSizeLimit = session.ldapSearchSizeLimit;
@@ -541,109 +894,828 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 }
 
 
-#pragma mark - non-concurrent tasks
+#pragma mark - cancellation
 
-- (void) main
+- (void) cancel
 {
-   NSAutoreleasePool * pool;
+   [super cancel];
 
-   // add signal handlers
-   signal(SIGPIPE, SIG_IGN);
-
-   pool = [[NSAutoreleasePool alloc] init];
+   // wakes any thread waiting on the LDAP socket. A full pipe already wakes
+   // the waiting thread, so EAGAIN is not an error.
+   @synchronized(self)
+   {
+      if ((hasCancelPipe))
+         while ( (write(cancelPipe[1], "", 1) == -1) && (errno == EINTR) )
+            continue;
+   };
 
-   switch(messageType)
+   // wakes the message if it is waiting on the dispatcher
+   @synchronized(self)
    {
-      case LKLdapMessageTypeBind:
-      [self ldapBind];
-      break;
+      [mailboxCondition lock];
+      [mailboxCondition broadcast];
+      [mailboxCondition unlock];
+   };
 
-      case LKLdapMessageTypeDelete:
-      [self ldapDelete];
-      self.errorTitle = @"LDAP Delete";
-      break;
+   // wakes the message if it is waiting for a connection
+   [session signalConnectionWaiters];
 
-      case LKLdapMessageTypeModify:
-      [self ldapModify];
-      self.errorTitle = @"LDAP Modify";
-      break;
+   // removes the message from its scheduler lane if it has not started
+   [session.ldapScheduler cancelMessage:self];
 
-      case LKLdapMessageTypeRename:
-      [self ldapRename];
-      self.errorTitle = @"LDAP Modify RDN";
-      break;
+   return;
+}
 
-      case LKLdapMessageTypeSearch:
-      [self ldapSearch];
-      self.errorTitle = @"LDAP Search";
-      break;
 
-      case LKLdapMessageTypeRebind:
-      [self ldapRebind];
-      break;
+- (BOOL) openCancelPipe
+{
+   @synchronized(self)
+   {
+      if ((hasCancelPipe))
+         return(YES);
 
-      case LKLdapMessageTypeUnbind:
-      [self ldapUnbind];
-      self.errorTitle = @"LDAP unbind";
-      break;
+      if (pipe(cancelPipe) == -1)
+      {
+         [self resetErrorWithTitle:@"Internal LDAP Error" andCode:LDAP_OTHER];
+         self.errorMessage = [NSString stringWithUTF8String:strerror(errno)];
+         return(NO);
+      };
 
-      default:
-      break;
-   };
+      // a full pipe already has a pending wake up, so writes never block
+      fcntl(cancelPipe[0], F_SETFL, O_NONBLOCK);
+      fcntl(cancelPipe[1], F_SETFL, O_NONBLOCK);
+      fcntl(cancelPipe[0], F_SETFD, FD_CLOEXEC);
+      fcntl(cancelPipe[1], F_SETFD, FD_CLOEXEC);
 
-   [pool release];
+      hasCancelPipe = YES;
+   };
 
-   return;
+   return(YES);
 }
 
 
-#pragma mark - LDAP tasks
+#pragma mark - connection health
 
-- (BOOL) ldapBind
+- (BOOL) failoverAfterError
 {
-   BOOL                isConnected;
-   LDAP              * ld;
-
-   // reset errors
-   [self resetErrorWithTitle:@"LDAP initialize"];
+   LKServer * server;
 
-   // checks for existing connection
-   isConnected = [self ldapTestConnection];
-   if ((isConnected))
-      return(self.isSuccessful);
+   // only connections routed to one of several servers fail over
+   if ((server = connection.server) == nil)
+      return(NO);
    if ((self.isCancelled))
+      return(NO);
+
+   // only errors caused by an unavailable server are counted against it
+   switch(self.errorCode)
+   {
+      case LDAP_SERVER_DOWN:
+      case LDAP_CONNECT_ERROR:
+      case LDAP_TIMEOUT:
+      break;
+
+      default:
+      return(NO);
+   };
+   [server recordFailureWithRetryInterval:session.ldapServerRetryInterval];
+
+   // writes are only sent to the primary server, and each server is only
+   // tried once
+   if (([self requiresPrimaryServer]))
+      return(NO);
+   if ((failoverCount + 1) >= [session.ldapServers count])
+      return(NO);
+   failoverCount++;
+
+   // returns the connection and borrows a connection to the next server
+   [session checkinConnection:connection];
+   [connection release];
+   connection = [[session checkoutConnectionForMessage:self] retain];
+   if (!(connection))
    {
       [self resetErrorWithTitle:@"LDAP Error" andCode:LDAP_USER_CANCELLED];
-      return(self.isSuccessful);
+      return(NO);
    };
 
-   // copies data required to BIND to LDAP
-   [self copySessionInformation];
+   return(YES);
+}
 
-   // obtain the lock for LDAP handle
-   @synchronized(session)
-   {
-      // initialize LDAP handle
-      if ((ld = [self bindInitialize]) == NULL)
-         return(self.isSuccessful);
 
-      // starts TLS session
-      if ((ld = [self bindStartTLS:ld]) == NULL)
-         return(self.isSuccessful);
+- (BOOL) reconnectAfterError
+{
+   // an operation is only replayed once
+   if ((hasReconnected))
+      return(NO);
+   if ((self.isCancelled))
+      return(NO);
 
-      // binds to LDAP
-      if ((ld = [self bindAuthenticate:ld]) == NULL)
-         return(self.isSuccessful);
+   // only errors caused by a closed connection are recoverable, a read
+   // which timed out is replayed on another server
+   switch(self.errorCode)
+   {
+      case LDAP_SERVER_DOWN:
+      case LDAP_CONNECT_ERROR:
+      case LDAP_UNAVAILABLE:
+      break;
 
-      // finish configuring connection
-      if ((ld = [self bindFinish:ld]) == NULL)
-         return(self.isSuccessful);
+      case LDAP_TIMEOUT:
+      if ( (!(connection.server)) || ([self requiresPrimaryServer]) )
+         return(NO);
+      break;
 
-      // saves LDAP handle
-      session.ld          = ld;
-      session.isConnected = YES;
+      default:
+      return(NO);
+   };
+   hasReconnected = YES;
+   if ((metricsSample))
+      metricsSample->reconnects++;
+
+   // ldapBind reopens the connection after it has been marked as down and
+   // moves to another server if the server refuses the new connection
+   connection.isConnected = NO;
+
+   // a server which stopped responding is not tried again
+   if ( (self.errorCode == LDAP_TIMEOUT) && (!([self failoverAfterError])) )
+      return(NO);
+
+   return([self ldapBind]);
+}
+
+
+- (void) recordResponseLatencySince:(NSTimeInterval)start
+{
+   NSTimeInterval latency;
+
+   // responses to pipelined batches may arrive while later changes are sent
+   // and a persisting synchronization waits for changes, so neither
+   // measures the response time of the server
+   if ( ((syncPersist)) || (messageType == LKLdapMessageTypeBatch) ||
+        (messageType == LKLdapMessageTypeImport) )
+      return;
+   latency = [NSDate timeIntervalSinceReferenceDate] - start;
+
+   [connection.server recordLatency:latency];
+
+   // the hedge delay is calculated from the response times of searches
+   if (messageType == LKLdapMessageTypeSearch)
+      [session.ldapHedgePolicy recordLatency:latency];
+
+   return;
+}
+
+
+- (void) updateConnectionHealth
+{
+   // must be called while holding the lock of the connection
+   switch(self.errorCode)
+   {
+      case LDAP_SERVER_DOWN:
+      case LDAP_CONNECT_ERROR:
+      connection.isConnected = NO;
+      break;
+
+      default:
+      break;
+   };
+   return;
+}
+
+
+#pragma mark - multiplexing
+
+- (void) abandonMessageID:(int)msgid
+{
+   NSNumber * key;
+
+   // stops routing responses before abandoning the request
+   key = [[NSNumber alloc] initWithInt:msgid];
+   if ([mailboxMessageIDs containsObject:key])
+   {
+      [connection unregisterMessageID:msgid];
+      [mailboxMessageIDs removeObject:key];
+   };
+   [key release];
+
+   @synchronized(connection)
+   {
+      if ((connection.ld))
+         ldap_abandon_ext(connection.ld, msgid, NULL, NULL);
+   };
+
+   return;
+}
+
+
+- (void) deliverErrorCode:(int)err
+{
+   [mailboxCondition lock];
+   mailboxError = err;
+   [mailboxCondition signal];
+   [mailboxCondition unlock];
+   return;
+}
+
+
+- (void) deliverResult:(LDAPMessage *)res
+{
+   [mailboxCondition lock];
+   [mailbox addObject:[NSValue valueWithPointer:res]];
+   [mailboxCondition signal];
+   [mailboxCondition unlock];
+   return;
+}
+
+
+- (void) registerMessageID:(int)msgid
+{
+   NSValue * value;
+
+   // must be called while holding the lock of the connection which sent the request
+   if (self.errorCode != LDAP_SUCCESS)
+      return;
+   if (!(connection.isDispatching))
+      return;
+
+   // creates the mailbox used to receive responses from the dispatcher
+   @synchronized(self)
+   {
+      if (!(mailboxCondition))
+      {
+         mailboxCondition  = [[NSCondition alloc] init];
+         mailbox           = [[NSMutableArray alloc] initWithCapacity:64];
+         mailboxMessageIDs = [[NSMutableSet alloc] initWithCapacity:1];
+      };
+   };
+
+   // discards anything left over from a previous set of requests
+   if (!([mailboxMessageIDs count]))
+   {
+      [mailboxCondition lock];
+      for(value in mailbox)
+         ldap_msgfree([value pointerValue]);
+      [mailbox removeAllObjects];
+      mailboxError = LDAP_SUCCESS;
+      [mailboxCondition unlock];
+   };
+
+   if (([connection registerMessage:self forMessageID:msgid]))
+      [mailboxMessageIDs addObject:[NSNumber numberWithInt:msgid]];
+
+   return;
+}
+
+
+#pragma mark - search cache
+
+- (void) removeCachedResults
+{
+   LKSearchCache * cache;
+
+   cache = session.ldapSearchCache;
+   switch(messageType)
+   {
+      case LKLdapMessageTypeAdd:
+      case LKLdapMessageTypeDelete:
+      case LKLdapMessageTypeModify:
+      [cache removeResultsForDN:modifyDn];
+      break;
+
+      case LKLdapMessageTypeRename:
+      [cache removeResultsForRenamedDN:modifyDn newRDN:modifyNewRdn
+         newSuperior:modifyNewSuperior];
+      break;
+
+      default:
+      break;
+   };
+
+   return;
+}
+
+
+- (void) setCachedEntries:(NSArray *)cached
+{
+   @synchronized(self)
+   {
+      searchIsCached = YES;
+      if ([cached count] > 0)
+         entries = [[NSMutableArray alloc] initWithArray:cached];
+   };
+   return;
+}
+
+
+- (void) setSearchCacheKey:(NSString *)key generation:(NSUInteger)generation
+{
+   @synchronized(self)
+   {
+      [searchCacheKey release];
+      searchCacheKey        = [key copy];
+      searchCacheGeneration = generation;
+   };
+   return;
+}
+
+
+#pragma mark - scheduling
+
+- (NSUInteger) schedulerLaneWithInteractiveSizeLimit:(NSInteger)limit
+{
+   NSInteger sizeLimit;
+
+   switch(messageType)
+   {
+      case LKLdapMessageTypeAdd:
+      case LKLdapMessageTypeBatch:
+      case LKLdapMessageTypeDelete:
+      case LKLdapMessageTypeImport:
+      case LKLdapMessageTypeModify:
+      case LKLdapMessageTypeRename:
+      return(LKSchedulerLaneWrite);
+
+      case LKLdapMessageTypeWhoAmI:
+      return(LKSchedulerLaneInteractive);
+
+      case LKLdapMessageTypeSync:
+      // a persisting synchronization would hold a slot of the lane indefinitely
+      if ((syncPersist))
+         return(NSNotFound);
+      return(LKSchedulerLaneBulk);
+
+      case LKLdapMessageTypeSearch:
+      break;
+
+      // binds, unbinds, and pre-warming are not scheduled
+      default:
+      return(NSNotFound);
+   };
+
+   // searches answered from the cache do not use a connection
+   if ((searchIsCached))
+      return(NSNotFound);
+
+   // streaming searches and exports are expected to return many entries
+   if ( ((searchEntryHandler)) || ((searchWriter)) )
+      return(LKSchedulerLaneBulk);
+   if ((searchWindow.length))
+      return(LKSchedulerLaneInteractive);
+   if (searchScope == LKLdapSearchScopeBase)
+      return(LKSchedulerLaneInteractive);
+   sizeLimit = session.ldapSearchSizeLimit;
+   if ( (sizeLimit > 0) && (sizeLimit <= limit) )
+      return(LKSchedulerLaneInteractive);
+
+   return(LKSchedulerLaneBulk);
+}
+
+
+#pragma mark - replica routing
+
+- (BOOL) requiresPrimaryServer
+{
+   switch(messageType)
+   {
+      case LKLdapMessageTypeAdd:
+      case LKLdapMessageTypeBatch:
+      case LKLdapMessageTypeDelete:
+      case LKLdapMessageTypeImport:
+      case LKLdapMessageTypeModify:
+      case LKLdapMessageTypeRename:
+      return(YES);
+
+      default:
+      break;
+   };
+   return(NO);
+}
+
+
+#pragma mark - metrics
+
+- (void) enableMetrics
+{
+   if ((metricsSample))
+      return;
+   if ((metricsSample = calloc(1, sizeof(LKMetricsSample))) == NULL)
+      return;
+   metricsSample->queued = [NSDate timeIntervalSinceReferenceDate];
+   return;
+}
+
+
+- (void) metricsAddPhase:(LKMetricsPhase)phase start:(NSTimeInterval)start
+{
+   if ((metricsSample))
+      metricsSample->phases[phase] += [NSDate timeIntervalSinceReferenceDate] - start;
+   return;
+}
+
+
+- (NSTimeInterval) metricsStart
+{
+   // messages which are not measured do not read the clock
+   if (!(metricsSample))
+      return(0);
+   return([NSDate timeIntervalSinceReferenceDate]);
+}
+
+
+- (void) recordMetrics
+{
+   if (!(metricsSample))
+      return;
+
+   // the bind phase includes connecting and starting TLS
+   metricsSample->phases[LKMetricsPhaseBind]  = bindConnectTime + bindStartTLSTime +
+                                                bindAuthenticateTime;
+   metricsSample->phases[LKMetricsPhaseTotal] = [NSDate timeIntervalSinceReferenceDate] -
+                                                metricsSample->started;
+   [session.ldapMetrics recordSample:metricsSample messageType:messageType
+      successful:self.isSuccessful];
+
+   free(metricsSample);
+   metricsSample = NULL;
+
+   return;
+}
+
+
+#pragma mark - completion
+
+- (void) setCompletionHandler:(LKMessageCompletionHandler)handler
+         queue:(dispatch_queue_t)queue
+{
+   // must be called before the message is queued
+   @synchronized(self)
+   {
+      [completionHandler release];
+      completionHandler = [handler copy];
+      if ((callbackQueue))
+         dispatch_release(callbackQueue);
+      callbackQueue = queue;
+      if ((callbackQueue))
+         dispatch_retain(callbackQueue);
+   };
+   return;
+}
+
+
+#pragma mark - non-concurrent tasks
+
+- (void) main
+{
+   NSAutoreleasePool * pool;
+   NSTimeInterval      start;
+
+   // add signal handlers
+   signal(SIGPIPE, SIG_IGN);
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   // measures the time the message waited in the queue
+   if ((metricsSample))
+   {
+      metricsSample->started = [NSDate timeIntervalSinceReferenceDate];
+      metricsSample->phases[LKMetricsPhaseQueue] = metricsSample->started -
+                                                   metricsSample->queued;
+   };
+
+   // searches answered from the cache complete without a connection
+   if ((searchIsCached))
+   {
+      self.errorTitle = @"LDAP Search";
+      [self recordMetrics];
+      [pool release];
+      return;
+   };
+
+   // pre-warming only opens connections which the pool does not have yet
+   start = [self metricsStart];
+   if (messageType == LKLdapMessageTypePrewarm)
+   {
+      connection = [[session checkoutNewConnection] retain];
+      if (!(connection))
+      {
+         self.errorTitle = @"LDAP Prewarm";
+         [self recordMetrics];
+         [pool release];
+         return;
+      };
+   }
+
+   // borrows a connection from the session's pool
+   else if (messageType != LKLdapMessageTypeUnbind)
+   {
+      connection = [[session checkoutConnectionForMessage:self] retain];
+      if (!(connection))
+      {
+         [self resetErrorWithTitle:@"LDAP Error" andCode:LDAP_USER_CANCELLED];
+         [self recordMetrics];
+         [pool release];
+         return;
+      };
+   };
+   [self metricsAddPhase:LKMetricsPhaseCheckout start:start];
+
+   switch(messageType)
+   {
+      case LKLdapMessageTypeAdd:
+      [self ldapAdd];
+      [self removeCachedResults];
+      self.errorTitle = @"LDAP Add";
+      break;
+
+      case LKLdapMessageTypeBatch:
+      [self ldapBatch];
+      self.errorTitle = @"LDAP Batch";
+      break;
+
+      case LKLdapMessageTypeImport:
+      [self ldapBatch];
+      self.errorTitle = @"LDAP Import";
+      break;
+
+      case LKLdapMessageTypeBind:
+      [self ldapBind];
+      break;
+
+      case LKLdapMessageTypePrewarm:
+      [self ldapBind];
+      self.errorTitle = @"LDAP Prewarm";
+      break;
+
+      case LKLdapMessageTypeDelete:
+      [self ldapDelete];
+      [self removeCachedResults];
+      self.errorTitle = @"LDAP Delete";
+      break;
+
+      case LKLdapMessageTypeModify:
+      [self ldapModify];
+      [self removeCachedResults];
+      self.errorTitle = @"LDAP Modify";
+      break;
+
+      case LKLdapMessageTypeRename:
+      [self ldapRename];
+      [self removeCachedResults];
+      self.errorTitle = @"LDAP Modify RDN";
+      break;
+
+      case LKLdapMessageTypeSearch:
+      [self ldapSearch];
+      [self flushEntries];
+      if ( ((searchWriter)) && (!([searchWriter flush])) && ((self.isSuccessful)) )
+      {
+         self.errorCode         = LDAP_LOCAL_ERROR;
+         self.diagnosticMessage = searchWriter.errorMessage;
+      };
+      if ( ((searchCacheKey)) && ((self.isSuccessful)) && (!([referrals count])) )
+         [session.ldapSearchCache storeEntries:entries forKey:searchCacheKey
+            baseDN:[searchDnList objectAtIndex:0] scope:searchScope
+            generation:searchCacheGeneration];
+      self.errorTitle = @"LDAP Search";
+      break;
+
+      case LKLdapMessageTypeSync:
+      [self ldapSync];
+      self.errorTitle = @"LDAP Sync";
+      break;
+
+      case LKLdapMessageTypeRebind:
+      [self ldapRebind];
+      break;
+
+      case LKLdapMessageTypeUnbind:
+      [self ldapUnbind];
+      self.errorTitle = @"LDAP unbind";
+      break;
+
+      default:
+      break;
+   };
+
+   // returns the connection to the session's pool
+   [session checkinConnection:connection];
+   [connection release];
+   connection = nil;
+
+   [self recordMetrics];
+
+   [pool release];
+
+   return;
+}
+
+
+- (void) start
+{
+   LKMessageCompletionHandler handler;
+
+   // the queue may release the message once it is finished
+   [self retain];
+
+   [super start];
+
+   // messages cancelled before they started are also completed
+   @synchronized(self)
+   {
+      handler           = completionHandler;
+      completionHandler = nil;
+   };
+   if ((handler))
+   {
+      dispatch_async(callbackQueue, ^{ handler(self); });
+      [handler release];
+   };
+
+   [self release];
+
+   return;
+}
+
+
+#pragma mark - LDAP tasks
+
+- (BOOL) ldapAdd
+{
+   int               msgid;
+   BOOL              isConnected;
+   LDAPMessage     * res;
+
+   // reset errors
+   [self resetErrorWithTitle:@"LDAP Add"];
+
+   // verifies session is connected to LDAP
+   isConnected = [self ldapBind];
+   if (!(isConnected))
+      return(self.isSuccessful);
+   if ((self.isCancelled))
+   {
+      self.errorCode = LDAP_USER_CANCELLED;
+      return(self.isSuccessful);
+   };
+
+   // initiates add, the request is only replayed if it was not sent
+   msgid = [self addDN:modifyDn mods:modifyList];
+   if ( (!(self.isSuccessful)) && ([self reconnectAfterError]) )
+      msgid = [self addDN:modifyDn mods:modifyList];
+   if (!(self.isSuccessful))
+      return(self.isSuccessful);
+
+   // waits for result
+   if ((res = [self resultWithMessageID:msgid resultEntries:nil]) == NULL)
+      return(self.isSuccessful);
+
+   // parses result
+   if (!([self parseResult:res referrals:nil controls:NULL]))
+      return(self.isSuccessful);
+
+   return(self.isSuccessful);
+}
+
+
+- (BOOL) ldapBatch
+{
+   int                   msgid;
+   BOOL                  hasChanges;
+   NSUInteger            total;
+   NSNumber            * key;
+   LKChange            * change;
+   LKChange            * failed;
+   LDAPMessage         * res;
+   NSMutableDictionary * pending;
+   NSAutoreleasePool   * pool;
+
+   // reset errors
+   [self resetErrorWithTitle:@"LDAP Batch"];
+
+   // verifies session is connected to LDAP
+   if (!([self ldapBind]))
+      return(self.isSuccessful);
+
+   // the dispatcher matches each result to the request which caused it
+   if (!([connection startDispatcher]))
+   {
+      [self resetErrorWithTitle:@"LDAP Batch" andCode:LDAP_UNAVAILABLE];
+      return(self.isSuccessful);
+   };
+
+   pending    = [[NSMutableDictionary alloc] initWithCapacity:changeWindowSize];
+   total      = [changeList count];
+   hasChanges = YES;
+   failed     = nil;
+
+   // changes are not replayed after the connection is lost because it is not
+   // known which of the outstanding changes were applied
+   while ( ((self.isSuccessful)) && ((hasChanges) || (([pending count]))) )
+   {
+      // changes read from a file are released as they complete
+      pool = [[NSAutoreleasePool alloc] init];
+
+      // verifies operation has not been cancelled
+      if ((self.isCancelled))
+      {
+         self.errorCode = LDAP_USER_CANCELLED;
+         [pool release];
+         break;
+      };
+
+      // keeps the window of outstanding requests full, no further changes
+      // are sent after a failure unless the batch continues on error
+      while ( (hasChanges) && ([pending count] < changeWindowSize) )
+      {
+         if ( ((failed)) || ((change = [self nextChange]) == nil) )
+         {
+            hasChanges = NO;
+            break;
+         };
+         msgid = [self sendChange:change];
+         if (!(self.isSuccessful))
+         {
+            if ( (self.errorCode == LDAP_SERVER_DOWN)   ||
+                 (self.errorCode == LDAP_CONNECT_ERROR) ||
+                 (self.errorCode == LDAP_UNAVAILABLE) )
+            {
+               [change setResultCode:self.errorCode message:self.errorMessage
+                  diagnosticMessage:self.diagnosticMessage];
+               break;
+            };
+
+            // the request could not be encoded, only this change failed
+            [self completeChange:change total:total];
+            if ( (!(changeContinueOnError)) && (!(change.isSuccessful)) )
+               failed = [change retain];
+            continue;
+         };
+         [pending setObject:change forKey:[NSNumber numberWithInt:msgid]];
+      };
+      if ( (!([pending count])) || (!(self.isSuccessful)) )
+      {
+         [pool release];
+         continue;
+      };
+
+      // matches the next result to its change
+      if ((res = [self resultFromMailboxWithResultEntries:nil]) == NULL)
+      {
+         [pool release];
+         break;
+      };
+      key    = [NSNumber numberWithInt:ldap_msgid(res)];
+      change = [[pending objectForKey:key] retain];
+      [pending removeObjectForKey:key];
+      [self parseResult:res referrals:nil controls:NULL];
+      [self completeChange:change total:total];
+      if ( (!(changeContinueOnError)) && (!(change.isSuccessful)) && (!(failed)) )
+         failed = [change retain];
+      [change release];
+
+      [pool release];
    };
 
+   // the error of the batch is recorded on each change which did not complete
+   for(key in pending)
+   {
+      [self abandonMessageID:[key intValue]];
+      [[pending objectForKey:key] setResultCode:self.errorCode
+         message:self.errorMessage diagnosticMessage:self.diagnosticMessage];
+   };
+   for(; changesSent < total; changesSent++)
+      [[changeList objectAtIndex:changesSent] setResultCode:self.errorCode
+         message:self.errorMessage diagnosticMessage:self.diagnosticMessage];
+
+   // a malformed record ends an import once the outstanding changes complete,
+   // otherwise a batch which stops on error reports the first failed change
+   if ( ((changeReader.errorMessage)) && ((self.isSuccessful)) )
+   {
+      self.errorCode         = LDAP_DECODING_ERROR;
+      self.diagnosticMessage = changeReader.errorMessage;
+   }
+   else if ( ((failed)) && ((self.isSuccessful)) )
+   {
+      self.errorCode         = failed.errorCode;
+      self.errorMessage      = failed.errorMessage;
+      self.diagnosticMessage = failed.diagnosticMessage;
+   };
+
+   // the dispatcher is only kept by connections shared by several messages
+   if (!(session.ldapMultiplexRequests))
+      [connection stopDispatcherIfIdle];
+
+   [failed  release];
+   [pending release];
+
+   return(self.isSuccessful);
+}
+
+
+- (BOOL) ldapBind
+{
+   // binds to the next server while the server of the connection is unavailable
+   while (!([self bindConnection]))
+      if (!([self failoverAfterError]))
+         break;
    return(self.isSuccessful);
 }
 
@@ -667,19 +1739,17 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
       return(self.isSuccessful);
    };
 
-   // initiates search
+   // initiates delete, the request is only replayed if it was not sent
    msgid = [self deleteDN:modifyDn];
+   if ( (!(self.isSuccessful)) && ([self reconnectAfterError]) )
+      msgid = [self deleteDN:modifyDn];
    if (!(self.isSuccessful))
       return(self.isSuccessful);
 
    // verifies operation has not been cancelled
    if ((self.isCancelled))
    {
-      @synchronized(session)
-      {
-         if ((session.ld))
-            ldap_abandon_ext(session.ld, msgid, NULL, NULL);
-      };
+      [self abandonMessageID:msgid];
       self.errorCode = LDAP_USER_CANCELLED;
       return(self.isSuccessful);
    };
@@ -689,7 +1759,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
       return(self.isSuccessful);
 
    // parses result
-   if (!([self parseResult:res referrals:nil]))
+   if (!([self parseResult:res referrals:nil controls:NULL]))
       return(self.isSuccessful);
 
    return(self.isSuccessful);
@@ -715,8 +1785,10 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
       return(self.isSuccessful);
    };
 
-   // initiates search
+   // initiates modify, the request is only replayed if it was not sent
    msgid = [self modifyDN:modifyDn mods:(NSArray *)modifyList];
+   if ( (!(self.isSuccessful)) && ([self reconnectAfterError]) )
+      msgid = [self modifyDN:modifyDn mods:(NSArray *)modifyList];
    if (!(self.isSuccessful))
       return(self.isSuccessful);
 
@@ -725,7 +1797,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
       return(self.isSuccessful);
 
    // parses result
-   if (!([self parseResult:res referrals:nil]))
+   if (!([self parseResult:res referrals:nil controls:NULL]))
       return(self.isSuccessful);
 
    return(self.isSuccessful);
@@ -751,9 +1823,12 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
       return(self.isSuccessful);
    };
 
-   // initiates search
+   // initiates rename, the request is only replayed if it was not sent
    msgid = [self renameDN:modifyDn newRDN:modifyNewRdn
       newSuperior:modifyNewSuperior deleteOldRDN:modifyDeleteOldRdn];
+   if ( (!(self.isSuccessful)) && ([self reconnectAfterError]) )
+      msgid = [self renameDN:modifyDn newRDN:modifyNewRdn
+         newSuperior:modifyNewSuperior deleteOldRDN:modifyDeleteOldRdn];
    if (!(self.isSuccessful))
       return(self.isSuccessful);
 
@@ -762,7 +1837,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
       return(self.isSuccessful);
 
    // parses result
-   if (!([self parseResult:res referrals:nil]))
+   if (!([self parseResult:res referrals:nil controls:NULL]))
       return(self.isSuccessful);
 
    return(self.isSuccessful);
@@ -773,9 +1848,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 {
    NSString        * baseDN;
    char           ** attrs;
-   int               msgid;
    BOOL              isConnected;
-   LDAPMessage     * res;
 
    // reset errors
    [self resetErrorWithTitle:@"LDAP Search"];
@@ -793,44 +1866,292 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    // allocates an array to copy UTF8 strings from searchAttributes
    attrs = [self newAttributeArray:searchAttributes];
 
-   // loops through DN list
-   for(baseDN in searchDnList)
-   {
-      // initiates search
+   // copies paging information, the virtual list view selects the entries
+   // of a windowed search instead
+   searchPageSize = session.ldapSearchPageSize;
+   if ((searchWindow.length))
+      searchPageSize = 0;
+
+   // searches multiple bases concurrently
+   if ([searchDnList count] > 1)
+      [self ldapSearchBaseDNList:searchDnList attributes:attrs];
+   else
+      for(baseDN in searchDnList)
+         if (!([self ldapSearchBaseDN:baseDN attributes:attrs]))
+            break;
+
+   // frees memory
+   [self freeAttributeArray:(&attrs)];
+
+   return(self.isSuccessful);
+}
+
+
+- (BOOL) ldapSearchBaseDN:(NSString *)baseDN attributes:(char **)attrs
+{
+   int               msgid;
+   ber_int_t         estimate;
+   BOOL              isFirstPage;
+   NSUInteger        count;
+   LDAPMessage     * res;
+   LDAPControl    ** ctrls;
+   LDAPControl     * ctrl;
+   NSMutableArray  * page;
+   struct berval     cookie;
+
+   // entries are held until the page is complete when paging
+   page        = nil;
+   isFirstPage = YES;
+   memset(&cookie, 0, sizeof(struct berval));
+   if (searchPageSize > 0)
+      page = [[NSMutableArray alloc] initWithCapacity:searchPageSize];
+
+   // initiates search
+   msgid = [self searchBaseDN:baseDN scope:searchScope filter:searchFilter
+                  attributes:attrs attributesOnly:searchAttributesOnly cookie:NULL];
+   if ( (!(self.isSuccessful)) && ([self reconnectAfterError]) )
       msgid = [self searchBaseDN:baseDN scope:searchScope filter:searchFilter
-                     attributes:attrs attributesOnly:searchAttributesOnly];
-      if (!(self.isSuccessful))
-      {
-         [self freeAttributeArray:(&attrs)];
-         return(self.isSuccessful);
-      };
+                     attributes:attrs attributesOnly:searchAttributesOnly cookie:NULL];
+
+   // sends a duplicate request if the server is slow to respond
+   if ((self.isSuccessful))
+      msgid = [self hedgeSearchBaseDN:baseDN attributes:attrs messageID:msgid];
 
+   // loops through pages
+   while ((self.isSuccessful))
+   {
       // verifies operation has not been cancelled
       if ((self.isCancelled))
       {
-         @synchronized(session)
-         {
-            if ((session.ld))
-               ldap_abandon_ext(session.ld, msgid, NULL, NULL);
-         };
+         [self abandonMessageID:msgid];
          self.errorCode = LDAP_USER_CANCELLED;
-         [self freeAttributeArray:(&attrs)];
-         return(self.isSuccessful);
+         break;
       };
 
       // waits for result
-      if ((res = [self resultWithMessageID:msgid resultEntries:nil]) == NULL)
+      count = entryCount;
+      res   = [self resultWithMessageID:msgid resultEntries:page];
+
+      // replays the search if the connection closed before entries were
+      // received, otherwise the replay would duplicate entries
+      if ( (!(res)) && ((isFirstPage)) && (count == entryCount) &&
+           (![page count]) && ([self reconnectAfterError]) )
       {
-         [self freeAttributeArray:(&attrs)];
-         return(self.isSuccessful);
+         msgid = [self searchBaseDN:baseDN scope:searchScope filter:searchFilter
+                        attributes:attrs attributesOnly:searchAttributesOnly cookie:NULL];
+         continue;
+      };
+      if (!(res))
+      {
+         [self storeEntries:page resultEntries:nil];
+         break;
       };
 
       // parses result
-      if (!([self parseResult:res referrals:nil]))
+      ctrls = NULL;
+      [self parseResult:res referrals:nil
+         controls:( ((page)) || ((searchSortKeys)) ) ? &ctrls : NULL];
+
+      // retrieves the cookie for the next page
+      ber_memfree(cookie.bv_val);
+      memset(&cookie, 0, sizeof(struct berval));
+      if ((ctrls))
       {
-         [self freeAttributeArray:(&attrs)];
-         return(self.isSuccessful);
+         @synchronized(connection)
+         {
+            ctrl = ldap_control_find(LDAP_CONTROL_PAGEDRESULTS, ctrls, NULL);
+            if ( ((ctrl)) && ((connection.ld)) )
+               ldap_parse_pageresponse_control(connection.ld, ctrl, &estimate, &cookie);
+            if ((searchSortKeys))
+               [self parseSortControls:ctrls];
+         };
+         ldap_controls_free(ctrls);
+      };
+      isFirstPage = NO;
+
+      // requests the next page before delivering the current page
+      if ( ((self.isSuccessful)) && ((cookie.bv_len)) )
+         msgid = [self searchBaseDN:baseDN scope:searchScope filter:searchFilter
+                        attributes:attrs attributesOnly:searchAttributesOnly cookie:&cookie];
+
+      // delivers the current page
+      [self storeEntries:page resultEntries:nil];
+      [self flushEntries];
+
+      if (!(cookie.bv_len))
+         break;
+   };
+
+   // frees memory
+   ber_memfree(cookie.bv_val);
+   [page release];
+
+   return(self.isSuccessful);
+}
+
+
+- (BOOL) ldapSearchBaseDNList:(NSArray *)dnList attributes:(char **)attrs
+{
+   int                   msgid;
+   ber_int_t             estimate;
+   NSUInteger            count;
+   NSString            * baseDN;
+   NSNumber            * key;
+   LDAPMessage         * res;
+   LDAPControl        ** ctrls;
+   LDAPControl         * ctrl;
+   NSMutableDictionary * bases;
+   struct berval         cookie;
+
+   bases = [[NSMutableDictionary alloc] initWithCapacity:[dnList count]];
+   count = entryCount;
+
+   do
+   {
+      [self resetErrorWithTitle:@"LDAP Search"];
+      [bases removeAllObjects];
+
+      // the dispatcher routes the results of every base to this message
+      if (!([connection startDispatcher]))
+      {
+         [self resetErrorWithTitle:@"LDAP Search" andCode:LDAP_UNAVAILABLE];
+         continue;
+      };
+
+      // issues a search for every base before waiting for any results
+      for(baseDN in dnList)
+      {
+         msgid = [self searchBaseDN:baseDN scope:searchScope filter:searchFilter
+                        attributes:attrs attributesOnly:searchAttributesOnly cookie:NULL];
+         if (!(self.isSuccessful))
+            break;
+         [bases setObject:baseDN forKey:[NSNumber numberWithInt:msgid]];
+      };
+
+      // merges results as they arrive from each base
+      while ( ((self.isSuccessful)) && (([bases count])) )
+      {
+         if ((res = [self resultFromMailboxWithResultEntries:nil]) == NULL)
+            break;
+         key    = [NSNumber numberWithInt:ldap_msgid(res)];
+         baseDN = [[[bases objectForKey:key] retain] autorelease];
+         [bases removeObjectForKey:key];
+
+         // parses result
+         ctrls = NULL;
+         [self parseResult:res referrals:nil controls:((searchPageSize > 0)) ? &ctrls : NULL];
+
+         // requests the next page of the base
+         memset(&cookie, 0, sizeof(struct berval));
+         if ((ctrls))
+         {
+            @synchronized(connection)
+            {
+               ctrl = ldap_control_find(LDAP_CONTROL_PAGEDRESULTS, ctrls, NULL);
+               if ( ((ctrl)) && ((connection.ld)) )
+                  ldap_parse_pageresponse_control(connection.ld, ctrl, &estimate, &cookie);
+            };
+            ldap_controls_free(ctrls);
+         };
+         if ( ((self.isSuccessful)) && ((cookie.bv_len)) )
+         {
+            msgid = [self searchBaseDN:baseDN scope:searchScope filter:searchFilter
+                           attributes:attrs attributesOnly:searchAttributesOnly cookie:&cookie];
+            if ((self.isSuccessful))
+               [bases setObject:baseDN forKey:[NSNumber numberWithInt:msgid]];
+         };
+         ber_memfree(cookie.bv_val);
+
+         // stops once the size limit across all bases is reached
+         if ( ((self.isSuccessful)) && (ldapSearchSizeLimit > 0) &&
+              (entryCount >= (NSUInteger)ldapSearchSizeLimit) )
+         {
+            self.errorTitle = @"LDAP Result";
+            self.errorCode  = LDAP_SIZELIMIT_EXCEEDED;
+         };
+      };
+
+      // abandons the searches which are still outstanding
+      for(key in bases)
+         [self abandonMessageID:[key intValue]];
+
+   // replays the searches if the connection closed before entries were received
+   } while ( (!(self.isSuccessful)) && (count == entryCount) && ([self reconnectAfterError]) );
+
+   // the dispatcher is only kept by connections shared by several messages
+   if (!(session.ldapMultiplexRequests))
+      [connection stopDispatcherIfIdle];
+
+   [bases release];
+
+   return(self.isSuccessful);
+}
+
+
+- (BOOL) ldapSync
+{
+   int               msgid;
+   char           ** attrs;
+   BOOL              isRefreshRequired;
+   NSString        * baseDN;
+   LDAPMessage     * res;
+   LDAPControl    ** ctrls;
+
+   // reset errors
+   [self resetErrorWithTitle:@"LDAP Sync"];
+
+   // verifies session is connected to LDAP
+   if (!([self ldapBind]))
+      return(self.isSuccessful);
+   if ((self.isCancelled))
+   {
+      self.errorCode = LDAP_USER_CANCELLED;
+      return(self.isSuccessful);
+   };
+
+   // allocates an array to copy UTF8 strings from searchAttributes
+   attrs  = [self newAttributeArray:searchAttributes];
+   baseDN = [searchDnList objectAtIndex:0];
+
+   isRefreshRequired = NO;
+   while ((self.isSuccessful))
+   {
+      // initiates synchronization
+      [syncReplica beginRefresh];
+      msgid = [self syncBaseDN:baseDN attributes:attrs];
+      if ( (!(self.isSuccessful)) && ([self reconnectAfterError]) )
+         msgid = [self syncBaseDN:baseDN attributes:attrs];
+      if (!(self.isSuccessful))
+         break;
+
+      // entries and intermediate messages are applied to the replica as
+      // they are received, a persisting synchronization only returns a
+      // result when it is cancelled or ended by the server
+      if ((res = [self resultWithMessageID:msgid resultEntries:nil]) == NULL)
+         break;
+
+      // parses result
+      ctrls = NULL;
+      [self parseResult:res referrals:nil controls:&ctrls];
+      if ((ctrls))
+      {
+         [self receiveSyncDone:ctrls];
+         ldap_controls_free(ctrls);
+      };
+
+      // the cookie is too old for a delta refresh, retries with a full
+      // refresh of the content
+      if ( (self.errorCode == LDAP_SYNC_REFRESH_REQUIRED) && (!(isRefreshRequired)) )
+      {
+         isRefreshRequired = YES;
+         [syncReplica setCookie:nil];
+         [self resetErrorWithTitle:@"LDAP Sync"];
+         continue;
       };
+
+      if ((self.isSuccessful))
+         [syncReplica endRefresh];
+      break;
    };
 
    // frees memory
@@ -843,6 +2164,8 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 - (BOOL) ldapTestConnection
 {
    BOOL             isConnected;
+   NSInteger        probeInterval;
+   NSTimeInterval   now;
    int              err;
    struct timeval   timeout;
    struct timeval * timeoutp;
@@ -858,24 +2181,35 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    [self resetErrorWithTitle:@"Test LDAP Connection"];
 
    // start off assuming session is connected
-   isConnected = YES;
+   isConnected   = YES;
+   probeInterval = session.ldapConnectionProbeInterval;
+   now           = [NSDate timeIntervalSinceReferenceDate];
 
    // obtain the lock for LDAP handle
-   @synchronized(session)
+   @synchronized(connection)
    {
-      // assume session is correct if reporting not connected
-      if (!(session.isConnected))
+      // assume connection is correct if reporting not connected
+      if (!(connection.isConnected))
       {
-      isConnected = NO;
-         if ((session.ld))
-            ldap_unbind_ext_s(session.ld, NULL, NULL);
-         session.ld  = NULL;
+         isConnected = NO;
+         [connection unbind];
       }
 
       // verify LDAP handle exists
-      else if (!(session.ld))
+      else if (!(connection.ld))
          isConnected = NO;
 
+      // the dispatcher marks the connection as down when the socket fails and
+      // owns every response, so the handle is not probed with a search
+      else if ((connection.isDispatching))
+         isConnected = YES;
+
+      // closed connections are detected when they are used, so the handle is
+      // only probed after it has been idle for a while
+      else if ( (probeInterval < 1) ||
+                ((now - connection.lastActivity) < probeInterval) )
+         isConnected = YES;
+
       // test connection with simple LDAP query
       else
       {
@@ -888,7 +2222,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 
          // performs search against known entry
          err = ldap_search_ext_s(
-            session.ld,                 // LDAP            * ld
+            connection.ld,              // LDAP            * ld
             "",                         // char            * base
             LDAP_SCOPE_BASE,            // int               scope
             "(objectclass=*)",          // char            * filter
@@ -915,6 +2249,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
             break;
 
             default:
+            connection.lastActivity = now;
             break;
          };
       };
@@ -922,7 +2257,7 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 
    if (!(isConnected))
    {
-      [self ldapUnbind];
+      [connection unbind];
       [self resetErrorWithTitle:@"Test LDAP Connection" andCode:LDAP_UNAVAILABLE];
       return(self.isSuccessful);
    };
@@ -933,11 +2268,46 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 
 - (BOOL) ldapRebind
 {
+   LDAP           * ld;
+   NSTimeInterval   start;
+
    // reset errors
    [self resetErrorWithTitle:@"LDAP Rebind"];
 
-   // clears LDAP information
-   [self ldapUnbind];
+   // closes every other connection in the pool
+   [session resetConnectionsExcept:connection];
+   session.isConnected = NO;
+
+   // authenticates the borrowed connection again without reopening the TCP
+   // connection and TLS session. SASL binds may have installed a security
+   // layer and multiplexed connections have other outstanding requests, so
+   // those connections are reopened.
+   [self copySessionInformation];
+   @synchronized(connection)
+   {
+      if ( ((connection.isConnected)) && ((connection.ld)) &&
+           (!(connection.isDispatching)) &&
+           (connection.bindMethod != LKLdapBindMethodSASL) &&
+           (ldapBindMethod != LKLdapBindMethodSASL) &&
+           (connection.bindEncryptionScheme == ldapEncryptionScheme) &&
+           ([connection.bindURI isEqualToString:ldapURI]) )
+      {
+         start = [NSDate timeIntervalSinceReferenceDate];
+         if ((ld = [self bindAuthenticate:connection.ld]) == NULL)
+         {
+            // the handle was released by bindAuthenticate
+            connection.ld = NULL;
+            [connection unbind];
+            return(self.isSuccessful);
+         };
+         bindAuthenticateTime    = [NSDate timeIntervalSinceReferenceDate] - start;
+         connection.bindMethod   = ldapBindMethod;
+         connection.lastActivity = [NSDate timeIntervalSinceReferenceDate];
+         session.isConnected     = YES;
+         return(self.isSuccessful);
+      };
+   };
+   [connection unbind];
 
    // initiates LDAP connection
    [self ldapBind];
@@ -952,19 +2322,58 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    [self resetErrorWithTitle:@"LDAP Unbind"];
 
    // clears LDAP information
-   @synchronized(session)
+   [session resetConnectionsExcept:nil];
+   [connection unbind];
+   session.isConnected = NO;
+
+   return(self.isSuccessful);
+}
+
+
+#pragma mark - LDAP subtasks
+
+- (int) addDN:(NSString *)dn mods:(NSArray *)modObjects
+{
+   int         msgid;
+   LDAPMod  ** mods;
+   NSTimeInterval start;
+
+   if ((mods = [self newLDAPModArray:modObjects]) == NULL)
+   {
+      self.errorCode = LDAP_NO_MEMORY;
+      return(-1);
+   };
+
+   @synchronized(connection)
    {
-      if ((session.ld))
-         ldap_unbind_ext(session.ld, NULL, NULL);
-      session.ld          = NULL;
-      session.isConnected = NO;
+      // checks session
+      if (!(connection.ld))
+      {
+         [self freeModsArray:&mods];
+         self.errorCode = LDAP_UNAVAILABLE;
+         return(-1);
+      };
+
+      // initiates add
+      start = [self metricsStart];
+      self.errorCode = ldap_add_ext(
+         connection.ld,                   // LDAP            * ld
+         [dn UTF8String],                 // char            * dn
+         mods,                            // LDAPMod         * attrs[]
+         NULL,                            // LDAPControl    ** serverctrls
+         NULL,                            // LDAPControl    ** clientctrls
+         &msgid                           // int             * msgidp
+      );
+      [self metricsAddPhase:LKMetricsPhaseSend start:start];
+      [self updateConnectionHealth];
+      [self registerMessageID:msgid];
    };
 
-   return(self.isSuccessful);
-}
+   [self freeModsArray:&mods];
 
+   return(msgid);
+}
 
-#pragma mark - LDAP subtasks
 
 - (LDAP *) bindAuthenticate:(LDAP *)ld
 {
@@ -1058,6 +2467,80 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 }
 
 
+- (BOOL) bindConnection
+{
+   BOOL                isConnected;
+   LDAP              * ld;
+   NSTimeInterval      start;
+
+   // reset errors
+   [self resetErrorWithTitle:@"LDAP initialize"];
+
+   // checks for existing connection
+   isConnected = [self ldapTestConnection];
+   if ((isConnected))
+      return(self.isSuccessful);
+   if ((self.isCancelled))
+   {
+      [self resetErrorWithTitle:@"LDAP Error" andCode:LDAP_USER_CANCELLED];
+      return(self.isSuccessful);
+   };
+
+   // copies data required to BIND to LDAP
+   [self copySessionInformation];
+
+   // obtain the lock for LDAP handle
+   @synchronized(connection)
+   {
+      // another message sharing the connection may have already bound
+      if ((connection.isConnected))
+      {
+         [self resetError];
+         return(self.isSuccessful);
+      };
+
+      // initialize LDAP handle and connects to the server
+      start = [NSDate timeIntervalSinceReferenceDate];
+      if ((ld = [self bindInitialize]) == NULL)
+         return(self.isSuccessful);
+      bindConnectTime = [NSDate timeIntervalSinceReferenceDate] - start;
+
+      // starts TLS session
+      start = [NSDate timeIntervalSinceReferenceDate];
+      if ((ld = [self bindStartTLS:ld]) == NULL)
+         return(self.isSuccessful);
+      bindStartTLSTime = [NSDate timeIntervalSinceReferenceDate] - start;
+
+      // binds to LDAP
+      start = [NSDate timeIntervalSinceReferenceDate];
+      if ((ld = [self bindAuthenticate:ld]) == NULL)
+         return(self.isSuccessful);
+      bindAuthenticateTime = [NSDate timeIntervalSinceReferenceDate] - start;
+
+      // finish configuring connection
+      if ((ld = [self bindFinish:ld]) == NULL)
+         return(self.isSuccessful);
+
+      // saves LDAP handle
+      connection.ld                   = ld;
+      connection.isConnected          = YES;
+      connection.bindURI              = ldapURI;
+      connection.bindEncryptionScheme = ldapEncryptionScheme;
+      connection.bindMethod           = ldapBindMethod;
+      connection.lastActivity = [NSDate timeIntervalSinceReferenceDate];
+      session.isConnected     = YES;
+      if ((metricsSample))
+         metricsSample->connections++;
+
+      // reads responses for every message sharing the connection
+      if ((session.ldapMultiplexRequests))
+         [connection startDispatcher];
+   };
+
+   return(self.isSuccessful);
+}
+
+
 - (LDAP *) bindFinish:(LDAP *)ld
 {
    int err;
@@ -1179,6 +2662,18 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
       return(NULL);
    };
 
+#if defined(LDAP_VENDOR_VERSION) && (LDAP_VENDOR_VERSION >= 20500)
+   // opens the TCP connection so that it is timed separately from TLS and
+   // authentication
+   err = ldap_connect(ld);
+   if (err != LDAP_SUCCESS)
+   {
+      [self resetErrorWithTitle:@"LDAP Connect" andCode:err];
+      ldap_unbind_ext_s(ld, NULL, NULL);
+      return(NULL);
+   };
+#endif
+
    return(ld);
 }
 
@@ -1241,28 +2736,217 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 }
 
 
+- (void) completeChange:(LKChange *)change total:(NSUInteger)total
+{
+   NSUInteger       completed;
+   dispatch_block_t notify;
+
+   // moves the result of the request from the message to the change
+   [change setResultCode:self.errorCode message:self.errorMessage
+      diagnosticMessage:self.diagnosticMessage];
+   [self resetError];
+
+   // removes cached searches which may include the entry
+   if (change.changeType == LKLdapMessageTypeRename)
+      [session.ldapSearchCache removeResultsForRenamedDN:change.dn
+         newRDN:change.relativeDN newSuperior:change.superiorDN];
+   else
+      [session.ldapSearchCache removeResultsForDN:change.dn];
+
+   @synchronized(self)
+   {
+      completed = ++changesCompleted;
+      if (!(change.isSuccessful))
+         changesFailed++;
+   };
+   if ( (!(changeProgressHandler)) && (!(changeHandler)) )
+      return;
+
+   // handlers of messages with a completion handler run on its queue
+   notify = ^{
+      if ((changeProgressHandler))
+         changeProgressHandler(self, completed, total);
+      if ((changeHandler))
+         changeHandler(self, change);
+   };
+   if ((callbackQueue))
+      dispatch_sync(callbackQueue, notify);
+   else
+      notify();
+
+   return;
+}
+
+
 - (int) deleteDN:(NSString *)dn
 {
    int               msgid;
+   NSTimeInterval    start;
 
-   @synchronized(session)
+   @synchronized(connection)
    {
       // checks session
-      if (!(session.ld))
+      if (!(connection.ld))
       {
          self.errorCode = LDAP_UNAVAILABLE;
          return(-1);
       };
 
       // initiates search
+      start = [self metricsStart];
       self.errorCode = ldap_delete_ext(
-         session.ld,                      // LDAP            * ld
+         connection.ld,                   // LDAP            * ld
          [dn UTF8String],                 // char            * dn
          NULL,                            // LDAPControl    ** serverctrls
          NULL,                            // LDAPControl    ** clientctrls
          &msgid                           // int             * msgidp
       );
+      [self metricsAddPhase:LKMetricsPhaseSend start:start];
+      [self updateConnectionHealth];
+      [self registerMessageID:msgid];
+   };
+
+   return(msgid);
+}
+
+
+- (int) hedgeSearchBaseDN:(NSString *)dn attributes:(char **)attrs
+        messageID:(int)msgid
+{
+   LKHedgePolicy   * policy;
+   LKConnection    * original;
+   LKConnection    * hedge;
+   LKConnection    * loser;
+   NSTimeInterval    delay;
+   NSTimeInterval    sent;
+   NSTimeInterval    hedgeSent;
+   NSTimeInterval    start;
+   BOOL              isHedgeFirst;
+   int               hedgeMsgid;
+   int               loserMsgid;
+   int               sd;
+   int               hedgeSd;
+   int               rc;
+   int               timeout;
+   struct pollfd     fds[3];
+
+   // a search which continues a virtual list view depends on the state of
+   // its server, and responses on a shared connection are read by the
+   // dispatcher
+   if ( ((searchContextID)) || ((connection.isDispatching)) )
+      return(msgid);
+   policy = session.ldapHedgePolicy;
+   if ((delay = [policy delayForRead]) <= 0)
+      return(msgid);
+   if (!([self openCancelPipe]))
+      return(msgid);
+
+   // waits for the first response until the hedge delay has passed
+   sent              = [NSDate timeIntervalSinceReferenceDate];
+   searchRequestTime = sent;
+   sd                = -1;
+   @synchronized(connection)
+   {
+      if ((connection.ld))
+         ldap_get_option(connection.ld, LDAP_OPT_DESC, &sd);
+   };
+   if (sd == -1)
+      return(msgid);
+   fds[0].fd      = sd;
+   fds[0].events  = POLLIN;
+   fds[0].revents = 0;
+   fds[1].fd      = cancelPipe[0];
+   fds[1].events  = POLLIN;
+   fds[1].revents = 0;
+   timeout        = (int)(delay * 1000);
+   if (timeout < 1)
+      timeout = 1;
+   start = [self metricsStart];
+   rc    = poll(fds, 2, timeout);
+   [self metricsAddPhase:LKMetricsPhaseWait start:start];
+   if (rc != 0)
+      return(msgid);
+
+   // borrows a second connection without waiting, preferably to another server
+   if ((hedge = [session checkoutHedgeConnectionExceptServer:connection.server]) == nil)
+      return(msgid);
+   if (!([policy consumeHedge]))
+   {
+      [session checkinConnection:hedge];
+      return(msgid);
+   };
+
+   // sends the duplicate request on the second connection
+   original   = connection;
+   connection = hedge;
+   hedgeMsgid = -1;
+   hedgeSd    = -1;
+   if ( ([self bindConnection]) && (!(self.isCancelled)) )
+      hedgeMsgid = [self searchBaseDN:dn scope:searchScope filter:searchFilter
+                     attributes:attrs attributesOnly:searchAttributesOnly cookie:NULL];
+   hedgeSent = [NSDate timeIntervalSinceReferenceDate];
+   if ( ((self.isSuccessful)) && (hedgeMsgid != -1) )
+   {
+      @synchronized(hedge)
+      {
+         if ((hedge.ld))
+            ldap_get_option(hedge.ld, LDAP_OPT_DESC, &hedgeSd);
+      };
+   };
+   connection = original;
+
+   // the original request is still outstanding if the duplicate was not sent
+   if (hedgeSd == -1)
+   {
+      [self resetError];
+      [session checkinConnection:hedge];
+      return(msgid);
+   };
+
+   // waits for either connection to respond
+   fds[0].fd      = sd;
+   fds[0].events  = POLLIN;
+   fds[0].revents = 0;
+   fds[1].fd      = hedgeSd;
+   fds[1].events  = POLLIN;
+   fds[1].revents = 0;
+   fds[2].fd      = cancelPipe[0];
+   fds[2].events  = POLLIN;
+   fds[2].revents = 0;
+   timeout        = (ldapNetworkTimeout > 0) ? (int)(ldapNetworkTimeout * 1000) : -1;
+   start = [self metricsStart];
+   rc    = poll(fds, 3, timeout);
+   [self metricsAddPhase:LKMetricsPhaseWait start:start];
+
+   // the duplicate request only wins if its connection responded first
+   isHedgeFirst = ( (rc > 0) && (!(fds[0].revents)) &&
+                    ((fds[1].revents & POLLIN)) &&
+                    (!(fds[1].revents & (POLLERR | POLLNVAL))) );
+   if ((isHedgeFirst))
+   {
+      loser             = original;
+      loserMsgid        = msgid;
+      msgid             = hedgeMsgid;
+      searchRequestTime = hedgeSent;
+      connection        = [hedge retain];
+
+      // the stalled server has taken at least this long to respond
+      [original.server recordLatency:([NSDate timeIntervalSinceReferenceDate] - sent)];
+   } else {
+      loser      = hedge;
+      loserMsgid = hedgeMsgid;
+   };
+   [policy recordHedgeWon:isHedgeFirst];
+
+   // abandons the slower request and returns its connection
+   @synchronized(loser)
+   {
+      if ((loser.ld))
+         ldap_abandon_ext(loser.ld, loserMsgid, NULL, NULL);
    };
+   [session checkinConnection:loser];
+   if ((isHedgeFirst))
+      [original release];
 
    return(msgid);
 }
@@ -1272,27 +2956,32 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 {
    int         msgid;
    LDAPMod  ** mods;
+   NSTimeInterval start;
 
    mods = [self newLDAPModArray:modObjects];
 
-   @synchronized(session)
+   @synchronized(connection)
    {
       // checks session
-      if (!(session.ld))
+      if (!(connection.ld))
       {
          self.errorCode = LDAP_UNAVAILABLE;
          return(-1);
       };
 
       // initiates modify
+      start = [self metricsStart];
       self.errorCode = ldap_modify_ext(
-         session.ld,                      // LDAP            * ld
+         connection.ld,                   // LDAP            * ld
          [dn UTF8String],                 // char            * dn
          mods,                            // LDAPMod         * mods[]
          NULL,                            // LDAPControl    ** serverctrls
          NULL,                            // LDAPControl    ** clientctrls
          &msgid                           // int             * msgidp
       );
+      [self metricsAddPhase:LKMetricsPhaseSend start:start];
+      [self updateConnectionHealth];
+      [self registerMessageID:msgid];
    };
 
    [self freeModsArray:&mods];
@@ -1307,21 +2996,23 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
 {
    int  msgid;
    const char * tmpSuperior;
+   NSTimeInterval start;
 
    tmpSuperior = ((newSuperior)) ? [newSuperior UTF8String] : NULL;
 
-   @synchronized(session)
+   @synchronized(connection)
    {
       // checks session
-      if (!(session.ld))
+      if (!(connection.ld))
       {
          self.errorCode = LDAP_UNAVAILABLE;
          return(-1);
       };
 
       // initiates modify
+      start = [self metricsStart];
       self.errorCode = ldap_rename(
-         session.ld,                 // LDAP         * ld
+         connection.ld,              // LDAP         * ld
          [dn UTF8String],            // const char   * dn
          [newrdn UTF8String],        // const char   * newrd
          tmpSuperior,                // const char   * newSuperior
@@ -1330,13 +3021,29 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
          NULL,                       // LDAPControl ** cctrls
          &msgid                      // int          * msgidp
       );
+      [self metricsAddPhase:LKMetricsPhaseSend start:start];
+      [self updateConnectionHealth];
+      [self registerMessageID:msgid];
    };
 
    return(msgid);
 }
 
 
+- (LKEntry *) newEntryWithMessage:(LDAPMessage *)msg
+{
+   // attribute names are interned once for all entries of the message
+   if (!(attributeTable))
+      attributeTable = [[LKAttributeTable alloc] init];
+
+   // the entry takes ownership of the message and references its values
+   return([[LKEntry alloc] initWithMessage:msg ld:connection.ld
+            attributeTable:attributeTable]);
+}
+
+
 - (BOOL) parseResult:(LDAPMessage *)res referrals:(NSMutableArray *)localReferrals
+         controls:(LDAPControl ***)controls
 {
    int    err;
    char            * dn;
@@ -1344,58 +3051,413 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    char           ** refs;
    size_t x;
 
-   // checks for error
-   @synchronized(session)
-   {
-      ldap_parse_result(session.ld, res, &err, &dn, &errmsg, &refs, NULL, 1);
-   };
+   // checks for error
+   @synchronized(connection)
+   {
+      // the connection may have been closed after the result was delivered
+      if (!(connection.ld))
+      {
+         ldap_msgfree(res);
+         self.errorCode = LDAP_UNAVAILABLE;
+         return(NO);
+      };
+      ldap_parse_result(connection.ld, res, &err, &dn, &errmsg, &refs, controls, 1);
+   };
+
+   // retrieves matched DN
+   if ((dn))
+   {
+      // messages with a completion handler are not observed
+      if (!(callbackQueue))
+         [self willChangeValueForKey:@"matchedDNs"];
+      @synchronized(self)
+      {
+         if (!(matchedDNs))
+            matchedDNs = [[NSMutableArray alloc] initWithCapacity:1];
+         [matchedDNs addObject:[NSString stringWithUTF8String:dn]];
+      };
+      if (!(callbackQueue))
+         [self didChangeValueForKey:@"matchedDNs"];
+      ldap_memfree(dn);
+   };
+
+   // retrieves referrals
+   if ((refs))
+   {
+      if ((localReferrals))
+      {
+         for(x = 0; refs[x]; x++)
+            [localReferrals addObject:[NSString stringWithUTF8String:refs[x]]];
+      } else {
+         if (!(callbackQueue))
+            [self willChangeValueForKey:@"referrals"];
+         @synchronized(self)
+         {
+            if (!(referrals))
+               referrals = [[NSMutableArray alloc] initWithCapacity:1];
+            for(x = 0; refs[x]; x++)
+               [referrals addObject:[NSString stringWithUTF8String:refs[x]]];
+         };
+         if (!(callbackQueue))
+            [self didChangeValueForKey:@"referrals"];
+      };
+      ldap_memvfree((void **)refs);
+   };
+
+   // processes error
+   if (err != LDAP_SUCCESS)
+   {
+      self.errorTitle       = @"LDAP Result";
+      self.errorCode        = err;
+      if ((errmsg))
+         self.errorMessage = [NSString stringWithUTF8String:errmsg];
+   };
+   ldap_memfree(errmsg);
+
+   return(self.isSuccessful);
+}
+
+
+- (void) receiveEntry:(LDAPMessage *)msg batch:(NSMutableArray *)batch
+{
+   LKEntry        * entry;
+   NSTimeInterval   start;
+   NSUInteger       length;
+   char           * dn;
+   BOOL             isDuplicate;
+
+   start = [self metricsStart];
+   if ((metricsSample))
+      metricsSample->entries++;
+
+   // synchronizations apply the entry to the replica
+   if ((syncReplica))
+   {
+      [self receiveSyncEntry:msg];
+      [self metricsAddPhase:LKMetricsPhaseDecode start:start];
+      return;
+   };
+
+   // exports write the entry from the message without creating an LKEntry
+   if ((searchWriter))
+   {
+      // the dispatcher may be reading other responses from the handle
+      @synchronized(connection)
+      {
+         isDuplicate = NO;
+         if ( ((searchEntryDNs)) && ((dn = ldap_get_dn(connection.ld, msg)) != NULL) )
+         {
+            isDuplicate = [self isDuplicateEntryDN:[NSString stringWithUTF8String:dn]];
+            ldap_memfree(dn);
+         };
+         if ( (!(isDuplicate)) &&
+              ((ldapSearchSizeLimit <= 0) || (entryCount < (NSUInteger)ldapSearchSizeLimit)) )
+            if ([searchWriter writeMessage:msg ld:connection.ld])
+               entryCount++;
+      };
+      ldap_msgfree(msg);
+      [self metricsAddPhase:LKMetricsPhaseDecode start:start];
+      return;
+   };
+
+   entry = [self newEntryWithMessage:msg];
+   [batch addObject:entry];
+   if ((metricsSample))
+   {
+      metricsSample->values += [entry berValueCountWithLength:&length];
+      metricsSample->bytes  += length;
+   };
+   [entry release];
+   [self metricsAddPhase:LKMetricsPhaseDecode start:start];
+
+   return;
+}
+
+
+- (void) receiveIntermediate:(LDAPMessage *)msg
+{
+   int               err;
+   char            * oid;
+   NSData          * cookie;
+   NSMutableArray  * uuids;
+   BerElement      * ber;
+   BerVarray         set;
+   ber_tag_t         tag;
+   ber_len_t         len;
+   ber_int_t         flag;
+   struct berval   * data;
+   struct berval     value;
+   size_t            x;
+
+   // only synchronizations use intermediate responses
+   if (!(syncReplica))
+   {
+      ldap_msgfree(msg);
+      return;
+   };
+
+   oid  = NULL;
+   data = NULL;
+   err  = ldap_parse_intermediate(connection.ld, msg, &oid, &data, NULL, 1);
+   if ( (err != LDAP_SUCCESS) || (!(oid)) || (!(data)) || ((strcmp(oid, LDAP_SYNC_INFO))) )
+   {
+      ldap_memfree(oid);
+      ber_bvfree(data);
+      return;
+   };
+   if ((ber = ber_init(data)) == NULL)
+   {
+      ldap_memfree(oid);
+      ber_bvfree(data);
+      return;
+   };
+
+   // processes the syncInfoValue (RFC 4533 section 2.5)
+   cookie = nil;
+   tag    = ber_peek_tag(ber, &len);
+   switch(tag)
+   {
+      case LDAP_TAG_SYNC_NEW_COOKIE:
+      if (ber_scanf(ber, "m", &value) != LBER_ERROR)
+         cookie = [NSData dataWithBytes:value.bv_val length:value.bv_len];
+      break;
+
+      // the end of a refresh phase, entries not reported during a present
+      // phase have been deleted
+      case LDAP_TAG_SYNC_REFRESH_DELETE:
+      case LDAP_TAG_SYNC_REFRESH_PRESENT:
+      flag = 1;
+      if (ber_scanf(ber, "{") == LBER_ERROR)
+         break;
+      cookie = [self syncCookieWithBer:ber];
+      if (ber_peek_tag(ber, &len) == LDAP_TAG_REFRESHDONE)
+         ber_scanf(ber, "b", &flag);
+      if (tag == LDAP_TAG_SYNC_REFRESH_PRESENT)
+         [syncReplica removeEntriesNotPresent];
+      if ((flag))
+         [syncReplica endRefresh];
+      break;
+
+      // a set of entryUUIDs which are either present or deleted
+      case LDAP_TAG_SYNC_ID_SET:
+      flag = 0;
+      set  = NULL;
+      if (ber_scanf(ber, "{") == LBER_ERROR)
+         break;
+      cookie = [self syncCookieWithBer:ber];
+      if (ber_peek_tag(ber, &len) == LDAP_TAG_REFRESHDELETES)
+         ber_scanf(ber, "b", &flag);
+      if ( (ber_scanf(ber, "[W]", &set) == LBER_ERROR) || (!(set)) )
+         break;
+      uuids = [[NSMutableArray alloc] initWithCapacity:16];
+      for(x = 0; ((set[x].bv_val)); x++)
+         [uuids addObject:[NSData dataWithBytes:set[x].bv_val length:set[x].bv_len]];
+      ber_bvarray_free(set);
+      [syncReplica applyUUIDs:uuids deleted:((flag)) ? YES : NO];
+      [uuids release];
+      break;
+
+      default:
+      break;
+   };
+   if ((cookie))
+      [syncReplica setCookie:cookie];
+
+   // frees memory
+   ber_free(ber, 1);
+   ldap_memfree(oid);
+   ber_bvfree(data);
+
+   return;
+}
+
+
+- (void) parseReference:(LDAPMessage *)msg
+{
+   char ** refs;
+   size_t  x;
+
+   // retrieves search continuation references
+   refs = NULL;
+   if (ldap_parse_reference(connection.ld, msg, &refs, NULL, 0) != LDAP_SUCCESS)
+      return;
+   if (!(refs))
+      return;
+
+   if (!(callbackQueue))
+      [self willChangeValueForKey:@"referrals"];
+   @synchronized(self)
+   {
+      if (!(referrals))
+         referrals = [[NSMutableArray alloc] initWithCapacity:1];
+      for(x = 0; refs[x]; x++)
+         [referrals addObject:[NSString stringWithUTF8String:refs[x]]];
+   };
+   if (!(callbackQueue))
+      [self didChangeValueForKey:@"referrals"];
+   ldap_memvfree((void **)refs);
+
+   return;
+}
+
+
+- (LDAPMessage *) resultFromMailboxWithResultEntries:(NSMutableArray *)results
+{
+   NSInteger         err;
+   NSUInteger        pos;
+   BOOL              isTimedOut;
+   NSDate          * deadline;
+   NSArray         * received;
+   NSArray         * outstanding;
+   NSNumber        * key;
+   LDAPMessage     * msg;
+   LDAPMessage     * final;
+   NSMutableArray  * batch;
+   NSTimeInterval    start;
+   NSTimeInterval    requested;
+   BOOL              isMeasured;
+
+   // initializes ivars
+   final      = NULL;
+   requested  = [NSDate timeIntervalSinceReferenceDate];
+   isMeasured = NO;
+   if ((results))
+      [results removeAllObjects];
+
+   batch = [[NSMutableArray alloc] initWithCapacity:64];
+
+   // loops through results
+   while(!(final))
+   {
+      // waits for the dispatcher to deliver responses, a persisting
+      // synchronization waits for changes indefinitely
+      deadline   = nil;
+      isTimedOut = NO;
+      if ( (ldapNetworkTimeout > 0) && (!(syncPersist)) )
+         deadline = [[NSDate alloc] initWithTimeIntervalSinceNow:ldapNetworkTimeout];
+      start = [self metricsStart];
+      [mailboxCondition lock];
+      while ( (![mailbox count]) && (mailboxError == LDAP_SUCCESS) &&
+              (!(self.isCancelled)) && (!(isTimedOut)) )
+      {
+         if ((deadline))
+            isTimedOut = !([mailboxCondition waitUntilDate:deadline]);
+         else
+            [mailboxCondition wait];
+      };
+      received = [[NSArray alloc] initWithArray:mailbox];
+      [mailbox removeAllObjects];
+      err = mailboxError;
+      [mailboxCondition unlock];
+      [self metricsAddPhase:LKMetricsPhaseWait start:start];
+      [deadline release];
+      if (([received count]))
+         isTimedOut = NO;
+
+      // the first response measures the latency of the server
+      if ( ([received count]) && (!(isMeasured)) )
+      {
+         [self recordResponseLatencySince:requested];
+         isMeasured = YES;
+      };
+
+      // processes the responses which have been delivered
+      @synchronized(connection)
+      {
+         for(pos = 0; ((pos < [received count]) && (!(final))); pos++)
+         {
+            msg = [[received objectAtIndex:pos] pointerValue];
+
+            // discards responses to requests which have been abandoned
+            key = [[NSNumber alloc] initWithInt:ldap_msgid(msg)];
+            if (!([mailboxMessageIDs containsObject:key]))
+            {
+               ldap_msgfree(msg);
+               [key release];
+               continue;
+            };
+
+            switch(ldap_msgtype(msg))
+            {
+               case LDAP_RES_SEARCH_ENTRY:
+               if ((connection.ld))
+                  [self receiveEntry:msg batch:batch];
+               else
+                  ldap_msgfree(msg);
+               break;
+
+               case LDAP_RES_SEARCH_REFERENCE:
+               if ((connection.ld))
+                  [self parseReference:msg];
+               ldap_msgfree(msg);
+               break;
+
+               case LDAP_RES_INTERMEDIATE:
+               if ((connection.ld))
+                  [self receiveIntermediate:msg];
+               else
+                  ldap_msgfree(msg);
+               break;
+
+               default:
+               [mailboxMessageIDs removeObject:key];
+               final = msg;
+               break;
+            };
+            [key release];
+         };
+      };
+
+      // returns responses after the final result to the mailbox
+      if (pos < [received count])
+      {
+         [mailboxCondition lock];
+         [mailbox replaceObjectsInRange:NSMakeRange(0, 0) withObjectsFromArray:
+            [received subarrayWithRange:NSMakeRange(pos, [received count] - pos)]];
+         [mailboxCondition unlock];
+      };
+      [received release];
+
+      // stores entries for later use
+      [self storeEntries:batch resultEntries:results];
+      if ((final))
+         continue;
 
-   // retrieves matched DN
-   if ((dn))
-   {
-      [self willChangeValueForKey:@"matchedDNs"];
-      @synchronized(self)
+      // verifies operation has not been cancelled
+      if ((self.isCancelled))
       {
-         if (!(matchedDNs))
-            matchedDNs = [[NSMutableArray alloc] initWithCapacity:1];
-         [matchedDNs addObject:[NSString stringWithUTF8String:dn]];
+         outstanding = [mailboxMessageIDs allObjects];
+         for(key in outstanding)
+            [self abandonMessageID:[key intValue]];
+         self.errorCode = LDAP_USER_CANCELLED;
+         [batch release];
+         return(NULL);
       };
-      [self didChangeValueForKey:@"matchedDNs"];
-      ldap_memfree(dn);
-   };
 
-   // retrieves referrals
-   if ((refs))
-   {
-      if ((localReferrals))
+      // the dispatcher stopped before the final result was received
+      if (err != LDAP_SUCCESS)
       {
-         for(x = 0; refs[x]; x++)
-            [localReferrals addObject:[NSString stringWithUTF8String:refs[x]]];
-      } else {
-         [self willChangeValueForKey:@"referrals"];
-         @synchronized(self)
-         {
-            if (!(referrals))
-               referrals = [[NSMutableArray alloc] initWithCapacity:1];
-            for(x = 0; refs[x]; x++)
-               [referrals addObject:[NSString stringWithUTF8String:refs[x]]];
-         };
-         [self didChangeValueForKey:@"referrals"];
+         [mailboxMessageIDs removeAllObjects];
+         [self resetErrorWithTitle:@"LDAP Result" andCode:err];
+         [batch release];
+         return(NULL);
       };
-      ldap_memvfree((void **)refs);
-   };
 
-   // processes error
-   if (err != LDAP_SUCCESS)
-   {
-      self.errorTitle       = @"LDAP Result";
-      self.errorCode        = err;
-      if ((errmsg))
-         self.errorMessage = [NSString stringWithUTF8String:errmsg];
+      // nothing was received within the network timeout
+      if ((isTimedOut))
+      {
+         outstanding = [mailboxMessageIDs allObjects];
+         for(key in outstanding)
+            [self abandonMessageID:[key intValue]];
+         [self resetErrorWithTitle:@"LDAP Result" andCode:LDAP_TIMEOUT];
+         [batch release];
+         return(NULL);
+      };
    };
-   ldap_memfree(errmsg);
 
-   return(self.isSuccessful);
+   [batch release];
+
+   return(final);
 }
 
 
@@ -1403,119 +3465,178 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
                   resultEntries:(NSMutableArray *)results
 {
    int               msgtype;
-   struct timeval    timeout;
-   LDAPMessage     * res;
    int               err;
-   char            * dn;
-   char            * attribute;
-   BerElement      * ber;
-   BerValue       ** vals;
-   LKEntry         * entry;
-
-   // initializes ivars
-   res = NULL;
+   int               rc;
+   int               sd;
+   int               timeout;
+   struct timeval    zero;
+   struct pollfd     fds[2];
+   LDAPMessage     * msg;
+   LDAPMessage     * final;
+   NSMutableArray  * batch;
+   NSTimeInterval    start;
+   NSTimeInterval    requested;
+   BOOL              isMeasured;
+
+   // responses are delivered by the dispatcher when requests are multiplexed
+   if ([mailboxMessageIDs containsObject:[NSNumber numberWithInt:msgid]])
+      return([self resultFromMailboxWithResultEntries:results]);
+
+   // initializes ivars, a hedged search measures from the time its request
+   // was sent
+   final             = NULL;
+   requested         = ((searchRequestTime > 0)) ? searchRequestTime : [NSDate timeIntervalSinceReferenceDate];
+   searchRequestTime = 0;
+   isMeasured        = NO;
    if ((results))
       [results removeAllObjects];
 
-   // sets limits
-   timeout.tv_sec    = 0;
-   timeout.tv_usec   = 250000; // 0.25 seconds
+   // creates the pipe used to interrupt poll() when the operation is cancelled
+   if (!([self openCancelPipe]))
+      return(NULL);
+
+   // sets limits (ldap_result() is only used to drain data already received),
+   // a persisting synchronization waits for changes indefinitely
+   zero.tv_sec  = 0;
+   zero.tv_usec = 0;
+   timeout      = (ldapNetworkTimeout > 0) ? (int)(ldapNetworkTimeout * 1000) : -1;
+   if ((syncPersist))
+      timeout = -1;
+
+   batch = [[NSMutableArray alloc] initWithCapacity:64];
 
    // loops through results
-   msgtype = LDAP_RES_SEARCH_ENTRY;
-   while(msgtype == LDAP_RES_SEARCH_ENTRY)
+   while(!(final))
    {
-      // slight pause to prevent race condition
-      usleep(250000);
-
       // verifies operation has not been cancelled
       if ((self.isCancelled))
       {
-         @synchronized(session)
-         {
-            if ((session.ld))
-               ldap_abandon_ext(session.ld, msgid, NULL, NULL);
-         };
+         [self abandonMessageID:msgid];
          self.errorCode = LDAP_USER_CANCELLED;
+         [batch release];
          return(NULL);
       };
 
-      // retrieves result
-      @synchronized(session)
+      // retrieves every message which has already been received
+      @synchronized(connection)
       {
-         msgtype = ldap_result(session.ld, msgid, 0, &timeout, &res);
-         switch(msgtype)
+         if (!(connection.ld))
          {
-            // encountered an error
-            case -1:
-            ldap_get_option(session.ld, LDAP_OPT_RESULT_CODE, &err);
-            [self resetErrorWithTitle:@"LDAP Result" andCode:err];
+            self.errorCode = LDAP_UNAVAILABLE;
+            [batch release];
             return(NULL);
-
-            // timeout was exceeded
-            case 0:
-            break;
-
-            // result was returned
-            default:
-            break;
-         };
-      };
-
-      // determines result type
-      msgtype = ldap_msgtype(res);
-      if (msgtype != LDAP_RES_SEARCH_ENTRY)
-         continue;
-
-      // processes entry
-      @synchronized(session)
-      {
-         // creates entry with DN
-         dn = ldap_get_dn(session.ld, res);
-         entry = [[[LKEntry alloc] initWithDn:dn] autorelease];
-         ldap_memfree(dn);
-
-         attribute = ldap_first_attribute(session.ld, res, &ber);
-         while((attribute))
-         {
-            vals = ldap_get_values_len(session.ld, res, attribute);
-            [entry setBerValues:vals forAttribute:attribute];
-            ldap_value_free_len(vals);
-            attribute = ldap_next_attribute(session.ld, res, ber);
          };
-         ber_free(ber, 0);
 
-         // stores entry for later use
-         if ((results))
+         // messages are retrieved individually so that each entry may own
+         // the message which contains it
+         sd = -1;
+         do
          {
-            [results addObject:entry];
-         } else {
-            [self willChangeValueForKey:@"entries"];
-            @synchronized(self)
+            rc = ldap_result(connection.ld, msgid, LDAP_MSG_ONE, &zero, &msg);
+            switch(rc)
             {
-               if (!(entries))
-                  entries = [[NSMutableArray alloc] initWithCapacity:1];
-               [entries addObject:entry];
+               // encountered an error
+               case -1:
+               ldap_get_option(connection.ld, LDAP_OPT_RESULT_CODE, &err);
+               [self resetErrorWithTitle:@"LDAP Result" andCode:err];
+               [self updateConnectionHealth];
+               [batch release];
+               return(NULL);
+
+               // nothing is ready, wait on the socket
+               case 0:
+               ldap_get_option(connection.ld, LDAP_OPT_DESC, &sd);
+               break;
+
+               // processes the received message
+               default:
+               connection.lastActivity = [NSDate timeIntervalSinceReferenceDate];
+               if (!(isMeasured))
+               {
+                  [self recordResponseLatencySince:requested];
+                  isMeasured = YES;
+               };
+               msgtype = ldap_msgtype(msg);
+               switch(msgtype)
+               {
+                  case LDAP_RES_SEARCH_ENTRY:
+                  [self receiveEntry:msg batch:batch];
+                  break;
+
+                  case LDAP_RES_SEARCH_REFERENCE:
+                  [self parseReference:msg];
+                  ldap_msgfree(msg);
+                  break;
+
+                  case LDAP_RES_INTERMEDIATE:
+                  [self receiveIntermediate:msg];
+                  break;
+
+                  // the final result is freed by the caller
+                  default:
+                  final = msg;
+                  break;
+               };
+               break;
             };
-            [self didChangeValueForKey:@"entries"];
-         };
+         } while ( (rc > 0) && (!(final)) );
+      };
+
+      // stores entries for later use
+      [self storeEntries:batch resultEntries:results];
+      if ((final))
+         break;
+      if (sd == -1)
+      {
+         [self resetErrorWithTitle:@"LDAP Result" andCode:LDAP_SERVER_DOWN];
+         connection.isConnected = NO;
+         [batch release];
+         return(NULL);
       };
 
-      // frees result
-      ldap_memfree(res);
+      // waits for the socket to become readable or for the operation to be cancelled
+      fds[0].fd      = sd;
+      fds[0].events  = POLLIN;
+      fds[0].revents = 0;
+      fds[1].fd      = cancelPipe[0];
+      fds[1].events  = POLLIN;
+      fds[1].revents = 0;
+      start = [self metricsStart];
+      rc    = poll(fds, 2, timeout);
+      [self metricsAddPhase:LKMetricsPhaseWait start:start];
+      if ((rc == -1) && (errno != EINTR))
+      {
+         [self resetErrorWithTitle:@"LDAP Result" andCode:LDAP_OTHER];
+         self.errorMessage = [NSString stringWithUTF8String:strerror(errno)];
+         [batch release];
+         return(NULL);
+      };
+      if (rc == 0)
+      {
+         [self abandonMessageID:msgid];
+         [self resetErrorWithTitle:@"LDAP Result" andCode:LDAP_TIMEOUT];
+         [batch release];
+         return(NULL);
+      };
    };
 
-   return(res);
+   [batch release];
+
+   return(final);
 }
 
 
 - (int)  searchBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
          filter:(NSString *)filter attributes:(char **)attrs
-         attributesOnly:(BOOL)attributesOnly
+         attributesOnly:(BOOL)attributesOnly cookie:(struct berval *)cookie
 {
    struct timeval       timeout;
    struct timeval     * timeoutp;
    int                  msgid;
+   int                  err;
+   NSUInteger           pos;
+   LDAPControl        * serverctrls[4];
+   NSTimeInterval       start;
 
    // sets limits
    ldapSearchSizeLimit = session.ldapSearchSizeLimit;
@@ -1525,35 +3646,498 @@ int branches_sasl_interact(LDAP * ld, unsigned flags, void * defaults, void * si
    if (!(timeout.tv_sec))
       timeoutp = NULL;
 
-   @synchronized(session)
+   @synchronized(connection)
    {
       // checks session
-      if (!(session.ld))
+      if (!(connection.ld))
       {
          self.errorCode = LDAP_UNAVAILABLE;
          return(-1);
       };
 
+      // creates the simple paged results control
+      memset(serverctrls, 0, sizeof(serverctrls));
+      pos = 0;
+      if (searchPageSize > 0)
+      {
+         err = ldap_create_page_control(connection.ld, (ber_int_t)searchPageSize,
+                                        cookie, 0, &serverctrls[pos]);
+         if (err != LDAP_SUCCESS)
+         {
+            [self resetErrorWithTitle:@"Internal LDAP Error" andCode:err];
+            return(-1);
+         };
+         pos++;
+      };
+
+      // creates the server side sort and virtual list view controls
+      if ((searchSortKeys))
+      {
+         err = [self createSortControls:&serverctrls[pos]];
+         if (err != LDAP_SUCCESS)
+         {
+            if ((serverctrls[0]))
+               ldap_control_free(serverctrls[0]);
+            [self resetErrorWithTitle:@"Internal LDAP Error" andCode:err];
+            return(-1);
+         };
+      };
+
       // initiates search
+      start = [self metricsStart];
       self.errorCode = ldap_search_ext(
-         session.ld,                      // LDAP            * ld
+         connection.ld,                   // LDAP            * ld
          [dn UTF8String],                 // char            * base
          scope,                           // int               scope
          [filter UTF8String],             // char            * filter
          attrs,                           // char            * attrs[]
          (int)attributesOnly,             // int               attrsonly
-         NULL,                            // LDAPControl    ** serverctrls
+         serverctrls,                     // LDAPControl    ** serverctrls
          NULL,                            // LDAPControl    ** clientctrls
          timeoutp,                        // struct timeval  * timeout
          ldapSearchSizeLimit,             // int               sizelimit
          &msgid                           // int             * msgidp
       );
+      [self metricsAddPhase:LKMetricsPhaseSend start:start];
+      for(pos = 0; ((serverctrls[pos])); pos++)
+         ldap_control_free(serverctrls[pos]);
+      [self updateConnectionHealth];
+      [self registerMessageID:msgid];
+   };
+
+   return(msgid);
+}
+
+
+- (int) createSortControls:(LDAPControl **)ctrls
+{
+   int               err;
+   LDAPSortKey    ** keys;
+   LDAPVLVInfo       vlv;
+   struct berval     context;
+
+   // must be called while holding the lock of the connection
+   keys = NULL;
+   err  = ldap_create_sort_keylist(&keys,
+            (char *)[[searchSortKeys componentsJoinedByString:@" "] UTF8String]);
+   if (err != LDAP_SUCCESS)
+      return(err);
+   err = ldap_create_sort_control(connection.ld, keys, 1, &ctrls[0]);
+   ldap_free_sort_keylist(keys);
+   if (err != LDAP_SUCCESS)
+      return(err);
+   if (!(searchWindow.length))
+      return(LDAP_SUCCESS);
+
+   // the window is positioned by offset and starts with the target entry,
+   // a content count of zero requests an absolute offset
+   memset(&vlv, 0, sizeof(LDAPVLVInfo));
+   vlv.ldvlv_version      = 1;
+   vlv.ldvlv_before_count = 0;
+   vlv.ldvlv_after_count  = (ber_int_t)(searchWindow.length - 1);
+   vlv.ldvlv_offset       = (ber_int_t)(searchWindow.location + 1);
+   vlv.ldvlv_count        = 0;
+   if ((searchContextID))
+   {
+      context.bv_val    = (char *)[searchContextID bytes];
+      context.bv_len    = [searchContextID length];
+      vlv.ldvlv_context = &context;
+   };
+   err = ldap_create_vlv_control(connection.ld, &vlv, &ctrls[1]);
+   if (err != LDAP_SUCCESS)
+   {
+      ldap_control_free(ctrls[0]);
+      ctrls[0] = NULL;
+   };
+
+   return(err);
+}
+
+
+- (void) parseSortControls:(LDAPControl **)ctrls
+{
+   int               err;
+   ber_int_t         code;
+   ber_int_t         target;
+   ber_int_t         count;
+   char            * attribute;
+   struct berval   * context;
+   LDAPControl     * ctrl;
+
+   // must be called while holding the lock of the connection
+   if (!(connection.ld))
+      return;
+
+   // a sort which failed without failing the search is reported as an error
+   if ((ctrl = ldap_control_find(LDAP_CONTROL_SORTRESPONSE, ctrls, NULL)) != NULL)
+   {
+      code      = LDAP_SUCCESS;
+      attribute = NULL;
+      err = ldap_parse_sortresponse_control(connection.ld, ctrl, &code, &attribute);
+      if ( (err == LDAP_SUCCESS) && (code != LDAP_SUCCESS) && ((self.isSuccessful)) )
+      {
+         self.errorCode = code;
+         if ((attribute))
+            self.diagnosticMessage = [NSString stringWithUTF8String:attribute];
+      };
+      ldap_memfree(attribute);
+   };
+
+   // stores the position of the window and the context of the result
+   if ((ctrl = ldap_control_find(LDAP_CONTROL_VLVRESPONSE, ctrls, NULL)) != NULL)
+   {
+      target  = 0;
+      count   = 0;
+      code    = LDAP_SUCCESS;
+      context = NULL;
+      err = ldap_parse_vlvresponse_control(connection.ld, ctrl, &target, &count,
+                                           &context, &code);
+      if (err != LDAP_SUCCESS)
+         return;
+      vlvOffset       = (target > 0) ? (NSUInteger)(target - 1) : 0;
+      vlvContentCount = (count  > 0) ? (NSUInteger)count : 0;
+      [vlvContextID release];
+      vlvContextID    = nil;
+      if ((context))
+         vlvContextID = [[NSData alloc] initWithBytes:context->bv_val length:context->bv_len];
+      ber_bvfree(context);
+      if ( (code != LDAP_SUCCESS) && ((self.isSuccessful)) )
+         self.errorCode = code;
+   };
+
+   return;
+}
+
+
+- (void) receiveSyncDone:(LDAPControl **)ctrls
+{
+   NSData        * cookie;
+   BerElement    * ber;
+   LDAPControl   * ctrl;
+   ber_len_t       len;
+   ber_int_t       refreshDeletes;
+
+   // parses the syncDoneValue (RFC 4533 section 2.4)
+   if ((ctrl = ldap_control_find(LDAP_CONTROL_SYNC_DONE, ctrls, NULL)) == NULL)
+      return;
+   if ((ber = ber_init(&ctrl->ldctl_value)) == NULL)
+      return;
+   cookie         = nil;
+   refreshDeletes = 0;
+   if (ber_scanf(ber, "{") != LBER_ERROR)
+   {
+      cookie = [self syncCookieWithBer:ber];
+      if (ber_peek_tag(ber, &len) == LDAP_TAG_REFRESHDELETES)
+         ber_scanf(ber, "b", &refreshDeletes);
+   };
+   ber_free(ber, 1);
+
+   // entries not reported during a present phase have been deleted
+   if (!(refreshDeletes))
+      [syncReplica removeEntriesNotPresent];
+   if ((cookie))
+      [syncReplica setCookie:cookie];
+
+   return;
+}
+
+
+- (void) receiveSyncEntry:(LDAPMessage *)msg
+{
+   int             err;
+   NSData        * cookie;
+   NSData        * uuid;
+   LKEntry       * entry;
+   BerElement    * ber;
+   LDAPControl  ** ctrls;
+   LDAPControl   * ctrl;
+   ber_int_t       state;
+   struct berval   value;
+
+   // parses the syncStateValue (RFC 4533 section 2.2)
+   ber   = NULL;
+   ctrl  = NULL;
+   ctrls = NULL;
+   err   = ldap_get_entry_controls(connection.ld, msg, &ctrls);
+   if ( (err == LDAP_SUCCESS) && ((ctrls)) )
+      ctrl = ldap_control_find(LDAP_CONTROL_SYNC_STATE, ctrls, NULL);
+   if ((ctrl))
+      ber = ber_init(&ctrl->ldctl_value);
+   if ( (!(ber)) || (ber_scanf(ber, "{em", &state, &value) == LBER_ERROR) )
+   {
+      if ((ber))
+         ber_free(ber, 1);
+      ldap_controls_free(ctrls);
+      ldap_msgfree(msg);
+      return;
+   };
+   uuid   = [[NSData alloc] initWithBytes:value.bv_val length:value.bv_len];
+   cookie = [self syncCookieWithBer:ber];
+   ber_free(ber, 1);
+   ldap_controls_free(ctrls);
+
+   // applies the entry to the replica
+   entry = [self newEntryWithMessage:msg];
+   [syncReplica applyState:state entry:entry uuid:uuid];
+   if ((cookie))
+      [syncReplica setCookie:cookie];
+   [entry release];
+   [uuid  release];
+
+   return;
+}
+
+
+- (int) syncBaseDN:(NSString *)dn attributes:(char **)attrs
+{
+   int                  msgid;
+   int                  mode;
+   int                  err;
+   NSData             * data;
+   BerElement         * ber;
+   struct berval        cookie;
+   struct berval        value;
+   LDAPControl        * serverctrls[2];
+   NSTimeInterval       start;
+
+   // encodes the syncRequestValue (RFC 4533 section 2.2)
+   if ((ber = ber_alloc_t(LBER_USE_DER)) == NULL)
+   {
+      [self resetErrorWithTitle:@"Internal LDAP Error" andCode:LDAP_NO_MEMORY];
+      return(-1);
+   };
+   mode = ((syncPersist)) ? LDAP_SYNC_REFRESH_AND_PERSIST : LDAP_SYNC_REFRESH_ONLY;
+   if ((data = syncReplica.cookie) != nil)
+   {
+      cookie.bv_val = (char *)[data bytes];
+      cookie.bv_len = [data length];
+      err = ber_printf(ber, "{eO}", mode, &cookie);
+   } else {
+      err = ber_printf(ber, "{e}", mode);
+   };
+   serverctrls[0] = NULL;
+   serverctrls[1] = NULL;
+   if ( (err != -1) && (ber_flatten2(ber, &value, 0) != -1) )
+      err = ldap_control_create(LDAP_CONTROL_SYNC, 1, &value, 1, &serverctrls[0]);
+   else
+      err = LDAP_ENCODING_ERROR;
+   ber_free(ber, 1);
+   if (err != LDAP_SUCCESS)
+   {
+      [self resetErrorWithTitle:@"Internal LDAP Error" andCode:err];
+      return(-1);
+   };
+
+   @synchronized(connection)
+   {
+      // checks session
+      if (!(connection.ld))
+      {
+         ldap_control_free(serverctrls[0]);
+         self.errorCode = LDAP_UNAVAILABLE;
+         return(-1);
+      };
+
+      // initiates search, the size and time limits would end a persisting
+      // synchronization
+      start = [self metricsStart];
+      self.errorCode = ldap_search_ext(
+         connection.ld,                   // LDAP            * ld
+         [dn UTF8String],                 // char            * base
+         searchScope,                     // int               scope
+         [searchFilter UTF8String],       // char            * filter
+         attrs,                           // char            * attrs[]
+         0,                               // int               attrsonly
+         serverctrls,                     // LDAPControl    ** serverctrls
+         NULL,                            // LDAPControl    ** clientctrls
+         NULL,                            // struct timeval  * timeout
+         0,                               // int               sizelimit
+         &msgid                           // int             * msgidp
+      );
+      [self metricsAddPhase:LKMetricsPhaseSend start:start];
+      ldap_control_free(serverctrls[0]);
+      [self updateConnectionHealth];
+      [self registerMessageID:msgid];
    };
 
    return(msgid);
 }
 
 
+- (NSData *) syncCookieWithBer:(BerElement *)ber
+{
+   ber_len_t       len;
+   struct berval   value;
+
+   // the optional cookie of a synchronization value
+   if (ber_peek_tag(ber, &len) != LDAP_TAG_SYNC_COOKIE)
+      return(nil);
+   if (ber_scanf(ber, "m", &value) == LBER_ERROR)
+      return(nil);
+
+   return([NSData dataWithBytes:value.bv_val length:value.bv_len]);
+}
+
+
+- (LKChange *) nextChange
+{
+   LKChange * change;
+
+   if ((changeList))
+   {
+      if (changesSent >= [changeList count])
+         return(nil);
+      return([changeList objectAtIndex:changesSent++]);
+   };
+
+   if ((change = [changeReader nextChange]) != nil)
+      changesSent++;
+
+   return(change);
+}
+
+
+- (int) sendChange:(LKChange *)change
+{
+   switch(change.changeType)
+   {
+      case LKLdapMessageTypeAdd:
+      return([self addDN:change.dn mods:change.modifications]);
+
+      case LKLdapMessageTypeDelete:
+      return([self deleteDN:change.dn]);
+
+      case LKLdapMessageTypeModify:
+      return([self modifyDN:change.dn mods:change.modifications]);
+
+      case LKLdapMessageTypeRename:
+      return([self renameDN:change.dn newRDN:change.relativeDN
+               newSuperior:change.superiorDN deleteOldRDN:change.deleteOldRDN]);
+
+      default:
+      break;
+   };
+   self.errorCode = LDAP_PARAM_ERROR;
+   return(-1);
+}
+
+
+- (BOOL) isDuplicateEntryDN:(NSString *)dn
+{
+   NSString * key;
+
+   // records the DN of an entry returned by a search of several base DNs,
+   // DNs are compared the same way LKSearchCache compares them
+   key = [LKSearchCache normalizedDN:dn];
+   if ([searchEntryDNs containsObject:key])
+      return(YES);
+   [searchEntryDNs addObject:key];
+
+   return(NO);
+}
+
+
+- (void) flushEntries
+{
+   NSMutableArray * delivered;
+   NSTimeInterval   start;
+
+   if (!([searchEntryBatch count]))
+      return;
+
+   // the handler owns the delivered batch, a new batch is started
+   delivered        = searchEntryBatch;
+   searchEntryBatch = [[NSMutableArray alloc] initWithCapacity:searchBatchSize];
+   start            = [self metricsStart];
+   if ((callbackQueue))
+      dispatch_sync(callbackQueue, ^{ searchEntryHandler(self, delivered); });
+   else
+      searchEntryHandler(self, delivered);
+   [self metricsAddPhase:LKMetricsPhaseDeliver start:start];
+   [delivered release];
+
+   return;
+}
+
+
+- (void) storeEntries:(NSMutableArray *)batch
+         resultEntries:(NSMutableArray *)results
+{
+   LKEntry           * entry;
+   NSString          * dn;
+   NSMutableIndexSet * duplicates;
+   NSUInteger          pos;
+   NSUInteger          limit;
+   NSTimeInterval      start;
+
+   if (!([batch count]))
+      return;
+
+   // removes entries already returned by another base DN
+   if ( ((searchEntryDNs)) && (!(results)) )
+   {
+      duplicates = [[NSMutableIndexSet alloc] init];
+      for(pos = 0; pos < [batch count]; pos++)
+      {
+         if ((dn = [[batch objectAtIndex:pos] dn]) == nil)
+            continue;
+         if ([self isDuplicateEntryDN:dn])
+            [duplicates addIndex:pos];
+      };
+      [batch removeObjectsAtIndexes:duplicates];
+      [duplicates release];
+   };
+
+   // the size limit applies to the entries of all base DNs
+   if ( (ldapSearchSizeLimit > 0) && (!(results)) )
+   {
+      limit = (NSUInteger)ldapSearchSizeLimit;
+      if (entryCount >= limit)
+         [batch removeAllObjects];
+      else if ((entryCount + [batch count]) > limit)
+         [batch removeObjectsInRange:NSMakeRange(limit - entryCount,
+                  [batch count] - (limit - entryCount))];
+   };
+   if (!([batch count]))
+      return;
+
+   // only delivered entries are counted
+   if (!(results))
+      entryCount += [batch count];
+
+   if ((results))
+   {
+      [results addObjectsFromArray:batch];
+   }
+   else if ((searchEntryHandler))
+   {
+      // streams entries to the handler without retaining them
+      for(entry in batch)
+      {
+         [searchEntryBatch addObject:entry];
+         if ([searchEntryBatch count] >= searchBatchSize)
+            [self flushEntries];
+      };
+   } else {
+      start = [self metricsStart];
+      if (!(callbackQueue))
+         [self willChangeValueForKey:@"entries"];
+      @synchronized(self)
+      {
+         if (!(entries))
+            entries = [[NSMutableArray alloc] initWithCapacity:[batch count]];
+         [entries addObjectsFromArray:batch];
+      };
+      if (!(callbackQueue))
+         [self didChangeValueForKey:@"entries"];
+      [self metricsAddPhase:LKMetricsPhaseDeliver start:start];
+   };
+   [batch removeAllObjects];
+
+   return;
+}
+
+
 #pragma mark - memory methods
 
 - (void) freeAttributeArray:(char ***)attributesp
@@ -0,0 +1,154 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKMetrics collects the latency and throughput of the operations performed
+ *  by an LKLdap object.
+ *
+ *  Each completed LKMessage is counted by its message type. The time the
+ *  message spends in each phase of its operation is added to a histogram of
+ *  the phase:
+ *
+ *  * `queue` - waiting in the operation queue before the message starts.
+ *  * `checkout` - waiting for a connection from the pool.
+ *  * `bind` - connecting, starting TLS, and authenticating.
+ *  * `send` - encoding and writing requests to the connection.
+ *  * `wait` - waiting for responses from the directory server.
+ *  * `decode` - creating LKEntry objects from received entries.
+ *  * `deliver` - passing entries to KVO observers and entry handlers.
+ *  * `total` - running the message, which excludes the time in the queue.
+ *
+ *  The boundaries of the histogram buckets are returned by `bucketBounds`.
+ *
+ *  Collection is disabled by default. A message which is queued while
+ *  collection is disabled is not measured, and its operation only checks a
+ *  pointer before each measurement. The results of a measured message are
+ *  added to the totals under a single lock when the message completes.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/models/LKMessage.h>
+
+
+#pragma mark - Operation phases
+enum ldap_kit_metrics_phase
+{
+   LKMetricsPhaseQueue                = 0x00,
+   LKMetricsPhaseCheckout             = 0x01,
+   LKMetricsPhaseBind                 = 0x02,
+   LKMetricsPhaseSend                 = 0x03,
+   LKMetricsPhaseWait                 = 0x04,
+   LKMetricsPhaseDecode               = 0x05,
+   LKMetricsPhaseDeliver              = 0x06,
+   LKMetricsPhaseTotal                = 0x07,
+   LKMetricsPhaseCount                = 0x08
+};
+typedef enum ldap_kit_metrics_phase LKMetricsPhase;
+
+
+#pragma mark - Data Types
+struct ldap_kit_metrics_operation;
+typedef struct ldap_kit_metrics_operation LKMetricsOperation;
+struct ldap_kit_metrics_sample;
+typedef struct ldap_kit_metrics_sample LKMetricsSample;
+
+
+@interface LKMetrics : NSObject
+{
+   // collection settings
+   BOOL                     isEnabled;
+
+   // operation metrics
+   LKMetricsOperation     * operations;
+
+   // throughput metrics
+   uint64_t                 entries;
+   uint64_t                 values;
+   uint64_t                 bytes;
+   uint64_t                 reconnects;
+   uint64_t                 connections;
+}
+
+#pragma mark - Collection settings
+/// @name Collection settings
+
+/// Whether messages queued by the LKLdap object are measured.
+///
+/// The default value is `NO`.
+@property (nonatomic, assign)   BOOL                     isEnabled;
+
+/// Removes every collected value.
+- (void) reset;
+
+
+#pragma mark - Histograms
+/// @name Histograms
+
+/// Returns the upper bounds (in seconds) of the histogram buckets.
+///
+/// The last bucket of a histogram has no upper bound and is not included.
++ (NSArray *) bucketBounds;
+
+/// Returns the name used for a message type in snapshots and exports.
+/// @param type The message type.
++ (NSString *) nameForMessageType:(LKLdapMessageType)type;
+
+/// Returns the name used for a phase in snapshots and exports.
+/// @param phase The operation phase.
++ (NSString *) nameForPhase:(LKMetricsPhase)phase;
+
+
+#pragma mark - Reading metrics
+/// @name Reading metrics
+
+/// Returns a consistent copy of the collected values.
+///
+/// The dictionary contains the NSNumber values `entries`, `values`, `bytes`,
+/// `reconnects`, and `connections`, and the dictionary `operations` which is
+/// keyed by the name of each message type which has completed. The
+/// dictionary of an operation contains the NSNumber values `count` and
+/// `failures` and the dictionary `phases` which is keyed by the name of each
+/// measured phase. The dictionary of a phase contains the NSNumber values
+/// `count` and `sum` (in seconds) and the array `buckets` with the number of
+/// measurements in each bucket, which are not cumulative.
+- (NSDictionary *) snapshot;
+
+/// Returns the collected values in the Prometheus text exposition format.
+///
+/// The phase histograms are exported as `ldapkit_operation_phase_seconds`
+/// with `operation` and `phase` labels. The number of entries and values
+/// decoded, the bytes of the DNs and values of the entries received,
+/// reconnections, and connections opened are exported as counters.
+- (NSString *) prometheusText;
+
+@end
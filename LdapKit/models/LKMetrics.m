@@ -0,0 +1,394 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKMetrics.m latency and throughput of LDAP operations
+ */
+#import "LKMetrics.h"
+#import "LKMetricsCategory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// number of message types which are counted separately
+#define LK_METRICS_OPERATION_COUNT 16
+
+// number of buckets in each histogram, including the unbounded bucket
+#define LK_METRICS_BUCKET_COUNT 17
+
+
+#pragma mark - Data Types
+struct ldap_kit_metrics_histogram
+{
+   uint64_t   count;                              // number of measurements
+   double     sum;                                // sum of the measurements
+   uint64_t   buckets[LK_METRICS_BUCKET_COUNT];   // measurements in each bucket
+};
+typedef struct ldap_kit_metrics_histogram LKMetricsHistogram;
+
+struct ldap_kit_metrics_operation
+{
+   uint64_t             count;                         // completed messages
+   uint64_t             failures;                      // unsuccessful messages
+   LKMetricsHistogram   phases[LKMetricsPhaseCount];   // time in each phase
+};
+
+
+#pragma mark - Bucket bounds
+// upper bounds (in seconds) of the histogram buckets
+static const double lk_metrics_bounds[LK_METRICS_BUCKET_COUNT - 1] =
+{
+   0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+   0.05,   0.1,     0.25,   0.5,   1.0,    2.5,   5.0,  10.0
+};
+
+
+@interface LKMetrics ()
+
+/// @name Recording metrics
+- (void) recordPhase:(LKMetricsPhase)phase time:(NSTimeInterval)time
+         operation:(LKMetricsOperation *)operation;
+
+@end
+
+
+@implementation LKMetrics
+
+// collection settings
+@synthesize isEnabled;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   free(operations);
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   if ((self = [super init]) == nil)
+      return(self);
+
+   if ((operations = calloc(LK_METRICS_OPERATION_COUNT, sizeof(LKMetricsOperation))) == NULL)
+   {
+      [self release];
+      return(nil);
+   };
+
+   isEnabled = NO;
+
+   return(self);
+}
+
+
+#pragma mark - Collection settings
+
+- (void) reset
+{
+   @synchronized(self)
+   {
+      memset(operations, 0, sizeof(LKMetricsOperation) * LK_METRICS_OPERATION_COUNT);
+      entries     = 0;
+      values      = 0;
+      bytes       = 0;
+      reconnects  = 0;
+      connections = 0;
+   };
+   return;
+}
+
+
+#pragma mark - Histograms
+
++ (NSArray *) bucketBounds
+{
+   NSMutableArray * bounds;
+   NSUInteger       pos;
+
+   bounds = [NSMutableArray arrayWithCapacity:(LK_METRICS_BUCKET_COUNT - 1)];
+   for(pos = 0; pos < (LK_METRICS_BUCKET_COUNT - 1); pos++)
+      [bounds addObject:[NSNumber numberWithDouble:lk_metrics_bounds[pos]]];
+
+   return(bounds);
+}
+
+
++ (NSString *) nameForMessageType:(LKLdapMessageType)type
+{
+   switch(type)
+   {
+      case LKLdapMessageTypeAdd:     return(@"add");
+      case LKLdapMessageTypeBatch:   return(@"batch");
+      case LKLdapMessageTypeBind:    return(@"bind");
+      case LKLdapMessageTypeDelete:  return(@"delete");
+      case LKLdapMessageTypeImport:  return(@"import");
+      case LKLdapMessageTypeModify:  return(@"modify");
+      case LKLdapMessageTypePrewarm: return(@"prewarm");
+      case LKLdapMessageTypeRebind:  return(@"rebind");
+      case LKLdapMessageTypeRename:  return(@"rename");
+      case LKLdapMessageTypeSearch:  return(@"search");
+      case LKLdapMessageTypeSync:    return(@"sync");
+      case LKLdapMessageTypeUnbind:  return(@"unbind");
+      case LKLdapMessageTypeWhoAmI:  return(@"whoami");
+      default:
+      break;
+   };
+   return(@"unknown");
+}
+
+
++ (NSString *) nameForPhase:(LKMetricsPhase)phase
+{
+   switch(phase)
+   {
+      case LKMetricsPhaseQueue:    return(@"queue");
+      case LKMetricsPhaseCheckout: return(@"checkout");
+      case LKMetricsPhaseBind:     return(@"bind");
+      case LKMetricsPhaseSend:     return(@"send");
+      case LKMetricsPhaseWait:     return(@"wait");
+      case LKMetricsPhaseDecode:   return(@"decode");
+      case LKMetricsPhaseDeliver:  return(@"deliver");
+      case LKMetricsPhaseTotal:    return(@"total");
+      default:
+      break;
+   };
+   return(@"unknown");
+}
+
+
+#pragma mark - Recording metrics
+
+- (void) recordPhase:(LKMetricsPhase)phase time:(NSTimeInterval)time
+         operation:(LKMetricsOperation *)operation
+{
+   LKMetricsHistogram * histogram;
+   NSUInteger           pos;
+
+   // must be called while holding the lock of the object
+   if (time < 0)
+      time = 0;
+   for(pos = 0; pos < (LK_METRICS_BUCKET_COUNT - 1); pos++)
+      if (time <= lk_metrics_bounds[pos])
+         break;
+
+   histogram = &operation->phases[phase];
+   histogram->count++;
+   histogram->sum += time;
+   histogram->buckets[pos]++;
+
+   return;
+}
+
+
+- (void) recordSample:(const LKMetricsSample *)sample
+         messageType:(LKLdapMessageType)type successful:(BOOL)successful
+{
+   LKMetricsOperation * operation;
+   NSUInteger           phase;
+
+   if ((NSUInteger)type >= LK_METRICS_OPERATION_COUNT)
+      type = LKLdapMessageTypeUnknown;
+
+   @synchronized(self)
+   {
+      operation = &operations[type];
+      operation->count++;
+      if (!(successful))
+         operation->failures++;
+
+      // phases which the operation did not enter are not measured
+      for(phase = 0; phase < LKMetricsPhaseCount; phase++)
+         if ( (sample->phases[phase] > 0) || (phase == LKMetricsPhaseTotal) )
+            [self recordPhase:phase time:sample->phases[phase] operation:operation];
+
+      entries     += sample->entries;
+      values      += sample->values;
+      bytes       += sample->bytes;
+      reconnects  += sample->reconnects;
+      connections += sample->connections;
+   };
+
+   return;
+}
+
+
+#pragma mark - Reading metrics
+
+- (NSString *) prometheusText
+{
+   NSMutableString * text;
+   NSDictionary    * snapshot;
+   NSDictionary    * ops;
+   NSDictionary    * op;
+   NSDictionary    * phases;
+   NSDictionary    * histogram;
+   NSArray         * buckets;
+   NSString        * name;
+   NSString        * phase;
+   NSUInteger        phaseIndex;
+   NSUInteger        pos;
+   uint64_t          cumulative;
+
+   snapshot = [self snapshot];
+   ops      = [snapshot objectForKey:@"operations"];
+   text     = [NSMutableString stringWithCapacity:4096];
+
+   // operation counters
+   [text appendString:@"# HELP ldapkit_operations_total Number of completed LDAP operations.\n"];
+   [text appendString:@"# TYPE ldapkit_operations_total counter\n"];
+   for(name in [[ops allKeys] sortedArrayUsingSelector:@selector(compare:)])
+      [text appendFormat:@"ldapkit_operations_total{operation=\"%@\"} %llu\n", name,
+         [[[ops objectForKey:name] objectForKey:@"count"] unsignedLongLongValue]];
+   [text appendString:@"# HELP ldapkit_operation_failures_total Number of unsuccessful LDAP operations.\n"];
+   [text appendString:@"# TYPE ldapkit_operation_failures_total counter\n"];
+   for(name in [[ops allKeys] sortedArrayUsingSelector:@selector(compare:)])
+      [text appendFormat:@"ldapkit_operation_failures_total{operation=\"%@\"} %llu\n", name,
+         [[[ops objectForKey:name] objectForKey:@"failures"] unsignedLongLongValue]];
+
+   // phase histograms
+   [text appendString:@"# HELP ldapkit_operation_phase_seconds Time spent in each phase of LDAP operations.\n"];
+   [text appendString:@"# TYPE ldapkit_operation_phase_seconds histogram\n"];
+   for(name in [[ops allKeys] sortedArrayUsingSelector:@selector(compare:)])
+   {
+      op     = [ops objectForKey:name];
+      phases = [op objectForKey:@"phases"];
+      for(phaseIndex = 0; phaseIndex < LKMetricsPhaseCount; phaseIndex++)
+      {
+         phase = [LKMetrics nameForPhase:phaseIndex];
+         if ((histogram = [phases objectForKey:phase]) == nil)
+            continue;
+         buckets    = [histogram objectForKey:@"buckets"];
+         cumulative = 0;
+         for(pos = 0; pos < (LK_METRICS_BUCKET_COUNT - 1); pos++)
+         {
+            cumulative += [[buckets objectAtIndex:pos] unsignedLongLongValue];
+            [text appendFormat:@"ldapkit_operation_phase_seconds_bucket{operation=\"%@\",phase=\"%@\",le=\"%g\"} %llu\n",
+               name, phase, lk_metrics_bounds[pos], cumulative];
+         };
+         [text appendFormat:@"ldapkit_operation_phase_seconds_bucket{operation=\"%@\",phase=\"%@\",le=\"+Inf\"} %llu\n",
+            name, phase, [[histogram objectForKey:@"count"] unsignedLongLongValue]];
+         [text appendFormat:@"ldapkit_operation_phase_seconds_sum{operation=\"%@\",phase=\"%@\"} %.9f\n",
+            name, phase, [[histogram objectForKey:@"sum"] doubleValue]];
+         [text appendFormat:@"ldapkit_operation_phase_seconds_count{operation=\"%@\",phase=\"%@\"} %llu\n",
+            name, phase, [[histogram objectForKey:@"count"] unsignedLongLongValue]];
+      };
+   };
+
+   // throughput counters
+   [text appendString:@"# HELP ldapkit_entries_decoded_total Number of entries received by searches.\n"];
+   [text appendString:@"# TYPE ldapkit_entries_decoded_total counter\n"];
+   [text appendFormat:@"ldapkit_entries_decoded_total %llu\n", [[snapshot objectForKey:@"entries"] unsignedLongLongValue]];
+   [text appendString:@"# HELP ldapkit_values_decoded_total Number of attribute values received by searches.\n"];
+   [text appendString:@"# TYPE ldapkit_values_decoded_total counter\n"];
+   [text appendFormat:@"ldapkit_values_decoded_total %llu\n", [[snapshot objectForKey:@"values"] unsignedLongLongValue]];
+   [text appendString:@"# HELP ldapkit_received_bytes_total Bytes of the DNs and values of received entries.\n"];
+   [text appendString:@"# TYPE ldapkit_received_bytes_total counter\n"];
+   [text appendFormat:@"ldapkit_received_bytes_total %llu\n", [[snapshot objectForKey:@"bytes"] unsignedLongLongValue]];
+   [text appendString:@"# HELP ldapkit_reconnects_total Number of connections reopened after errors.\n"];
+   [text appendString:@"# TYPE ldapkit_reconnects_total counter\n"];
+   [text appendFormat:@"ldapkit_reconnects_total %llu\n", [[snapshot objectForKey:@"reconnects"] unsignedLongLongValue]];
+   [text appendString:@"# HELP ldapkit_connections_opened_total Number of connections opened.\n"];
+   [text appendString:@"# TYPE ldapkit_connections_opened_total counter\n"];
+   [text appendFormat:@"ldapkit_connections_opened_total %llu\n", [[snapshot objectForKey:@"connections"] unsignedLongLongValue]];
+
+   return(text);
+}
+
+
+- (NSDictionary *) snapshot
+{
+   NSMutableDictionary * snapshot;
+   NSMutableDictionary * ops;
+   NSMutableDictionary * phases;
+   NSMutableArray      * buckets;
+   LKMetricsOperation  * operation;
+   LKMetricsHistogram  * histogram;
+   NSUInteger            type;
+   NSUInteger            phase;
+   NSUInteger            pos;
+
+   snapshot = [NSMutableDictionary dictionaryWithCapacity:6];
+   ops      = [NSMutableDictionary dictionaryWithCapacity:LK_METRICS_OPERATION_COUNT];
+
+   @synchronized(self)
+   {
+      for(type = 0; type < LK_METRICS_OPERATION_COUNT; type++)
+      {
+         operation = &operations[type];
+         if (!(operation->count))
+            continue;
+
+         phases = [NSMutableDictionary dictionaryWithCapacity:LKMetricsPhaseCount];
+         for(phase = 0; phase < LKMetricsPhaseCount; phase++)
+         {
+            histogram = &operation->phases[phase];
+            if (!(histogram->count))
+               continue;
+            buckets = [NSMutableArray arrayWithCapacity:LK_METRICS_BUCKET_COUNT];
+            for(pos = 0; pos < LK_METRICS_BUCKET_COUNT; pos++)
+               [buckets addObject:[NSNumber numberWithUnsignedLongLong:histogram->buckets[pos]]];
+            [phases setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                  [NSNumber numberWithUnsignedLongLong:histogram->count], @"count",
+                  [NSNumber numberWithDouble:histogram->sum],             @"sum",
+                  buckets,                                                @"buckets",
+                  nil]
+               forKey:[LKMetrics nameForPhase:phase]];
+         };
+
+         [ops setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+               [NSNumber numberWithUnsignedLongLong:operation->count],    @"count",
+               [NSNumber numberWithUnsignedLongLong:operation->failures], @"failures",
+               phases,                                                    @"phases",
+               nil]
+            forKey:[LKMetrics nameForMessageType:type]];
+      };
+
+      [snapshot setObject:[NSNumber numberWithUnsignedLongLong:entries]     forKey:@"entries"];
+      [snapshot setObject:[NSNumber numberWithUnsignedLongLong:values]      forKey:@"values"];
+      [snapshot setObject:[NSNumber numberWithUnsignedLongLong:bytes]       forKey:@"bytes"];
+      [snapshot setObject:[NSNumber numberWithUnsignedLongLong:reconnects]  forKey:@"reconnects"];
+      [snapshot setObject:[NSNumber numberWithUnsignedLongLong:connections] forKey:@"connections"];
+   };
+
+   [snapshot setObject:ops forKey:@"operations"];
+
+   return(snapshot);
+}
+
+@end
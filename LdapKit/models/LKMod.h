@@ -54,13 +54,15 @@ typedef enum ldap_kit_ldap_mod_operation LKLdapModOperation;
    // modification information
    LKLdapModOperation   _modOp;
    NSString           * _modType;
-   NSArray            * _modValues;
+   NSMutableArray     * _modValues;
 }
 
 #pragma mark - Object Management Methods
 /// @name Object Management Methods
 
 /// Initialize a new object
+///
+/// Without values, a delete or a replace removes the attribute from the entry.
 /// @param modOp     The type of operation to perform on the attribute. See
 /// modOp for valid values.
 /// @param modType   The attribute to modify.
@@ -83,6 +85,8 @@ typedef enum ldap_kit_ldap_mod_operation LKLdapModOperation;
        values:(NSArray *)modValues;
 
 /// Creates a new object
+///
+/// Without values, a delete or a replace removes the attribute from the entry.
 /// @param modOp     The type of operation to perform on the attribute. See
 /// modOp for valid values.
 /// @param modType   The attribute to modify.
@@ -127,11 +131,23 @@ typedef enum ldap_kit_ldap_mod_operation LKLdapModOperation;
 /// @param modValue Value to append to modification values.
 - (void) addValue:(id <NSObject, NSCopying>)modValue;
 
+/// Add values to list of modifications.
+///
+/// Appending values takes amortized constant time, so large multi-valued
+/// attributes may be built one value at a time or in bulk.
+/// @param modValues Array of LKBerValue, NSData, and NSString objects to append
+/// to modification values.
+- (void) addValues:(NSArray *)modValues;
+
 
 #pragma mark - Manager LDAPMod References
 /// @name Manager LDAPMod References
 
 /// Allocate a new LDAPMod reference.
+///
+/// The LDAPMod, the value vector, and the attribute name are stored in a
+/// single allocation. Values reference the bytes of the object's NSData and
+/// LKBerValue values instead of copying them.
 /// @return This method returns a pointer to a `LDAPMod` reference. The
 /// `LDAPMod` reference must be freed using `+freeLDAPMod:`.
 - (LDAPMod *) newLDAPMod;
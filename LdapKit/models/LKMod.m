@@ -39,6 +39,16 @@
 #import "LKBerValue.h"
 
 
+// LDAPMod allocated by newLDAPMod, the values array keeps the referenced
+// bytes allocated until the LDAPMod is freed
+struct ldap_kit_mod_buffer
+{
+   LDAPMod   mod;
+   NSArray * values;
+};
+typedef struct ldap_kit_mod_buffer LKModBuffer;
+
+
 @implementation LKMod
 
 // Modication data
@@ -69,9 +79,9 @@
 - (id) initWithOperation:(LKLdapModOperation)modOp type:(NSString *)modType
 {
    NSAssert(((modType)), @"modType must not be nil");
-   NSAssert( ( (modOp == LKLdapModOperationAdd) ||
-               (modOp == LKLdapModOperationDelete) ),
-             @"modOp must be LKLdapModOperationAdd or LKLdapModOperationDelete.");
+   NSAssert( ( (modOp == LKLdapModOperationDelete) ||
+               (modOp == LKLdapModOperationReplace) ),
+             @"modOp must be LKLdapModOperationDelete or LKLdapModOperationReplace.");
    return([self initWithOperation:modOp type:modType values:nil]);
 }
 
@@ -113,8 +123,8 @@
                (modOp == LKLdapModOperationReplace) ),
              ( @"modOp must be LKLdapModOperationAdd, LKLdapModOperationDelete,"
                @" or LKLdapModOperationReplace" ) );
-   if ((modOp == LKLdapModOperationAdd) || (modOp == LKLdapModOperationReplace))
-      NSAssert(((modValues)), @"modValues must not be nil for LKLdapModOperationAdd or LKLdapModOperationReplace");
+   if (modOp == LKLdapModOperationAdd)
+      NSAssert(((modValues)), @"modValues must not be nil for LKLdapModOperationAdd");
    if ((modValues))
       NSAssert((([modValues count])), @"modValues must contain at least one member");
    for(pos = 0; pos < [modValues count]; pos++)
@@ -132,7 +142,8 @@
    // modification information
    _modOp     = modOp;
    _modType   = [[NSString allocWithZone:self.zone] initWithString:modType];
-   _modValues = [[NSArray allocWithZone:self.zone] initWithArray:modValues copyItems:YES];
+   if ((modValues))
+      _modValues = [[NSMutableArray allocWithZone:self.zone] initWithArray:modValues copyItems:YES];
 
    return(self);
 }
@@ -141,9 +152,9 @@
 + (id) modWithOperation:(LKLdapModOperation)modOp type:(NSString *)modType
 {
    NSAssert(((modType)), @"modType must not be nil");
-   NSAssert( ( (modOp == LKLdapModOperationAdd) ||
-               (modOp == LKLdapModOperationDelete) ),
-             @"modOp must be LKLdapModOperationAdd or LKLdapModOperationDelete.");
+   NSAssert( ( (modOp == LKLdapModOperationDelete) ||
+               (modOp == LKLdapModOperationReplace) ),
+             @"modOp must be LKLdapModOperationDelete or LKLdapModOperationReplace.");
    return([[[LKMod alloc] initWithOperation:modOp type:modType] autorelease]);
 }
 
@@ -178,8 +189,8 @@
                (modOp == LKLdapModOperationReplace) ),
              ( @"modOp must be LKLdapModOperationAdd, LKLdapModOperationDelete,"
                @" or LKLdapModOperationReplace" ) );
-   if ((modOp == LKLdapModOperationAdd) || (modOp == LKLdapModOperationReplace))
-      NSAssert(((modValues)), @"modValues must not be nil for LKLdapModOperationAdd or LKLdapModOperationReplace");
+   if (modOp == LKLdapModOperationAdd)
+      NSAssert(((modValues)), @"modValues must not be nil for LKLdapModOperationAdd");
    if ((modValues))
       NSAssert((([modValues count])), @"modValues must contain at least one member");
    for(pos = 0; pos < [modValues count]; pos++)
@@ -210,7 +221,9 @@
 {
    @synchronized(self)
    {
-      return([[_modValues retain] autorelease]);
+      if (!(_modValues))
+         return(nil);
+      return([[[NSArray alloc] initWithArray:_modValues] autorelease]);
    };
 }
 
@@ -219,23 +232,46 @@
 
 - (void) addValue:(id <NSObject, NSCopying>)modValue
 {
-   NSMutableArray           * tmpArray;
-   id <NSObject, NSCopying>   object;      
+   id <NSObject, NSCopying>   object;
    NSAssert( ( (([modValue isKindOfClass:[LKBerValue class]])) ||
                (([modValue isKindOfClass:[NSString class]]))   ||
                (([modValue isKindOfClass:[NSData class]]))     ),
              @"modValues must only contain LKBerValue, NSData, and NSString objects.");
    @synchronized(self)
    {
-      tmpArray = [[NSMutableArray alloc] initWithCapacity:([_modValues count]+1)];
-      if ((_modValues))
-         [tmpArray addObjectsFromArray:_modValues];
+      if (!(_modValues))
+         _modValues = [[NSMutableArray allocWithZone:self.zone] initWithCapacity:1];
       object = [modValue copyWithZone:self.zone];
-      [tmpArray addObject:object];
+      [_modValues addObject:object];
       [object release];
-      [_modValues release];
-      _modValues = [[NSArray alloc] initWithArray:tmpArray];
-      [tmpArray release];
+   };
+   return;
+}
+
+
+- (void) addValues:(NSArray *)modValues
+{
+   NSUInteger                 pos;
+   id <NSObject, NSCopying>   object;
+   NSAssert(((modValues)), @"modValues must not be nil");
+   for(pos = 0; pos < [modValues count]; pos++)
+   {
+      object = [modValues objectAtIndex:pos];
+      NSAssert( ( (([object isKindOfClass:[LKBerValue class]])) ||
+                  (([object isKindOfClass:[NSString class]]))   ||
+                  (([object isKindOfClass:[NSData class]]))     ),
+         @"modValues must only contain LKBerValue, NSData, and NSString objects.");
+   };
+   @synchronized(self)
+   {
+      if (!(_modValues))
+         _modValues = [[NSMutableArray allocWithZone:self.zone] initWithCapacity:[modValues count]];
+      for(object in modValues)
+      {
+         object = [object copyWithZone:self.zone];
+         [_modValues addObject:object];
+         [object release];
+      };
    };
    return;
 }
@@ -245,81 +281,80 @@
 
 - (LDAPMod *) newLDAPMod
 {
-   LDAPMod            * mod;
+   LKModBuffer        * buffer;
    size_t               len;
    size_t               pos;
+   size_t               typeLen;
+   const char         * type;
    id                   value;
+   NSData             * data;
+   NSMutableArray     * values;
    BerValue           * bval;
    BerValue          ** bvals;
    NSAutoreleasePool  * pool;
 
    @synchronized(self)
    {
-      // allocates memory for LDAPMod
-      if ((mod = malloc(sizeof(LDAPMod))) == NULL)
-         return(mod);
-
       pool = [[NSAutoreleasePool alloc] init];
 
-      // generates list of mod values
-      bvals = NULL;
-      if ((_modValues))
+      // collects the bytes of each value, only strings are converted
+      len    = [_modValues count];
+      values = [[NSMutableArray alloc] initWithCapacity:len];
+      for(value in _modValues)
       {
-         len   = [_modValues count];
-
-         if ((bvals = malloc(sizeof(BerValue *))) == NULL)
-         {
-            [LKMod freeLDAPMod:mod];
-            [pool release];
-            return(NULL);
-         };
-         bvals[0] = NULL;
-
-         for(pos = 0; ((pos < len) && ((bvals))); pos++)
-         {
-            bval  = NULL;
-            value = [_modValues objectAtIndex:pos];
-            if (([value isKindOfClass:[LKBerValue class]]))
-               bval = [(LKBerValue *)value newBerValue];
-            else if (([value isKindOfClass:[NSData class]]))
-               bval = [LKBerValue newBerValueWithData:value];
-            else
-               bval = ber_bvstrdup([(NSString *)value UTF8String]);
-            if (!(bval))
-            {
-               [LKMod freeLDAPMod:mod];
-               [pool release];
-               return(NULL);
-            };
-            ber_bvecadd(&bvals, bval);
-         };
+         if (([value isKindOfClass:[LKBerValue class]]))
+            data = [(LKBerValue *)value berData];
+         else if (([value isKindOfClass:[NSData class]]))
+            data = value;
+         else
+            data = [(NSString *)value dataUsingEncoding:NSUTF8StringEncoding];
+         [values addObject:data];
       };
 
-      mod->mod_op              = _modOp;
-      mod->mod_type            = strdup([_modType UTF8String]);
-      mod->mod_vals.modv_bvals = bvals;
+      // allocates the LDAPMod, value vector, values, and type at once
+      type    = [_modType UTF8String];
+      typeLen = strlen(type) + 1;
+      buffer  = malloc(sizeof(LKModBuffer) + (sizeof(BerValue *) * (len + 1)) +
+                       (sizeof(BerValue) * len) + typeLen);
+      if (buffer == NULL)
+      {
+         [values release];
+         [pool release];
+         return(NULL);
+      };
+      bvals = (BerValue **)&buffer[1];
+      bval  = (BerValue *)&bvals[len + 1];
 
-      [pool release];
-   };
+      // references the bytes of each value
+      for(pos = 0; pos < len; pos++)
+      {
+         data              = [values objectAtIndex:pos];
+         bval[pos].bv_len  = [data length];
+         bval[pos].bv_val  = (char *)[data bytes];
+         bvals[pos]        = &bval[pos];
+      };
+      bvals[len] = NULL;
 
-   if (!(mod->mod_type))
-   {
-      [LKMod freeLDAPMod:mod];
-      return(NULL);
+      buffer->values                  = values;
+      buffer->mod.mod_op              = _modOp | LDAP_MOD_BVALUES;
+      buffer->mod.mod_type            = (char *)&bval[len];
+      buffer->mod.mod_vals.modv_bvals = ((_modValues)) ? bvals : NULL;
+      memcpy(buffer->mod.mod_type, type, typeLen);
+
+      [pool release];
    };
 
-   return(mod);
+   return(&buffer->mod);
 }
 
 
 + (void) freeLDAPMod:(LDAPMod *)mod
 {
+   LKModBuffer * buffer;
    NSAssert((mod != NULL), @"mod must not be NULL");
-   if ((mod->mod_type))
-      free(mod->mod_type);
-   if ((mod->mod_vals.modv_bvals))
-      ber_bvecfree(mod->mod_vals.modv_bvals);
-   free(mod);
+   buffer = (LKModBuffer *)mod;
+   [buffer->values release];
+   free(buffer);
    return;
 }
 
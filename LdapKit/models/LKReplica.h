@@ -0,0 +1,167 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKReplica stores an in-process copy of the entries of a subtree which is
+ *  kept up to date by a synchronization started with
+ *  [LKLdap ldapSyncBaseDN:scope:filter:attributes:replica:persist:].
+ *
+ *  The synchronization uses the LDAP Content Synchronization Operation
+ *  (RFC 4533). Entries are indexed by their DN and by the entryUUID sent by
+ *  the server, so lookups are answered without contacting the server. Each
+ *  change applied to the replica is passed to the observers of the replica.
+ *
+ *  The replica keeps the synchronization cookie of the last change it
+ *  received. A replica written with writeToFile: and loaded with
+ *  initWithContentsOfFile: resumes with a delta refresh which only transfers
+ *  the changes made since the cookie was received.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/LKEnumerations.h>
+
+
+#pragma mark LDAP replica change
+enum ldap_kit_replica_change
+{
+   LKReplicaChangeAdd          = 0x01,
+   LKReplicaChangeModify       = 0x02,
+   LKReplicaChangeDelete       = 0x03
+};
+typedef enum ldap_kit_replica_change LKReplicaChange;
+
+
+@class LKEntry;
+@class LKReplica;
+
+
+#pragma mark LDAP replica observer
+/// Block invoked each time an entry of a replica is added, modified, or
+/// deleted. Deleted entries are passed as they were before the deletion.
+typedef void (^LKReplicaObserver)(LKReplica * replica, LKEntry * entry,
+                                  LKReplicaChange change);
+
+
+@interface LKReplica : NSObject
+{
+   // replicated entries
+   NSMutableDictionary * entriesByUUID;
+   NSMutableDictionary * uuidsByDN;
+   NSData              * cookie;
+
+   // refresh state
+   NSMutableSet        * presentUUIDs;
+   BOOL                  isSynchronized;
+
+   // observers
+   NSMutableArray      * observers;
+}
+
+#pragma mark - Object Management Methods
+/// @name Object Management Methods
+
+/// Initialize an empty replica.
+- (id) init;
+
+/// Initialize a replica with the entries and cookie saved by writeToFile:.
+/// @param path The path of the file.
+/// @return Returns `nil` if the file could not be read.
+- (id) initWithContentsOfFile:(NSString *)path;
+
+
+#pragma mark - Replica information
+/// @name Replica information
+
+/// The synchronization cookie of the last change received, or `nil` if the
+/// replica has not been synchronized.
+@property (atomic, readonly)    NSData              * cookie;
+
+/// The number of entries in the replica.
+@property (atomic, readonly)    NSUInteger            count;
+
+/// Indicates whether the refresh phase of the last synchronization has
+/// completed. While a synchronization is persisting, the replica remains
+/// synchronized as changes are received.
+@property (atomic, readonly)    BOOL                  isSynchronized;
+
+/// Removes every entry and the cookie. The next synchronization transfers
+/// the entire content of the subtree.
+- (void) removeAllEntries;
+
+
+#pragma mark - Local lookups
+/// @name Local lookups
+
+/// An array of every LKEntry in the replica.
+@property (atomic, readonly)    NSArray             * entries;
+
+/// Returns the entry with a DN.
+/// @param dn The DN of the entry. DNs are compared case-insensitively.
+/// @return Returns the LKEntry or `nil` if the DN is not in the replica.
+- (LKEntry *) entryForDN:(NSString *)dn;
+
+/// Returns the entries which match a search filter.
+///
+/// The filter is evaluated by LKFilter without contacting the server.
+/// @param filter The string representation of the filter.
+/// @return Returns an array of LKEntry objects or `nil` if the filter is not
+/// valid.
+- (NSArray *) entriesMatchingFilter:(NSString *)filter;
+
+
+#pragma mark - Observers
+/// @name Observers
+
+/// Registers a block which is invoked with each change to the replica.
+///
+/// Observers are invoked on the thread executing the synchronization and
+/// should return quickly, since responses from the server are not processed
+/// while an observer is running.
+/// @param observer The block to invoke.
+/// @return Returns an object which identifies the observer.
+- (id) addObserver:(LKReplicaObserver)observer;
+
+/// Stops invoking an observer.
+/// @param observer The object returned by addObserver:.
+- (void) removeObserver:(id)observer;
+
+
+#pragma mark - Persistence
+/// @name Persistence
+
+/// Writes the entries and cookie of the replica to a file.
+/// @param path The path of the file.
+/// @return Returns `YES` if the file was written.
+- (BOOL) writeToFile:(NSString *)path;
+
+@end
@@ -0,0 +1,527 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKReplica.m in-process replica of a subtree
+ */
+#import "LKReplica.h"
+#import "LKReplicaCategory.h"
+
+#include <ldap.h>
+
+#import "LKBerValue.h"
+#import "LKEntry.h"
+#import "LKEntryCategory.h"
+#import "LKFilter.h"
+#import "LKSearchCache.h"
+#import "LKSearchCacheCategory.h"
+
+
+@interface LKReplica ()
+
+/// @name Applying changes
+- (LKEntry *) removeEntryWithUUID:(NSData *)uuid;
+
+/// @name Observers
+- (void) notifyObservers:(NSArray *)changes;
+
+@end
+
+
+@implementation LKReplica
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // replicated entries
+   [entriesByUUID release];
+   [uuidsByDN     release];
+   [cookie        release];
+
+   // refresh state
+   [presentUUIDs release];
+
+   // observers
+   [observers release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // replicated entries
+   entriesByUUID = [[NSMutableDictionary alloc] initWithCapacity:64];
+   uuidsByDN     = [[NSMutableDictionary alloc] initWithCapacity:64];
+
+   // observers
+   observers = [[NSMutableArray alloc] initWithCapacity:1];
+
+   return(self);
+}
+
+
+- (id) initWithContentsOfFile:(NSString *)path
+{
+   NSAutoreleasePool * pool;
+   NSData            * data;
+   NSDictionary      * plist;
+   NSDictionary      * record;
+   NSDictionary      * attributes;
+   NSString          * dn;
+   NSString          * name;
+   NSData            * uuid;
+   NSArray           * values;
+   LKEntry           * entry;
+   BerValue          * bervals;
+   BerValue         ** bervalps;
+   NSUInteger          pos;
+
+   if ((self = [self init]) == nil)
+      return(self);
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   // reads the property list written by writeToFile:
+   plist = nil;
+   if ((data = [NSData dataWithContentsOfFile:path]) != nil)
+      plist = [NSPropertyListSerialization propertyListWithData:data
+               options:NSPropertyListImmutable format:NULL error:NULL];
+   if (!([plist isKindOfClass:[NSDictionary class]]))
+   {
+      [pool release];
+      [self release];
+      return(nil);
+   };
+   if ([[plist objectForKey:@"cookie"] isKindOfClass:[NSData class]])
+      cookie = [[plist objectForKey:@"cookie"] retain];
+
+   // recreates the entries
+   for(record in [plist objectForKey:@"entries"])
+   {
+      dn         = [record objectForKey:@"dn"];
+      uuid       = [record objectForKey:@"uuid"];
+      attributes = [record objectForKey:@"attributes"];
+      if ( (!(dn)) || (!(uuid)) )
+         continue;
+      entry = [[LKEntry alloc] initWithDn:[dn UTF8String]];
+      for(name in attributes)
+      {
+         values   = [attributes objectForKey:name];
+         bervals  = malloc(sizeof(BerValue) * ([values count] + 1));
+         bervalps = malloc(sizeof(BerValue *) * ([values count] + 1));
+         if ( (!(bervals)) || (!(bervalps)) )
+         {
+            free(bervals);
+            free(bervalps);
+            continue;
+         };
+         for(pos = 0; pos < [values count]; pos++)
+         {
+            bervals[pos].bv_val = (char *)[[values objectAtIndex:pos] bytes];
+            bervals[pos].bv_len = [[values objectAtIndex:pos] length];
+            bervalps[pos]       = &bervals[pos];
+         };
+         bervalps[pos] = NULL;
+         [entry setBerValues:bervalps forAttribute:[name UTF8String]];
+         free(bervals);
+         free(bervalps);
+      };
+      [entriesByUUID setObject:entry forKey:uuid];
+      [uuidsByDN setObject:uuid forKey:[LKSearchCache normalizedDN:dn]];
+      [entry release];
+   };
+
+   [pool release];
+
+   return(self);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSData *) cookie
+{
+   @synchronized(self)
+   {
+      return([[cookie retain] autorelease]);
+   };
+}
+
+
+- (void) setCookie:(NSData *)data
+{
+   @synchronized(self)
+   {
+      [cookie release];
+      cookie = [data copy];
+   };
+   return;
+}
+
+
+- (NSUInteger) count
+{
+   @synchronized(self)
+   {
+      return([entriesByUUID count]);
+   };
+}
+
+
+- (NSArray *) entries
+{
+   @synchronized(self)
+   {
+      return([entriesByUUID allValues]);
+   };
+}
+
+
+- (BOOL) isSynchronized
+{
+   @synchronized(self)
+   {
+      return(isSynchronized);
+   };
+}
+
+
+#pragma mark - Local lookups
+
+- (LKEntry *) entryForDN:(NSString *)dn
+{
+   NSString * normalized;
+   NSData   * uuid;
+   normalized = [LKSearchCache normalizedDN:dn];
+   @synchronized(self)
+   {
+      if ((uuid = [uuidsByDN objectForKey:normalized]) == nil)
+         return(nil);
+      return([[[entriesByUUID objectForKey:uuid] retain] autorelease]);
+   };
+}
+
+
+- (NSArray *) entriesMatchingFilter:(NSString *)filter
+{
+   LKFilter * compiled;
+   NSArray  * matches;
+   NSAssert((filter != nil), @"filter must not be nil");
+   if ((compiled = [[LKFilter alloc] initWithString:filter]) == nil)
+      return(nil);
+   matches = [compiled filterEntries:self.entries];
+   [compiled release];
+   return(matches);
+}
+
+
+- (void) removeAllEntries
+{
+   @synchronized(self)
+   {
+      [entriesByUUID removeAllObjects];
+      [uuidsByDN     removeAllObjects];
+      [cookie release];
+      cookie = nil;
+   };
+   return;
+}
+
+
+#pragma mark - Refresh state
+
+- (void) beginRefresh
+{
+   @synchronized(self)
+   {
+      // entries which are not reported as present are removed at the end
+      // of the present phase
+      [presentUUIDs release];
+      presentUUIDs   = [[NSMutableSet alloc] initWithCapacity:[entriesByUUID count]];
+      isSynchronized = NO;
+   };
+   return;
+}
+
+
+- (void) endRefresh
+{
+   @synchronized(self)
+   {
+      [presentUUIDs release];
+      presentUUIDs   = nil;
+      isSynchronized = YES;
+   };
+   return;
+}
+
+
+- (void) removeEntriesNotPresent
+{
+   NSMutableArray * changes;
+   NSArray        * uuids;
+   NSData         * uuid;
+   LKEntry        * entry;
+
+   changes = [[NSMutableArray alloc] init];
+
+   @synchronized(self)
+   {
+      if ((presentUUIDs))
+      {
+         uuids = [entriesByUUID allKeys];
+         for(uuid in uuids)
+         {
+            if ([presentUUIDs containsObject:uuid])
+               continue;
+            if ((entry = [self removeEntryWithUUID:uuid]) != nil)
+               [changes addObject:[NSArray arrayWithObjects:entry,
+                  [NSNumber numberWithInt:LKReplicaChangeDelete], nil]];
+         };
+         [presentUUIDs release];
+         presentUUIDs = nil;
+      };
+   };
+
+   [self notifyObservers:changes];
+   [changes release];
+
+   return;
+}
+
+
+#pragma mark - Applying changes
+
+- (void) applyState:(NSInteger)state entry:(LKEntry *)entry uuid:(NSData *)uuid
+{
+   NSMutableArray * changes;
+   LKEntry        * previous;
+   NSData         * previousUUID;
+   NSString       * dn;
+
+   changes = [[NSMutableArray alloc] initWithCapacity:1];
+   dn      = [LKSearchCache normalizedDN:entry.dn];
+
+   @synchronized(self)
+   {
+      switch(state)
+      {
+         case LDAP_SYNC_PRESENT:
+         [presentUUIDs addObject:uuid];
+         break;
+
+         case LDAP_SYNC_ADD:
+         case LDAP_SYNC_MODIFY:
+         [presentUUIDs addObject:uuid];
+         previous = [[[entriesByUUID objectForKey:uuid] retain] autorelease];
+         if ((previous))
+            [uuidsByDN removeObjectForKey:[LKSearchCache normalizedDN:previous.dn]];
+         [entriesByUUID setObject:entry forKey:uuid];
+         [uuidsByDN setObject:uuid forKey:dn];
+         [changes addObject:[NSArray arrayWithObjects:entry, [NSNumber numberWithInt:
+            ((previous)) ? LKReplicaChangeModify : LKReplicaChangeAdd], nil]];
+         break;
+
+         case LDAP_SYNC_DELETE:
+         previous = [self removeEntryWithUUID:uuid];
+         if ( (!(previous)) && ((previousUUID = [uuidsByDN objectForKey:dn]) != nil) )
+            previous = [self removeEntryWithUUID:previousUUID];
+         if ((previous))
+            [changes addObject:[NSArray arrayWithObjects:previous,
+               [NSNumber numberWithInt:LKReplicaChangeDelete], nil]];
+         break;
+
+         default:
+         break;
+      };
+   };
+
+   [self notifyObservers:changes];
+   [changes release];
+
+   return;
+}
+
+
+- (void) applyUUIDs:(NSArray *)uuids deleted:(BOOL)deleted
+{
+   NSMutableArray * changes;
+   NSData         * uuid;
+   LKEntry        * entry;
+
+   changes = [[NSMutableArray alloc] initWithCapacity:[uuids count]];
+
+   @synchronized(self)
+   {
+      for(uuid in uuids)
+      {
+         if (!(deleted))
+            [presentUUIDs addObject:uuid];
+         else if ((entry = [self removeEntryWithUUID:uuid]) != nil)
+            [changes addObject:[NSArray arrayWithObjects:entry,
+               [NSNumber numberWithInt:LKReplicaChangeDelete], nil]];
+      };
+   };
+
+   [self notifyObservers:changes];
+   [changes release];
+
+   return;
+}
+
+
+- (LKEntry *) removeEntryWithUUID:(NSData *)uuid
+{
+   LKEntry * entry;
+
+   // must be called while holding the lock of the replica
+   if ((entry = [[[entriesByUUID objectForKey:uuid] retain] autorelease]) == nil)
+      return(nil);
+   [uuidsByDN removeObjectForKey:[LKSearchCache normalizedDN:entry.dn]];
+   [entriesByUUID removeObjectForKey:uuid];
+
+   return(entry);
+}
+
+
+#pragma mark - Observers
+
+- (id) addObserver:(LKReplicaObserver)observer
+{
+   id block;
+   NSAssert((observer != nil), @"observer must not be nil");
+   block = [observer copy];
+   @synchronized(self)
+   {
+      [observers addObject:block];
+   };
+   return([block autorelease]);
+}
+
+
+- (void) notifyObservers:(NSArray *)changes
+{
+   NSArray           * blocks;
+   NSArray           * change;
+   LKReplicaObserver   observer;
+
+   if (![changes count])
+      return;
+
+   // observers are invoked without holding the lock of the replica
+   @synchronized(self)
+   {
+      blocks = [[NSArray alloc] initWithArray:observers];
+   };
+   for(change in changes)
+      for(observer in blocks)
+         observer(self, [change objectAtIndex:0],
+                  (LKReplicaChange)[[change objectAtIndex:1] intValue]);
+   [blocks release];
+
+   return;
+}
+
+
+- (void) removeObserver:(id)observer
+{
+   @synchronized(self)
+   {
+      [observers removeObjectIdenticalTo:observer];
+   };
+   return;
+}
+
+
+#pragma mark - Persistence
+
+- (BOOL) writeToFile:(NSString *)path
+{
+   NSAutoreleasePool   * pool;
+   NSMutableArray      * records;
+   NSMutableDictionary * attributes;
+   NSMutableDictionary * plist;
+   NSMutableArray      * values;
+   NSData              * uuid;
+   NSData              * data;
+   NSString            * name;
+   LKEntry             * entry;
+   LKBerValue          * value;
+   BOOL                  isWritten;
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   // copies the values of the entries into a property list
+   plist = [NSMutableDictionary dictionaryWithCapacity:2];
+   @synchronized(self)
+   {
+      records = [NSMutableArray arrayWithCapacity:[entriesByUUID count]];
+      for(uuid in entriesByUUID)
+      {
+         entry      = [entriesByUUID objectForKey:uuid];
+         attributes = [NSMutableDictionary dictionary];
+         for(name in entry.attributes)
+         {
+            values = [NSMutableArray array];
+            for(value in [entry valuesForAttribute:name])
+               [values addObject:value.berData];
+            [attributes setObject:values forKey:name];
+         };
+         [records addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+            entry.dn, @"dn", uuid, @"uuid", attributes, @"attributes", nil]];
+      };
+      [plist setObject:records forKey:@"entries"];
+      if ((cookie))
+         [plist setObject:cookie forKey:@"cookie"];
+   };
+
+   // writes the property list
+   isWritten = NO;
+   data = [NSPropertyListSerialization dataWithPropertyList:plist
+            format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+   if ((data))
+      isWritten = [data writeToFile:path atomically:YES];
+
+   [pool release];
+
+   return(isWritten);
+}
+
+@end
@@ -0,0 +1,168 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKScheduler decides the order in which the messages of an LKLdap object
+ *  are added to its operation queue.
+ *
+ *  Messages are placed in one of three lanes when they are created:
+ *
+ *  * `LKSchedulerLaneInteractive` - searches of a single entry (base scope)
+ *    and searches whose size limit is at most `interactiveSizeLimit`.
+ *  * `LKSchedulerLaneBulk` - other searches, including streaming searches,
+ *    exports, and synchronizations which do not persist.
+ *  * `LKSchedulerLaneWrite` - adds, deletes, modifications, renames,
+ *    batches of changes, and imports.
+ *
+ *  Binds, unbinds, pre-warming, persisting synchronizations, and searches
+ *  answered from the search cache are not placed in a lane and are added
+ *  to the operation queue immediately.
+ *
+ *  The scheduler only adds as many messages to the operation queue as the
+ *  LKLdap object has connections, so that messages in a lane are not queued
+ *  behind messages in other lanes. When requests are multiplexed, every
+ *  message may run at once. The next message is taken from the lane which
+ *  has received the smallest share of the started messages relative to its
+ *  weight, and lanes which have reached their concurrency limit are
+ *  skipped. By default the interactive lane has a weight of 8, writes a
+ *  weight of 2, and bulk reads a weight of 1 with at most one bulk read
+ *  running at a time. Interactive searches therefore only wait for the
+ *  connections held by running bulk reads when the pool has more than one
+ *  connection.
+ *
+ *  Messages in a lane run in the order they were created. Cancelling a
+ *  message which is waiting in a lane removes it from the lane.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/LKEnumerations.h>
+
+
+#pragma mark - Scheduler lanes
+enum ldap_kit_scheduler_lane
+{
+   LKSchedulerLaneInteractive         = 0x00,
+   LKSchedulerLaneBulk                = 0x01,
+   LKSchedulerLaneWrite               = 0x02,
+   LKSchedulerLaneCount               = 0x03
+};
+typedef enum ldap_kit_scheduler_lane LKSchedulerLane;
+
+
+#pragma mark - Data Types
+struct ldap_kit_scheduler_lane_state;
+typedef struct ldap_kit_scheduler_lane_state LKSchedulerLaneState;
+
+
+@class LKMessage;
+
+@interface LKScheduler : NSObject
+{
+   // scheduler settings
+   NSOperationQueue       * queue;
+   NSUInteger               capacity;
+   NSInteger                interactiveSizeLimit;
+
+   // scheduler state
+   LKSchedulerLaneState   * lanes;
+   NSUInteger               running;
+   double                   virtualTime;
+}
+
+#pragma mark - Scheduler settings
+/// @name Scheduler settings
+
+/// The largest size limit of a search which is placed in the interactive
+/// lane.
+///
+/// Searches with a base scope are always interactive. Setting the value to
+/// 0 only places searches with a base scope in the interactive lane. The
+/// default value is 10.
+@property (atomic, assign)      NSInteger                interactiveSizeLimit;
+
+/// Returns the weight of a lane.
+/// @param lane The lane.
+- (NSUInteger) weightForLane:(LKSchedulerLane)lane;
+
+/// Sets the weight of a lane.
+///
+/// While several lanes have waiting messages, each lane starts messages in
+/// proportion to its weight.
+/// @param weight The weight of the lane, which must be greater than zero.
+/// @param lane The lane.
+- (void) setWeight:(NSUInteger)weight forLane:(LKSchedulerLane)lane;
+
+/// Returns the number of messages of a lane which may run at once.
+/// @param lane The lane.
+- (NSUInteger) concurrencyLimitForLane:(LKSchedulerLane)lane;
+
+/// Sets the number of messages of a lane which may run at once.
+/// @param limit The number of messages, 0 only limits the lane by the
+/// number of connections.
+/// @param lane The lane.
+- (void) setConcurrencyLimit:(NSUInteger)limit forLane:(LKSchedulerLane)lane;
+
+
+#pragma mark - Scheduler state
+/// @name Scheduler state
+
+/// Returns the number of messages waiting in a lane.
+/// @param lane The lane.
+- (NSUInteger) pendingCountForLane:(LKSchedulerLane)lane;
+
+/// Returns the number of messages of a lane which are running.
+/// @param lane The lane.
+- (NSUInteger) runningCountForLane:(LKSchedulerLane)lane;
+
+
+#pragma mark - Statistics
+/// @name Statistics
+
+/// Returns the number of messages of a lane which have been started.
+/// @param lane The lane.
+- (NSUInteger) startedCountForLane:(LKSchedulerLane)lane;
+
+/// Returns the total time (in seconds) the started messages of a lane
+/// waited in the lane.
+/// @param lane The lane.
+- (NSTimeInterval) waitTimeForLane:(LKSchedulerLane)lane;
+
+/// Returns the longest time (in seconds) a started message of a lane waited
+/// in the lane.
+/// @param lane The lane.
+- (NSTimeInterval) maximumWaitTimeForLane:(LKSchedulerLane)lane;
+
+/// Resets the started counters and wait times of every lane.
+- (void) resetStatistics;
+
+@end
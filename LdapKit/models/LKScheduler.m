@@ -0,0 +1,459 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKScheduler.m orders the messages of an LKLdap object
+ */
+#import "LKScheduler.h"
+#import "LKSchedulerCategory.h"
+
+#include <stdlib.h>
+
+#import "LKMessage.h"
+
+
+#pragma mark - Data Types
+struct ldap_kit_scheduler_lane_state
+{
+   NSMutableArray   * pending;          // messages waiting in the lane
+   NSMutableArray   * scheduled;        // times the waiting messages were scheduled
+   NSMutableArray   * active;           // messages of the lane which are running
+   NSUInteger         weight;           // share of the started messages
+   NSUInteger         limit;            // messages which may run at once
+   double             pass;             // virtual time of the next start
+   NSUInteger         started;          // messages which have been started
+   NSTimeInterval     waitTime;         // total time started messages waited
+   NSTimeInterval     maximumWaitTime;  // longest time a started message waited
+};
+
+
+#pragma mark - KVO context
+static char lk_scheduler_finished_context;
+
+
+@interface LKScheduler ()
+
+/// @name Scheduling messages
+- (NSArray *) nextMessages;
+- (void) startMessages:(NSArray *)messages;
+
+@end
+
+
+@implementation LKScheduler
+
+// scheduler settings
+@synthesize interactiveSizeLimit;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   NSUInteger pos;
+
+   [queue release];
+
+   for(pos = 0; pos < LKSchedulerLaneCount; pos++)
+   {
+      [lanes[pos].pending   release];
+      [lanes[pos].scheduled release];
+      [lanes[pos].active    release];
+   };
+   free(lanes);
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   NSAssert(FALSE, @"use initWithQueue:");
+   return(nil);
+}
+
+
+- (id) initWithQueue:(NSOperationQueue *)newQueue
+{
+   NSUInteger pos;
+
+   if ((self = [super init]) == nil)
+      return(self);
+
+   if ((lanes = calloc(LKSchedulerLaneCount, sizeof(LKSchedulerLaneState))) == NULL)
+   {
+      [self release];
+      return(nil);
+   };
+   for(pos = 0; pos < LKSchedulerLaneCount; pos++)
+   {
+      lanes[pos].pending   = [[NSMutableArray alloc] initWithCapacity:4];
+      lanes[pos].scheduled = [[NSMutableArray alloc] initWithCapacity:4];
+      lanes[pos].active    = [[NSMutableArray alloc] initWithCapacity:4];
+   };
+
+   // interactive searches are favored over writes and bulk reads
+   lanes[LKSchedulerLaneInteractive].weight = 8;
+   lanes[LKSchedulerLaneWrite].weight       = 2;
+   lanes[LKSchedulerLaneBulk].weight        = 1;
+   lanes[LKSchedulerLaneBulk].limit         = 1;
+
+   queue                = [newQueue retain];
+   capacity             = 1;
+   interactiveSizeLimit = 10;
+
+   return(self);
+}
+
+
+#pragma mark - Scheduler settings
+
+- (NSUInteger) concurrencyLimitForLane:(LKSchedulerLane)lane
+{
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      return(lanes[lane].limit);
+   };
+}
+
+
+- (void) setCapacity:(NSUInteger)newCapacity
+{
+   NSArray * ready;
+   @synchronized(self)
+   {
+      capacity = newCapacity;
+      ready    = [self nextMessages];
+   };
+   [self startMessages:ready];
+   return;
+}
+
+
+- (void) setConcurrencyLimit:(NSUInteger)limit forLane:(LKSchedulerLane)lane
+{
+   NSArray * ready;
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      lanes[lane].limit = limit;
+      ready             = [self nextMessages];
+   };
+   [self startMessages:ready];
+   return;
+}
+
+
+- (void) setQueue:(NSOperationQueue *)newQueue
+{
+   @synchronized(self)
+   {
+      [queue release];
+      queue = [newQueue retain];
+   };
+   return;
+}
+
+
+- (void) setWeight:(NSUInteger)weight forLane:(LKSchedulerLane)lane
+{
+   NSAssert((weight > 0), @"weight must be greater than zero");
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      lanes[lane].weight = weight;
+   };
+   return;
+}
+
+
+- (NSUInteger) weightForLane:(LKSchedulerLane)lane
+{
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      return(lanes[lane].weight);
+   };
+}
+
+
+#pragma mark - Scheduler state
+
+- (NSUInteger) pendingCountForLane:(LKSchedulerLane)lane
+{
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      return([lanes[lane].pending count]);
+   };
+}
+
+
+- (NSUInteger) runningCountForLane:(LKSchedulerLane)lane
+{
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      return([lanes[lane].active count]);
+   };
+}
+
+
+#pragma mark - Statistics
+
+- (NSTimeInterval) maximumWaitTimeForLane:(LKSchedulerLane)lane
+{
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      return(lanes[lane].maximumWaitTime);
+   };
+}
+
+
+- (void) resetStatistics
+{
+   NSUInteger pos;
+   @synchronized(self)
+   {
+      for(pos = 0; pos < LKSchedulerLaneCount; pos++)
+      {
+         lanes[pos].started         = 0;
+         lanes[pos].waitTime        = 0;
+         lanes[pos].maximumWaitTime = 0;
+      };
+   };
+   return;
+}
+
+
+- (NSUInteger) startedCountForLane:(LKSchedulerLane)lane
+{
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      return(lanes[lane].started);
+   };
+}
+
+
+- (NSTimeInterval) waitTimeForLane:(LKSchedulerLane)lane
+{
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+   @synchronized(self)
+   {
+      return(lanes[lane].waitTime);
+   };
+}
+
+
+#pragma mark - Scheduling messages
+
+- (void) cancelMessage:(LKMessage *)message
+{
+   LKSchedulerLaneState * state;
+   NSOperationQueue     * target;
+   NSUInteger             pos;
+   NSUInteger             index;
+   BOOL                   found;
+
+   found = NO;
+   [[message retain] autorelease];
+
+   @synchronized(self)
+   {
+      target = [[queue retain] autorelease];
+      for(pos = 0; ((pos < LKSchedulerLaneCount) && (!(found))); pos++)
+      {
+         state = &lanes[pos];
+         index = [state->pending indexOfObjectIdenticalTo:message];
+         if (index == NSNotFound)
+            continue;
+         [state->pending   removeObjectAtIndex:index];
+         [state->scheduled removeObjectAtIndex:index];
+         found = YES;
+      };
+   };
+
+   // a cancelled operation finishes without running once it is queued
+   if ((found))
+      [target addOperation:message];
+
+   return;
+}
+
+
+- (NSArray *) nextMessages
+{
+   NSMutableArray       * ready;
+   LKSchedulerLaneState * state;
+   LKSchedulerLaneState * next;
+   LKMessage            * message;
+   NSUInteger             pos;
+   NSTimeInterval         now;
+   NSTimeInterval         wait;
+
+   // must be called while holding the lock of the object
+   ready = nil;
+   now   = [NSDate timeIntervalSinceReferenceDate];
+
+   while ( (!(capacity)) || (running < capacity) )
+   {
+      // selects the lane with the earliest virtual start time which has
+      // not reached its concurrency limit, ties favor interactive searches
+      next = NULL;
+      for(pos = 0; pos < LKSchedulerLaneCount; pos++)
+      {
+         state = &lanes[pos];
+         if (!([state->pending count]))
+            continue;
+         if ( ((state->limit)) && ([state->active count] >= state->limit) )
+            continue;
+         if ( (!(next)) || (state->pass < next->pass) )
+            next = state;
+      };
+      if (!(next))
+         break;
+
+      // moves the oldest message of the lane to the running messages
+      message = [next->pending objectAtIndex:0];
+      wait    = now - [[next->scheduled objectAtIndex:0] doubleValue];
+      [next->active addObject:message];
+      [next->pending   removeObjectAtIndex:0];
+      [next->scheduled removeObjectAtIndex:0];
+      running++;
+
+      next->started++;
+      next->waitTime += wait;
+      if (wait > next->maximumWaitTime)
+         next->maximumWaitTime = wait;
+
+      // each start advances the lane in inverse proportion to its weight
+      virtualTime  = next->pass;
+      next->pass  += 1.0 / (double)next->weight;
+
+      if (!(ready))
+         ready = [NSMutableArray arrayWithCapacity:1];
+      [ready addObject:message];
+   };
+
+   return(ready);
+}
+
+
+- (void) observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object
+         change:(NSDictionary *)change context:(void *)context
+{
+   NSArray    * ready;
+   NSUInteger   pos;
+   NSUInteger   index;
+
+   if (context != &lk_scheduler_finished_context)
+   {
+      [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+      return;
+   };
+   if (!([object isFinished]))
+      return;
+   [object removeObserver:self forKeyPath:@"isFinished"];
+
+   // the slot of the finished message is given to the next message
+   @synchronized(self)
+   {
+      for(pos = 0; pos < LKSchedulerLaneCount; pos++)
+      {
+         index = [lanes[pos].active indexOfObjectIdenticalTo:object];
+         if (index == NSNotFound)
+            continue;
+         [lanes[pos].active removeObjectAtIndex:index];
+         running--;
+         break;
+      };
+      ready = [self nextMessages];
+   };
+   [self startMessages:ready];
+
+   return;
+}
+
+
+- (void) scheduleMessage:(LKMessage *)message lane:(LKSchedulerLane)lane
+{
+   LKSchedulerLaneState * state;
+   NSArray              * ready;
+
+   NSAssert((lane < LKSchedulerLaneCount), @"invalid scheduler lane");
+
+   @synchronized(self)
+   {
+      // a lane does not accumulate credit while it is idle
+      state = &lanes[lane];
+      if ( (!([state->pending count])) && (!([state->active count])) &&
+           (state->pass < virtualTime) )
+         state->pass = virtualTime;
+
+      [state->pending addObject:message];
+      [state->scheduled addObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate]]];
+      ready = [self nextMessages];
+   };
+   [self startMessages:ready];
+
+   return;
+}
+
+
+- (void) startMessages:(NSArray *)messages
+{
+   LKMessage        * message;
+   NSOperationQueue * target;
+
+   @synchronized(self)
+   {
+      target = [[queue retain] autorelease];
+   };
+
+   // the observer is registered before the message may finish
+   for(message in messages)
+   {
+      [message addObserver:self forKeyPath:@"isFinished" options:0
+         context:&lk_scheduler_finished_context];
+      [target addOperation:message];
+   };
+
+   return;
+}
+
+@end
@@ -0,0 +1,134 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKSearchCache stores the results of searches performed by an LKLdap
+ *  object so that repeated searches are answered without contacting the
+ *  directory server.
+ *
+ *  Results are identified by the base DN, scope, filter, requested
+ *  attributes, attrsonly flag, and size limit of the search. The DN and
+ *  filter are normalized, so searches which only differ in the case of
+ *  attribute names or in whitespace share a result. Results expire after
+ *  `timeout` seconds and the least recently used results are evicted once
+ *  the estimated size of the cached entries exceeds `sizeLimit`.
+ *
+ *  Writes performed through the owning LKLdap object remove the results of
+ *  every search whose scope includes the modified DN. Cached LKEntry objects
+ *  are returned to every caller which repeats a search and must not be
+ *  modified.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/LKEnumerations.h>
+
+
+#pragma mark - Data Types
+struct ldap_kit_search_cache_node;
+typedef struct ldap_kit_search_cache_node LKSearchCacheNode;
+
+
+@interface LKSearchCache : NSObject
+{
+   // cache settings
+   NSInteger                timeout;
+   NSUInteger               sizeLimit;
+
+   // cached results
+   NSMutableDictionary    * nodes;
+   LKSearchCacheNode      * newestNode;
+   LKSearchCacheNode      * oldestNode;
+   NSUInteger               size;
+   NSUInteger               generation;
+
+   // statistics
+   NSUInteger               hits;
+   NSUInteger               misses;
+   NSUInteger               evictions;
+}
+
+#pragma mark - Cache settings
+/// @name Cache settings
+
+/// The time (in seconds) a search result remains valid.
+///
+/// Setting the value to 0 disables the cache and removes every cached result,
+/// which is the default.
+@property (atomic, assign)      NSInteger                timeout;
+
+/// The maximum estimated size (in bytes) of the cached entries.
+///
+/// The least recently used results are evicted when the limit is exceeded.
+/// A result which is larger than the limit is not cached. The default value
+/// is 4 MiB.
+@property (atomic, assign)      NSUInteger               sizeLimit;
+
+
+#pragma mark - Cached results
+/// @name Cached results
+
+/// The number of cached search results.
+@property (atomic, readonly)    NSUInteger               count;
+
+/// The estimated size (in bytes) of the cached entries.
+@property (atomic, readonly)    NSUInteger               size;
+
+/// Removes every cached result.
+- (void) removeAllResults;
+
+/// Removes the results of searches which could have returned an entry.
+///
+/// A result is removed if the DN is within the scope of its search or if the
+/// base DN of its search is the DN or one of its descendants. Searches which
+/// are in progress when this method is called are not cached.
+/// @param dn The DN of an entry which was added, modified, deleted, or
+/// renamed.
+- (void) removeResultsForDN:(NSString *)dn;
+
+
+#pragma mark - Statistics
+/// @name Statistics
+
+/// The number of searches answered from the cache.
+@property (atomic, readonly)    NSUInteger               hits;
+
+/// The number of cacheable searches which were sent to the directory server.
+@property (atomic, readonly)    NSUInteger               misses;
+
+/// The number of results removed to stay within the size limit.
+@property (atomic, readonly)    NSUInteger               evictions;
+
+/// Resets the hit, miss, and eviction counters.
+- (void) resetStatistics;
+
+@end
@@ -0,0 +1,602 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKSearchCache.m caches the results of LDAP searches
+ */
+#import "LKSearchCache.h"
+#import "LKSearchCacheCategory.h"
+
+#include <ctype.h>
+
+#import "LKEntry.h"
+#import "LKEntryCategory.h"
+
+
+#pragma mark - Data Types
+struct ldap_kit_search_cache_node
+{
+   LKSearchCacheNode  * newer;     // next most recently used result
+   LKSearchCacheNode  * older;     // next least recently used result
+   NSString           * key;       // key of the search
+   NSString           * baseDN;    // normalized base DN of the search
+   LKLdapSearchScope    scope;     // scope of the search
+   NSArray            * entries;   // entries returned by the search
+   NSUInteger           size;      // estimated size of the entries
+   NSTimeInterval       expires;   // time the result expires
+};
+
+
+@interface LKSearchCache ()
+
+/// @name Cached results
+- (void) evictResults;
+- (void) removeNode:(LKSearchCacheNode *)node;
+
+/// @name Normalization
++ (BOOL) isDN:(NSString *)dn descendantOfDN:(NSString *)base;
++ (NSString *) normalizedFilter:(NSString *)filter;
++ (NSString *) parentOfDN:(NSString *)dn;
+
+@end
+
+
+@implementation LKSearchCache
+
+// statistics
+@synthesize hits;
+@synthesize misses;
+@synthesize evictions;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // cached results
+   while ((oldestNode))
+      [self removeNode:oldestNode];
+   [nodes release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // cache settings
+   timeout   = 0;
+   sizeLimit = 4 * 1024 * 1024;
+
+   // cached results
+   nodes = [[NSMutableDictionary alloc] initWithCapacity:64];
+
+   return(self);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSUInteger) count
+{
+   @synchronized(self)
+   {
+      return([nodes count]);
+   };
+}
+
+
+- (NSUInteger) generation
+{
+   @synchronized(self)
+   {
+      return(generation);
+   };
+}
+
+
+- (NSUInteger) size
+{
+   @synchronized(self)
+   {
+      return(size);
+   };
+}
+
+
+- (NSUInteger) sizeLimit
+{
+   @synchronized(self)
+   {
+      return(sizeLimit);
+   };
+}
+
+
+- (void) setSizeLimit:(NSUInteger)limit
+{
+   @synchronized(self)
+   {
+      sizeLimit = limit;
+      [self evictResults];
+   };
+   return;
+}
+
+
+- (NSInteger) timeout
+{
+   @synchronized(self)
+   {
+      return(timeout);
+   };
+}
+
+
+- (void) setTimeout:(NSInteger)seconds
+{
+   @synchronized(self)
+   {
+      timeout = (seconds > 0) ? seconds : 0;
+      if (!(timeout))
+         [self removeAllResults];
+   };
+   return;
+}
+
+
+#pragma mark - Cached results
+
+- (NSArray *) entriesForKey:(NSString *)key
+{
+   NSValue           * value;
+   LKSearchCacheNode * node;
+   NSArray           * cached;
+
+   @synchronized(self)
+   {
+      if (!(timeout))
+         return(nil);
+
+      // expired results are removed when they are requested
+      value = [nodes objectForKey:key];
+      node  = [value pointerValue];
+      if ( ((node)) && (node->expires <= [NSDate timeIntervalSinceReferenceDate]) )
+      {
+         [self removeNode:node];
+         node = NULL;
+      };
+      if (!(node))
+      {
+         misses++;
+         return(nil);
+      };
+      hits++;
+
+      // moves the result to the head of the list
+      if (node != newestNode)
+      {
+         node->newer->older = node->older;
+         if ((node->older))
+            node->older->newer = node->newer;
+         else
+            oldestNode = node->newer;
+         node->older        = newestNode;
+         node->newer        = NULL;
+         newestNode->newer  = node;
+         newestNode         = node;
+      };
+
+      cached = [[node->entries retain] autorelease];
+   };
+
+   return(cached);
+}
+
+
+- (void) evictResults
+{
+   while ( ((oldestNode)) && (size > sizeLimit) )
+   {
+      [self removeNode:oldestNode];
+      evictions++;
+   };
+   return;
+}
+
+
+- (NSString *) keyForBaseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+               filter:(NSString *)filter attributes:(NSArray *)attributes
+               attributesOnly:(BOOL)attributesOnly sizeLimit:(NSInteger)limit
+{
+   NSAutoreleasePool * pool;
+   NSMutableSet      * names;
+   NSArray           * sorted;
+   NSString          * attribute;
+   NSString          * key;
+
+   if (!(self.timeout))
+      return(nil);
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   // attribute descriptions are compared case-insensitively
+   names = [NSMutableSet setWithCapacity:[attributes count]];
+   for(attribute in attributes)
+      [names addObject:[attribute lowercaseString]];
+   sorted = [[names allObjects] sortedArrayUsingSelector:@selector(compare:)];
+
+   key = [[NSString alloc] initWithFormat:@"%i\n%i\n%li\n%@\n%@\n%@", (int)scope,
+            (int)attributesOnly, (long)limit, [LKSearchCache normalizedDN:dn],
+            [sorted componentsJoinedByString:@","],
+            [LKSearchCache normalizedFilter:filter]];
+
+   [pool release];
+
+   return([key autorelease]);
+}
+
+
+- (void) removeAllResults
+{
+   @synchronized(self)
+   {
+      generation++;
+      while ((oldestNode))
+         [self removeNode:oldestNode];
+   };
+   return;
+}
+
+
+- (void) removeNode:(LKSearchCacheNode *)node
+{
+   if ((node->newer))
+      node->newer->older = node->older;
+   else
+      newestNode = node->older;
+   if ((node->older))
+      node->older->newer = node->newer;
+   else
+      oldestNode = node->newer;
+
+   size -= node->size;
+   [nodes removeObjectForKey:node->key];
+
+   [node->key     release];
+   [node->baseDN  release];
+   [node->entries release];
+   free(node);
+
+   return;
+}
+
+
+- (void) removeResultsForDN:(NSString *)dn
+{
+   NSAutoreleasePool * pool;
+   NSString          * normalized;
+   LKSearchCacheNode * node;
+   LKSearchCacheNode * older;
+   BOOL                inScope;
+
+   if (!(dn))
+      return;
+
+   pool       = [[NSAutoreleasePool alloc] init];
+   normalized = [LKSearchCache normalizedDN:dn];
+
+   @synchronized(self)
+   {
+      // searches in progress may have read the entry before it was modified
+      generation++;
+
+      for(node = newestNode; ((node)); node = older)
+      {
+         older = node->older;
+         switch(node->scope)
+         {
+            case LKLdapSearchScopeBase:
+            inScope = [normalized isEqualToString:node->baseDN];
+            break;
+
+            case LKLdapSearchScopeOneLevel:
+            inScope = [[LKSearchCache parentOfDN:normalized] isEqualToString:node->baseDN];
+            break;
+
+            case LKLdapSearchScopeChildren:
+            inScope = [LKSearchCache isDN:normalized descendantOfDN:node->baseDN];
+            break;
+
+            default:
+            inScope = ( ([normalized isEqualToString:node->baseDN]) ||
+                        ([LKSearchCache isDN:normalized descendantOfDN:node->baseDN]) );
+            break;
+         };
+
+         // renaming or deleting an entry also affects searches of its subtree
+         if ( ((inScope)) || ([node->baseDN isEqualToString:normalized]) ||
+              ([LKSearchCache isDN:node->baseDN descendantOfDN:normalized]) )
+            [self removeNode:node];
+      };
+   };
+
+   [pool release];
+
+   return;
+}
+
+
+- (void) removeResultsForRenamedDN:(NSString *)dn newRDN:(NSString *)rdn
+         newSuperior:(NSString *)superior
+{
+   NSString * newDN;
+
+   if (!(dn))
+      return;
+   [self removeResultsForDN:dn];
+   if (!(rdn))
+      return;
+
+   // searches which include the new DN of the entry are also removed
+   if (!(superior))
+      superior = [LKSearchCache parentOfDN:dn];
+   if ([superior length] > 0)
+      newDN = [[NSString alloc] initWithFormat:@"%@,%@", rdn, superior];
+   else
+      newDN = [rdn copy];
+   [self removeResultsForDN:newDN];
+   [newDN release];
+
+   return;
+}
+
+
+- (void) resetStatistics
+{
+   @synchronized(self)
+   {
+      hits      = 0;
+      misses    = 0;
+      evictions = 0;
+   };
+   return;
+}
+
+
+- (void) storeEntries:(NSArray *)entries forKey:(NSString *)key
+         baseDN:(NSString *)dn scope:(LKLdapSearchScope)scope
+         generation:(NSUInteger)startGeneration
+{
+   LKSearchCacheNode * node;
+   LKEntry           * entry;
+   NSUInteger          entriesSize;
+   NSValue           * value;
+
+   // estimates the memory retained by the entries
+   entriesSize = [key length] + sizeof(LKSearchCacheNode);
+   for(entry in entries)
+      entriesSize += [entry berSize];
+
+   @synchronized(self)
+   {
+      // discards results which may predate a write
+      if ( (!(timeout)) || (startGeneration != generation) )
+         return;
+      if (entriesSize > sizeLimit)
+         return;
+
+      // replaces an existing result
+      if ((value = [nodes objectForKey:key]) != nil)
+         [self removeNode:[value pointerValue]];
+
+      if ((node = calloc(1, sizeof(LKSearchCacheNode))) == NULL)
+         return;
+      node->key      = [key copy];
+      node->baseDN   = [[LKSearchCache normalizedDN:dn] retain];
+      node->scope    = scope;
+      node->entries  = [[NSArray alloc] initWithArray:entries];
+      node->size     = entriesSize;
+      node->expires  = [NSDate timeIntervalSinceReferenceDate] + timeout;
+
+      // inserts the result at the head of the list
+      node->older = newestNode;
+      if ((newestNode))
+         newestNode->newer = node;
+      else
+         oldestNode = node;
+      newestNode = node;
+      [nodes setObject:[NSValue valueWithPointer:node] forKey:node->key];
+      size += entriesSize;
+
+      [self evictResults];
+   };
+
+   return;
+}
+
+
+#pragma mark - Normalization
+
++ (BOOL) isDN:(NSString *)dn descendantOfDN:(NSString *)base
+{
+   if (![base length])
+      return([dn length] > 0);
+   if ([dn length] <= [base length])
+      return(NO);
+   if (!([dn hasSuffix:base]))
+      return(NO);
+   return([dn characterAtIndex:([dn length] - [base length] - 1)] == ',');
+}
+
+
++ (NSString *) normalizedDN:(NSString *)dn
+{
+   const char * src;
+   char       * dst;
+   size_t       len;
+   size_t       pos;
+   size_t       next;
+   size_t       out;
+   BOOL         isSeparator;
+   NSString   * normalized;
+
+   if (!(src = [[dn lowercaseString] UTF8String]))
+      return(@"");
+   len = strlen(src);
+   if ((dst = malloc(len + 1)) == NULL)
+      return([dn lowercaseString]);
+
+   // removes whitespace surrounding the separators of RDNs and attributes
+   out         = 0;
+   isSeparator = YES;
+   for(pos = 0; pos < len; pos++)
+   {
+      if ( (src[pos] == '\\') && ((pos + 1) < len) )
+      {
+         dst[out++]  = src[pos++];
+         dst[out++]  = src[pos];
+         isSeparator = NO;
+         continue;
+      };
+      if (src[pos] == ' ')
+      {
+         for(next = pos; ((next < len) && (src[next] == ' ')); next++);
+         if ( ((isSeparator)) || (next == len) || (src[next] == ',') ||
+              (src[next] == '=') || (src[next] == '+') )
+         {
+            pos = next - 1;
+            continue;
+         };
+      };
+      isSeparator = ( (src[pos] == ',') || (src[pos] == '=') || (src[pos] == '+') );
+      dst[out++]  = src[pos];
+   };
+
+   normalized = [[NSString alloc] initWithBytes:dst length:out encoding:NSUTF8StringEncoding];
+   free(dst);
+
+   return([normalized autorelease]);
+}
+
+
++ (NSString *) normalizedFilter:(NSString *)filter
+{
+   const char * src;
+   char       * dst;
+   size_t       len;
+   size_t       pos;
+   size_t       out;
+   BOOL         isType;
+   BOOL         isValue;
+   NSString   * normalized;
+
+   if (!(src = [filter UTF8String]))
+      return(@"");
+   len = strlen(src);
+   if ((dst = malloc(len + 1)) == NULL)
+      return(filter);
+
+   // lowercases attribute descriptions and removes whitespace between
+   // components, values are copied unchanged
+   out     = 0;
+   isType  = YES;
+   isValue = NO;
+   for(pos = 0; pos < len; pos++)
+   {
+      if ((isValue))
+      {
+         if ( (src[pos] == '\\') && ((pos + 1) < len) )
+            dst[out++] = src[pos++];
+         else if (src[pos] == ')')
+            isValue = NO;
+         dst[out++] = src[pos];
+         continue;
+      };
+      if ((isspace((unsigned char)src[pos])))
+         continue;
+      switch(src[pos])
+      {
+         case '(':
+         isType = YES;
+         break;
+
+         case '&':
+         case '|':
+         case '!':
+         isType = NO;
+         break;
+
+         case '=':
+         isType  = NO;
+         isValue = YES;
+         break;
+
+         default:
+         break;
+      };
+      dst[out++] = ((isType)) ? (char)tolower((unsigned char)src[pos]) : src[pos];
+   };
+
+   normalized = [[NSString alloc] initWithBytes:dst length:out encoding:NSUTF8StringEncoding];
+   free(dst);
+
+   return([normalized autorelease]);
+}
+
+
++ (NSString *) parentOfDN:(NSString *)dn
+{
+   NSUInteger pos;
+   NSUInteger len;
+   unichar    c;
+
+   len = [dn length];
+   for(pos = 0; pos < len; pos++)
+   {
+      c = [dn characterAtIndex:pos];
+      if (c == '\\')
+         pos++;
+      else if (c == ',')
+         return([dn substringFromIndex:(pos + 1)]);
+   };
+
+   return(@"");
+}
+
+@end
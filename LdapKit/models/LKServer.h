@@ -0,0 +1,117 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKServer describes one of the directory servers of an LKLdap object
+ *  which has been given a list of servers with
+ *  [LKLdap ldapServerURIs].
+ *
+ *  The first server of the list is the primary server which receives every
+ *  add, delete, modification, rename, batch of changes, and import. Other
+ *  messages are sent to the healthy server with the lowest latency.
+ *
+ *  The latency of a server is an exponentially weighted moving average of
+ *  the time between waiting for the response to a request and receiving
+ *  the first response. A latency which has not been measured for
+ *  [LKLdap ldapServerRetryInterval] seconds is treated as unknown so that
+ *  a server which was slow is measured again.
+ *
+ *  A server is unhealthy after a connection to the server fails or a request
+ *  sent to the server times out. Messages are not routed to an unhealthy
+ *  server until [LKLdap ldapServerRetryInterval] seconds have passed. The
+ *  interval doubles with each consecutive failure, up to eight times the
+ *  configured value. If every server is unhealthy, the server which may be
+ *  retried first is used.
+ */
+
+#import <Foundation/Foundation.h>
+#import <LdapKit/LKEnumerations.h>
+
+
+@interface LKServer : NSObject
+{
+   // server information
+   NSString               * uri;
+   LKLdapProtocolScheme     protocolScheme;
+   BOOL                     isPrimary;
+
+   // latency information
+   NSTimeInterval           latency;
+   NSUInteger               latencySamples;
+   NSTimeInterval           lastSampled;
+
+   // health information
+   NSUInteger               failureCount;
+   NSUInteger               consecutiveFailures;
+   NSTimeInterval           retryTime;
+}
+
+#pragma mark - Server information
+/// @name Server information
+
+/// The URI used to connect to the server.
+@property (nonatomic, readonly) NSString               * uri;
+
+/// The protocol scheme of the URI.
+@property (nonatomic, readonly) LKLdapProtocolScheme     protocolScheme;
+
+/// Indicates whether the server is the primary server which receives writes.
+@property (nonatomic, readonly) BOOL                     isPrimary;
+
+
+#pragma mark - Latency information
+/// @name Latency information
+
+/// The moving average of the response time (in seconds) of the server, or 0
+/// if the response time has not been measured.
+@property (nonatomic, readonly) NSTimeInterval           latency;
+
+/// The number of response times which have been measured.
+@property (nonatomic, readonly) NSUInteger               latencySamples;
+
+
+#pragma mark - Health information
+/// @name Health information
+
+/// Indicates whether messages may be routed to the server.
+@property (nonatomic, readonly) BOOL                     isHealthy;
+
+/// The number of times a connection to the server failed or a request sent to
+/// the server timed out.
+@property (nonatomic, readonly) NSUInteger               failureCount;
+
+/// The time (seconds since the reference date) after which an unhealthy
+/// server may be used again.
+@property (nonatomic, readonly) NSTimeInterval           retryTime;
+
+@end
@@ -0,0 +1,212 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  LdapKit/LKServer.m tracks the latency and health of a directory server
+ */
+#import "LKServer.h"
+#import "LKServerCategory.h"
+
+#include <ldap.h>
+#include <strings.h>
+
+
+// weight of a new response time in the moving average of the latency
+#define LK_SERVER_LATENCY_WEIGHT 0.2
+
+// largest multiple of the retry interval an unhealthy server is skipped
+#define LK_SERVER_BACKOFF_LIMIT 8
+
+
+@implementation LKServer
+
+// server information
+@synthesize uri;
+@synthesize protocolScheme;
+@synthesize isPrimary;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // server information
+   [uri release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) init
+{
+   NSAssert(FALSE, @"use initWithURI:primary:");
+   return(nil);
+}
+
+
+- (id) initWithURI:(NSString *)newURI primary:(BOOL)primary
+{
+   LDAPURLDesc * ludp;
+
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // determines if "uri" is a valid LDAP URL
+   if ( (!(newURI)) || ((ldap_url_parse([newURI UTF8String], &ludp))) )
+   {
+      [self release];
+      return(nil);
+   };
+
+   // determines scheme
+   if (!(strcasecmp(ludp->lud_scheme, "ldapi")))
+      protocolScheme = LKLdapProtocolSchemeLDAPI;
+   else if (!(strcasecmp(ludp->lud_scheme, "ldaps")))
+      protocolScheme = LKLdapProtocolSchemeLDAPS;
+   else
+      protocolScheme = LKLdapProtocolSchemeLDAP;
+
+   ldap_free_urldesc(ludp);
+
+   uri       = [newURI copy];
+   isPrimary = primary;
+
+   return(self);
+}
+
+
+#pragma mark - Getter/Setter methods
+
+- (NSUInteger) failureCount
+{
+   @synchronized(self)
+   {
+      return(failureCount);
+   };
+}
+
+
+- (BOOL) isHealthy
+{
+   @synchronized(self)
+   {
+      return(retryTime <= [NSDate timeIntervalSinceReferenceDate]);
+   };
+}
+
+
+- (NSTimeInterval) latency
+{
+   @synchronized(self)
+   {
+      return(latency);
+   };
+}
+
+
+- (NSUInteger) latencySamples
+{
+   @synchronized(self)
+   {
+      return(latencySamples);
+   };
+}
+
+
+- (NSTimeInterval) retryTime
+{
+   @synchronized(self)
+   {
+      return(retryTime);
+   };
+}
+
+
+#pragma mark - Latency information
+
+- (NSTimeInterval) latencyWithLifetime:(NSTimeInterval)lifetime
+{
+   @synchronized(self)
+   {
+      if ( (lifetime > 0) &&
+           (([NSDate timeIntervalSinceReferenceDate] - lastSampled) > lifetime) )
+         return(0);
+      return(latency);
+   };
+}
+
+
+- (void) recordLatency:(NSTimeInterval)seconds
+{
+   @synchronized(self)
+   {
+      // the first response time replaces the unknown latency
+      if (!(latencySamples))
+         latency = seconds;
+      else
+         latency += (seconds - latency) * LK_SERVER_LATENCY_WEIGHT;
+      latencySamples++;
+      lastSampled = [NSDate timeIntervalSinceReferenceDate];
+
+      // a server which responds has recovered
+      consecutiveFailures = 0;
+      retryTime           = 0;
+   };
+   return;
+}
+
+
+#pragma mark - Health information
+
+- (void) recordFailureWithRetryInterval:(NSTimeInterval)interval
+{
+   NSUInteger multiple;
+   NSUInteger pos;
+
+   @synchronized(self)
+   {
+      failureCount++;
+      consecutiveFailures++;
+
+      // doubles the time the server is skipped after each consecutive failure
+      multiple = 1;
+      for(pos = 1; ((pos < consecutiveFailures) && (multiple < LK_SERVER_BACKOFF_LIMIT)); pos++)
+         multiple <<= 1;
+      retryTime = [NSDate timeIntervalSinceReferenceDate] + (interval * multiple);
+   };
+   return;
+}
+
+@end
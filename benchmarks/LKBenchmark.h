@@ -0,0 +1,137 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/**
+ *  LKBenchmark measures the cost of LDAP operations performed through LdapKit
+ *  against a directory server loaded by `benchmarks/slapd-fixture.sh`.
+ *
+ *  Each case adds a dictionary to the report which is written as JSON:
+ *
+ *  * `bind` - latency of binding new LKLdap sessions.
+ *  * `search` - searches and entries per second for the base, one level,
+ *    and subtree scopes.
+ *  * `materialize` - time spent creating DNs, attribute names, and values
+ *    from the LKEntry and LKBerValue objects returned by a search.
+ *  * `base64` - LKBerValue base64 encoding and decoding throughput for values
+ *    from 1 KB to 1 MB. The results are keyed by the codec the library was
+ *    built with, `scalar` when `LK_BASE64_SCALAR` is defined and `simd`
+ *    otherwise. This case does not use the directory server.
+ *  * `write` - modify, rename, and delete operations per second. The deleted
+ *    entries are added again with their original attributes afterwards.
+ *  * `teardown` - verifies that releasing a session which multiplexes
+ *    requests stops the dispatcher thread of each pooled connection. The
+ *    case fails if a dispatcher thread is still running after the session
+ *    has been deallocated.
+ *
+ *  The report also contains the parameters of the run and the peak resident
+ *  set size of the process.
+ */
+
+#import <Foundation/Foundation.h>
+
+@interface LKBenchmark : NSObject
+{
+   // directory information
+   NSString            * uri;
+   NSString            * baseDN;
+   NSString            * bindWho;
+   NSString            * bindPassword;
+
+   // workload information
+   NSUInteger            entryCount;
+   NSUInteger            iterations;
+   NSUInteger            repeats;
+
+   // results
+   NSMutableDictionary * report;
+   NSUInteger            dispatcherExits;
+}
+
+#pragma mark - Object Management Methods
+/// @name Object Management Methods
+
+/// Initializes a benchmark of the directory server at an LDAP URI.
+/// @param ldapURI  The URI of the directory server.
+- (id) initWithURI:(NSString *)ldapURI;
+
+
+#pragma mark - Getter/Setter methods
+/// @name Directory information
+
+/// The URI of the directory server.
+@property (nonatomic, readonly) NSString   * uri;
+
+/// The suffix loaded by the fixture. The default is `dc=example,dc=com`.
+@property (nonatomic, copy)     NSString   * baseDN;
+
+/// The DN used by binds and write operations.
+@property (nonatomic, copy)     NSString   * bindWho;
+
+/// The password of bindWho.
+@property (nonatomic, copy)     NSString   * bindPassword;
+
+/// @name Workload information
+
+/// The number of `uid=userNNNNNN` entries loaded by the fixture.
+@property (nonatomic, assign)   NSUInteger   entryCount;
+
+/// The number of operations measured by each repeat of a case.
+@property (nonatomic, assign)   NSUInteger   iterations;
+
+/// The number of times each case is measured.
+///
+/// Bind latencies include every repeat and rates are taken from the fastest
+/// repeat. The write case writes each entry once.
+@property (nonatomic, assign)   NSUInteger   repeats;
+
+
+#pragma mark - Benchmarks
+/// @name Benchmarks
+
+/// Runs a benchmark case and adds its results to the report.
+/// @param name  The name of the case.
+/// @return Returns `NO` if the case is unknown or an operation failed.
+- (BOOL) runCase:(NSString *)name;
+
+/// Returns the names of the cases in the order in which they should be run.
++ (NSArray *) caseNames;
+
+/// @name Results
+
+/// Returns the results of the cases which have been run.
+- (NSDictionary *) report;
+
+/// Returns the report encoded as JSON.
+- (NSData *) reportJSONData;
+
+@end
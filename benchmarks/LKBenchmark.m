@@ -0,0 +1,944 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  benchmarks/LKBenchmark.m measures LDAP operations performed through LdapKit
+ */
+#import "LKBenchmark.h"
+
+#import <LdapKit/LdapKit.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// filter matching each entry generated by the fixture
+#define LK_BENCHMARK_FILTER @"(objectClass=inetOrgPerson)"
+
+// bytes encoded and decoded by each measurement of the base64 case
+#define LK_BENCHMARK_BASE64_BYTES (32 * 1024 * 1024)
+
+// bytes encoded or decoded before an autorelease pool is drained
+#define LK_BENCHMARK_BASE64_POOL_BYTES (64 * 1024)
+
+// connections opened by the multiplexed session of the teardown case
+#define LK_BENCHMARK_TEARDOWN_POOL_SIZE 4
+
+// seconds the teardown case waits for dispatcher threads to exit
+#define LK_BENCHMARK_TEARDOWN_TIMEOUT 5.0
+
+// name given to dispatcher threads by LKConnection
+#define LK_BENCHMARK_DISPATCHER_NAME @"LdapKit dispatcher"
+
+
+// name of the base64 codec the library was built with
+#ifdef LK_BASE64_SCALAR
+#define LK_BENCHMARK_BASE64_CODEC @"scalar"
+#else
+#define LK_BENCHMARK_BASE64_CODEC @"simd"
+#endif
+
+
+@interface LKBenchmark ()
+
+/// @name sessions
+- (LKLdap *) newSession;
+- (BOOL) waitForMessage:(LKMessage *)message;
+
+/// @name entries
+- (NSString *) peopleDN;
+- (NSString *) userDN:(NSUInteger)index;
+
+/// @name results
++ (NSNumber *) peakResidentSetSize;
++ (NSDictionary *) rateWithCount:(NSUInteger)count seconds:(NSTimeInterval)seconds;
++ (NSDictionary *) summaryOfSamples:(double *)samples count:(NSUInteger)count;
+
+/// @name cases
+#ifndef LK_BENCHMARK_NO_BASE64
+- (BOOL) runBase64;
+#endif
+- (BOOL) runBind;
+- (BOOL) runMaterialize;
+- (BOOL) runSearch;
+- (BOOL) runSearchScope:(LKLdapSearchScope)scope name:(NSString *)name
+         results:(NSMutableDictionary *)results;
+- (BOOL) runTeardown;
+- (void) threadWillExit:(NSNotification *)notification;
+- (BOOL) runWrite;
+- (BOOL) restoreEntries:(NSArray *)entries count:(NSUInteger)count;
+
+@end
+
+
+// orders samples for percentiles
+static int lk_benchmark_compare(const void * a, const void * b)
+{
+   double x;
+   double y;
+   x = *(const double *)a;
+   y = *(const double *)b;
+   return((x > y) - (x < y));
+}
+
+
+@implementation LKBenchmark
+
+// directory information
+@synthesize uri;
+@synthesize baseDN;
+@synthesize bindWho;
+@synthesize bindPassword;
+
+// workload information
+@synthesize entryCount;
+@synthesize iterations;
+@synthesize repeats;
+
+
+#pragma mark - Object Management Methods
+
+- (void) dealloc
+{
+   // directory information
+   [uri          release];
+   [baseDN       release];
+   [bindWho      release];
+   [bindPassword release];
+
+   // results
+   [report release];
+
+   [super dealloc];
+
+   return;
+}
+
+
+- (id) initWithURI:(NSString *)ldapURI
+{
+   NSDictionary * parameters;
+
+   if ((self = [super init]) == nil)
+      return(self);
+
+   // directory information
+   uri          = [ldapURI copy];
+   baseDN       = [@"dc=example,dc=com" retain];
+   bindWho      = [@"cn=admin,dc=example,dc=com" retain];
+   bindPassword = [@"secret" retain];
+
+   // workload information
+   entryCount = 1000;
+   iterations = 100;
+   repeats    = 3;
+
+   // results
+   report = [[NSMutableDictionary alloc] init];
+   parameters = [NSDictionary dictionaryWithObjectsAndKeys:
+      uri, @"uri",
+      [[NSProcessInfo processInfo] hostName], @"host",
+      [NSNumber numberWithUnsignedInteger:[[NSProcessInfo processInfo] activeProcessorCount]], @"cpus",
+      nil];
+   [report setObject:parameters forKey:@"parameters"];
+
+   return(self);
+}
+
+
+#pragma mark - Sessions
+
+- (LKLdap *) newSession
+{
+   LKLdap * session;
+
+   session = [[LKLdap alloc] init];
+   session.ldapURI                   = uri;
+   session.ldapEncryptionScheme      = LKLdapEncryptionSchemeNone;
+   session.ldapBindWho               = bindWho;
+   session.ldapBindCredentialsString = bindPassword;
+
+   return(session);
+}
+
+
+- (BOOL) waitForMessage:(LKMessage *)message
+{
+   [message waitUntilFinished];
+   if ((message.isSuccessful))
+      return(YES);
+   NSLog(@"%@: %@", message.errorTitle, message.errorMessage);
+   return(NO);
+}
+
+
+#pragma mark - Entries
+
+- (NSString *) peopleDN
+{
+   return([NSString stringWithFormat:@"ou=people,%@", baseDN]);
+}
+
+
+- (NSString *) userDN:(NSUInteger)index
+{
+   return([NSString stringWithFormat:@"uid=user%06lu,ou=people,%@",
+      (unsigned long)(index % entryCount), baseDN]);
+}
+
+
+#pragma mark - Results
+
++ (NSNumber *) peakResidentSetSize
+{
+   struct rusage usage;
+   uint64_t      bytes;
+
+   if (getrusage(RUSAGE_SELF, &usage) == -1)
+      return([NSNumber numberWithInt:0]);
+
+   // Darwin reports the size in bytes and other systems in kilobytes
+#ifdef __APPLE__
+   bytes = (uint64_t)usage.ru_maxrss;
+#else
+   bytes = (uint64_t)usage.ru_maxrss * 1024;
+#endif
+
+   return([NSNumber numberWithUnsignedLongLong:bytes]);
+}
+
+
++ (NSDictionary *) rateWithCount:(NSUInteger)count seconds:(NSTimeInterval)seconds
+{
+   double rate;
+
+   rate = (seconds > 0) ? ((double)count / seconds) : 0;
+
+   return([NSDictionary dictionaryWithObjectsAndKeys:
+      [NSNumber numberWithUnsignedInteger:count], @"count",
+      [NSNumber numberWithDouble:seconds],        @"seconds",
+      [NSNumber numberWithDouble:rate],           @"per_second",
+      nil]);
+}
+
+
++ (NSDictionary *) summaryOfSamples:(double *)samples count:(NSUInteger)count
+{
+   double     sum;
+   NSUInteger pos;
+
+   if (count == 0)
+      return([NSDictionary dictionary]);
+
+   qsort(samples, count, sizeof(double), lk_benchmark_compare);
+
+   sum = 0;
+   for(pos = 0; pos < count; pos++)
+      sum += samples[pos];
+
+   return([NSDictionary dictionaryWithObjectsAndKeys:
+      [NSNumber numberWithUnsignedInteger:count],            @"count",
+      [NSNumber numberWithDouble:(sum / count)],             @"mean_ms",
+      [NSNumber numberWithDouble:samples[count / 2]],        @"p50_ms",
+      [NSNumber numberWithDouble:samples[(count * 95) / 100]], @"p95_ms",
+      [NSNumber numberWithDouble:samples[count - 1]],        @"max_ms",
+      nil]);
+}
+
+
+#pragma mark - Benchmarks
+
++ (NSArray *) caseNames
+{
+   return([NSArray arrayWithObjects:@"bind", @"search", @"materialize",
+#ifndef LK_BENCHMARK_NO_BASE64
+      @"base64",
+#endif
+      @"write", @"teardown", nil]);
+}
+
+
+- (BOOL) runCase:(NSString *)name
+{
+   NSAutoreleasePool * pool;
+   BOOL                success;
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   if ([name isEqualToString:@"bind"])
+      success = [self runBind];
+   else if ([name isEqualToString:@"search"])
+      success = [self runSearch];
+   else if ([name isEqualToString:@"materialize"])
+      success = [self runMaterialize];
+   else if ([name isEqualToString:@"write"])
+      success = [self runWrite];
+   else if ([name isEqualToString:@"teardown"])
+      success = [self runTeardown];
+#ifndef LK_BENCHMARK_NO_BASE64
+   else if ([name isEqualToString:@"base64"])
+      success = [self runBase64];
+#endif
+   else
+   {
+      NSLog(@"unknown benchmark case: %@", name);
+      success = NO;
+   };
+
+   [pool release];
+
+   return(success);
+}
+
+
+#ifndef LK_BENCHMARK_NO_BASE64
+- (BOOL) runBase64
+{
+   NSAutoreleasePool   * pool;
+   NSMutableDictionary * results;
+   NSMutableDictionary * codec;
+   NSMutableData       * data;
+   NSString            * encoded;
+   NSString            * label;
+   const char          * chars;
+   uint8_t             * bytes;
+   NSUInteger            size;
+   NSUInteger            loops;
+   NSUInteger            batch;
+   NSUInteger            pos;
+   NSUInteger            index;
+   NSUInteger            repeat;
+   size_t                charsLen;
+   uint32_t              seed;
+   NSTimeInterval        start;
+   NSTimeInterval        encode;
+   NSTimeInterval        decode;
+   NSTimeInterval        seconds;
+   double                megabytes;
+   BOOL                  success;
+
+   static const NSUInteger sizes[] = { 1024, 4096, 16384, 65536, 262144, 1048576, 0 };
+
+   results = [NSMutableDictionary dictionary];
+   success = YES;
+
+   // the SIMD codec is the scalar codec on processors without SSSE3
+   codec = [NSMutableDictionary dictionary];
+   [results setObject:codec forKey:LK_BENCHMARK_BASE64_CODEC];
+
+   for(index = 0; ((sizes[index] != 0) && ((success))); index++)
+   {
+      size = sizes[index];
+
+      // generates the same pseudo-random bytes for every codec
+      data  = [NSMutableData dataWithLength:size];
+      bytes = [data mutableBytes];
+      seed  = (uint32_t)size;
+      for(pos = 0; pos < size; pos++)
+      {
+         seed       = (seed * 1103515245) + 12345;
+         bytes[pos] = (uint8_t)(seed >> 16);
+      };
+      encoded  = [LKBerValue base64StringWithData:data];
+      chars    = [encoded UTF8String];
+      charsLen = strlen(chars);
+
+      // verifies the codec before measuring it
+      if (!([[LKBerValue dataWithBase64Bytes:chars length:charsLen] isEqualToData:data]))
+      {
+         NSLog(@"base64 decoding of %lu bytes does not match the data",
+            (unsigned long)size);
+         success = NO;
+         break;
+      };
+
+      loops  = LK_BENCHMARK_BASE64_BYTES / size;
+      batch  = (size < LK_BENCHMARK_BASE64_POOL_BYTES) ? (LK_BENCHMARK_BASE64_POOL_BYTES / size) : 1;
+      encode = 0;
+      decode = 0;
+      for(repeat = 0; repeat < repeats; repeat++)
+      {
+         // encodes data
+         pool  = [[NSAutoreleasePool alloc] init];
+         start = [NSDate timeIntervalSinceReferenceDate];
+         for(pos = 0; pos < loops; pos++)
+         {
+            [LKBerValue base64StringWithData:data];
+            if ((pos % batch) == (batch - 1))
+            {
+               [pool release];
+               pool = [[NSAutoreleasePool alloc] init];
+            };
+         };
+         seconds = [NSDate timeIntervalSinceReferenceDate] - start;
+         [pool release];
+         if ((repeat == 0) || (seconds < encode))
+            encode = seconds;
+
+         // decodes data
+         pool  = [[NSAutoreleasePool alloc] init];
+         start = [NSDate timeIntervalSinceReferenceDate];
+         for(pos = 0; pos < loops; pos++)
+         {
+            [LKBerValue dataWithBase64Bytes:chars length:charsLen];
+            if ((pos % batch) == (batch - 1))
+            {
+               [pool release];
+               pool = [[NSAutoreleasePool alloc] init];
+            };
+         };
+         seconds = [NSDate timeIntervalSinceReferenceDate] - start;
+         [pool release];
+         if ((repeat == 0) || (seconds < decode))
+            decode = seconds;
+      };
+
+      // throughput is measured in megabytes of unencoded data
+      megabytes = ((double)size * loops) / (1024 * 1024);
+      label     = (size < 1048576)
+                ? [NSString stringWithFormat:@"%luKB", (unsigned long)(size / 1024)]
+                : [NSString stringWithFormat:@"%luMB", (unsigned long)(size / 1048576)];
+      [codec setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+         [NSNumber numberWithDouble:((encode > 0) ? (megabytes / encode) : 0)], @"encode_mb_per_second",
+         [NSNumber numberWithDouble:((decode > 0) ? (megabytes / decode) : 0)], @"decode_mb_per_second",
+         nil] forKey:label];
+   };
+
+   if ((success))
+      [report setObject:results forKey:@"base64"];
+
+   return(success);
+}
+#endif
+
+
+- (BOOL) runBind
+{
+   NSAutoreleasePool * pool;
+   LKLdap            * session;
+   LKMessage         * message;
+   double            * samples;
+   NSUInteger          count;
+   NSUInteger          pos;
+   NSTimeInterval      start;
+   BOOL                success;
+
+   count   = iterations * repeats;
+   samples = malloc(sizeof(double) * (count + 1));
+   success = YES;
+
+   // each bind opens a new connection from a new session
+   for(pos = 0; ((pos < count) && ((success))); pos++)
+   {
+      pool    = [[NSAutoreleasePool alloc] init];
+      session = [self newSession];
+      start   = [NSDate timeIntervalSinceReferenceDate];
+      message = [session ldapBind];
+      success = [self waitForMessage:message];
+      samples[pos] = ([NSDate timeIntervalSinceReferenceDate] - start) * 1000;
+      [session release];
+      [pool release];
+   };
+
+   if ((success))
+      [report setObject:[LKBenchmark summaryOfSamples:samples count:count]
+              forKey:@"bind"];
+
+   free(samples);
+
+   return(success);
+}
+
+
+- (BOOL) runSearch
+{
+   NSMutableDictionary * results;
+   BOOL                  success;
+
+   results = [NSMutableDictionary dictionary];
+
+   success = [self runSearchScope:LKLdapSearchScopeBase name:@"base" results:results];
+   if ((success))
+      success = [self runSearchScope:LKLdapSearchScopeOneLevel name:@"one" results:results];
+   if ((success))
+      success = [self runSearchScope:LKLdapSearchScopeSubTree name:@"sub" results:results];
+
+   if ((success))
+      [report setObject:results forKey:@"search"];
+
+   return(success);
+}
+
+
+- (BOOL) runSearchScope:(LKLdapSearchScope)scope name:(NSString *)name
+         results:(NSMutableDictionary *)results
+{
+   NSAutoreleasePool * pool;
+   LKLdap            * session;
+   LKMessage         * message;
+   NSString          * base;
+   NSString          * filter;
+   NSUInteger          searches;
+   NSUInteger          entries;
+   NSUInteger          bestEntries;
+   NSUInteger          repeat;
+   NSUInteger          pos;
+   NSTimeInterval      start;
+   NSTimeInterval      seconds;
+   NSTimeInterval      best;
+   BOOL                success;
+
+   // base searches read single entries while one level and subtree searches
+   // return every entry of the fixture
+   searches = (scope == LKLdapSearchScopeBase) ? iterations : 1;
+   filter   = (scope == LKLdapSearchScopeBase) ? @"(objectClass=*)" : LK_BENCHMARK_FILTER;
+   base     = (scope == LKLdapSearchScopeSubTree) ? baseDN : [self peopleDN];
+
+   session = [self newSession];
+   success = [self waitForMessage:[session ldapBind]];
+
+   best        = 0;
+   bestEntries = 0;
+   for(repeat = 0; ((repeat < repeats) && ((success))); repeat++)
+   {
+      entries = 0;
+      start   = [NSDate timeIntervalSinceReferenceDate];
+      for(pos = 0; ((pos < searches) && ((success))); pos++)
+      {
+         pool    = [[NSAutoreleasePool alloc] init];
+         if (scope == LKLdapSearchScopeBase)
+            base = [self userDN:(repeat * searches) + pos];
+         message = [session ldapSearchBaseDN:base scope:scope filter:filter
+                            attributes:nil attributesOnly:NO];
+         success = [self waitForMessage:message];
+         entries += [message.entries count];
+         [pool release];
+      };
+      seconds = [NSDate timeIntervalSinceReferenceDate] - start;
+      if ((repeat == 0) || (seconds < best))
+      {
+         best        = seconds;
+         bestEntries = entries;
+      };
+   };
+
+   [session release];
+
+   if (!(success))
+      return(NO);
+
+   [results setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+      [LKBenchmark rateWithCount:searches    seconds:best], @"searches",
+      [LKBenchmark rateWithCount:bestEntries seconds:best], @"entries",
+      nil] forKey:name];
+
+   return(YES);
+}
+
+
+- (BOOL) runMaterialize
+{
+   NSAutoreleasePool * pool;
+   LKLdap            * session;
+   LKMessage         * message;
+   LKEntry           * entry;
+   LKBerValue        * value;
+   NSString          * attribute;
+   NSUInteger          entries;
+   NSUInteger          values;
+   NSUInteger          bytes;
+   NSUInteger          repeat;
+   NSTimeInterval      start;
+   NSTimeInterval      seconds;
+   NSTimeInterval      best;
+   BOOL                success;
+
+   session = [self newSession];
+   success = [self waitForMessage:[session ldapBind]];
+
+   best    = 0;
+   entries = 0;
+   values  = 0;
+   bytes   = 0;
+   for(repeat = 0; ((repeat < repeats) && ((success))); repeat++)
+   {
+      // results are not shared between repeats so that every object is
+      // created by the measured loop
+      pool    = [[NSAutoreleasePool alloc] init];
+      message = [session ldapSearchBaseDN:[self peopleDN]
+                         scope:LKLdapSearchScopeOneLevel
+                         filter:LK_BENCHMARK_FILTER attributes:nil
+                         attributesOnly:NO];
+      success = [self waitForMessage:message];
+
+      entries = 0;
+      values  = 0;
+      bytes   = 0;
+      start   = [NSDate timeIntervalSinceReferenceDate];
+      for(entry in message.entries)
+      {
+         entries++;
+         [entry dn];
+         for(attribute in [entry attributes])
+         {
+            for(value in [entry valuesForAttribute:attribute])
+            {
+               values++;
+               bytes += value.bv_len;
+               if ((value.isBerString))
+                  [value berString];
+               else
+                  [value berStringBase64];
+            };
+         };
+      };
+      seconds = [NSDate timeIntervalSinceReferenceDate] - start;
+      if ((repeat == 0) || (seconds < best))
+         best = seconds;
+
+      [pool release];
+   };
+
+   [session release];
+
+   if (!(success))
+      return(NO);
+
+   [report setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+      [NSNumber numberWithUnsignedInteger:entries], @"entries",
+      [NSNumber numberWithUnsignedInteger:values],  @"values",
+      [NSNumber numberWithUnsignedInteger:bytes],   @"bytes",
+      [NSNumber numberWithDouble:best],             @"seconds",
+      [NSNumber numberWithDouble:((entries) ? (best * 1e9 / entries) : 0)], @"ns_per_entry",
+      [NSNumber numberWithDouble:((values)  ? (best * 1e9 / values)  : 0)], @"ns_per_value",
+      nil] forKey:@"materialize"];
+
+   return(YES);
+}
+
+
+- (BOOL) runTeardown
+{
+   NSAutoreleasePool * pool;
+   NSMutableArray    * messages;
+   LKLdap            * session;
+   LKMessage         * message;
+   NSUInteger          connections;
+   NSUInteger          exited;
+   NSUInteger          running;
+   NSUInteger          pos;
+   NSTimeInterval      start;
+   NSTimeInterval      seconds;
+   BOOL                success;
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   @synchronized(self)
+   {
+      dispatcherExits = 0;
+   };
+   [[NSNotificationCenter defaultCenter] addObserver:self
+      selector:@selector(threadWillExit:) name:NSThreadWillExitNotification object:nil];
+
+   // each connection of a multiplexed session runs a dispatcher
+   session = [self newSession];
+   session.ldapPoolSize          = LK_BENCHMARK_TEARDOWN_POOL_SIZE;
+   session.ldapMultiplexRequests = YES;
+   session.ldapMetrics.isEnabled = YES;
+
+   // sends concurrent searches so every connection of the pool is opened
+   messages = [NSMutableArray arrayWithCapacity:(LK_BENCHMARK_TEARDOWN_POOL_SIZE * 4)];
+   for(pos = 0; pos < (LK_BENCHMARK_TEARDOWN_POOL_SIZE * 4); pos++)
+   {
+      message = [session ldapSearchBaseDN:[self userDN:pos] scope:LKLdapSearchScopeBase
+                         filter:@"(objectClass=*)" attributes:nil attributesOnly:NO];
+      [messages addObject:message];
+   };
+   success = YES;
+   for(message in messages)
+      if (!([self waitForMessage:message]))
+         success = NO;
+   connections = [[[session.ldapMetrics snapshot] objectForKey:@"connections"] unsignedIntegerValue];
+   @synchronized(self)
+   {
+      running = connections - dispatcherExits;
+   };
+
+   // messages retain the session, so the session is deallocated with the pool
+   [session release];
+   start = [NSDate timeIntervalSinceReferenceDate];
+   [pool release];
+   seconds = [NSDate timeIntervalSinceReferenceDate] - start;
+
+   // the exiting threads post the notification after LKLdap stopped waiting
+   exited = 0;
+   while ([NSDate timeIntervalSinceReferenceDate] < (start + LK_BENCHMARK_TEARDOWN_TIMEOUT))
+   {
+      @synchronized(self)
+      {
+         exited = dispatcherExits;
+      };
+      if (exited >= connections)
+         break;
+      [NSThread sleepForTimeInterval:0.01];
+   };
+
+   [[NSNotificationCenter defaultCenter] removeObserver:self
+      name:NSThreadWillExitNotification object:nil];
+
+   if (!(success))
+      return(NO);
+   if ( (connections == 0) || (running == 0) )
+   {
+      NSLog(@"teardown: the session did not start a dispatcher");
+      return(NO);
+   };
+   if (exited < connections)
+   {
+      NSLog(@"teardown: %lu of %lu dispatchers still running after the session was released",
+         (unsigned long)(connections - exited), (unsigned long)connections);
+      return(NO);
+   };
+
+   [report setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+      [NSNumber numberWithUnsignedInteger:connections], @"connections",
+      [NSNumber numberWithUnsignedInteger:running],     @"running_before_release",
+      [NSNumber numberWithUnsignedInteger:exited],      @"exited",
+      [NSNumber numberWithDouble:(seconds * 1000)],     @"release_ms",
+      nil] forKey:@"teardown"];
+
+   return(YES);
+}
+
+
+- (void) threadWillExit:(NSNotification *)notification
+{
+   // posted on the exiting thread
+   if (!([[[notification object] name] isEqualToString:LK_BENCHMARK_DISPATCHER_NAME]))
+      return;
+   @synchronized(self)
+   {
+      dispatcherExits++;
+   };
+   return;
+}
+
+
+- (BOOL) runWrite
+{
+   NSAutoreleasePool   * pool;
+   NSMutableDictionary * results;
+   NSMutableArray      * originals;
+   LKLdap              * session;
+   LKMessage           * message;
+   LKMod               * mod;
+   NSString            * rdn;
+   NSUInteger            count;
+   NSUInteger            deleted;
+   NSUInteger            pos;
+   NSTimeInterval        start;
+   BOOL                  success;
+
+   // entries are renamed and deleted, so each entry is written only once
+   // regardless of the number of repeats
+   count     = (iterations < entryCount) ? iterations : entryCount;
+   deleted   = 0;
+   results   = [NSMutableDictionary dictionary];
+   originals = [NSMutableArray arrayWithCapacity:count];
+
+   session = [self newSession];
+   success = [self waitForMessage:[session ldapBind]];
+
+   // reads the entries which are written so that they can be restored
+   for(pos = 0; ((pos < count) && ((success))); pos++)
+   {
+      pool    = [[NSAutoreleasePool alloc] init];
+      message = [session ldapSearchBaseDN:[self userDN:pos] scope:LKLdapSearchScopeBase
+                         filter:@"(objectClass=*)" attributes:nil attributesOnly:NO];
+      success = [self waitForMessage:message];
+      if (((success)) && ([message.entries count] == 1))
+         [originals addObject:[message.entries objectAtIndex:0]];
+      else
+         success = NO;
+      [pool release];
+   };
+
+   // modifies entries
+   start = [NSDate timeIntervalSinceReferenceDate];
+   for(pos = 0; ((pos < count) && ((success))); pos++)
+   {
+      pool    = [[NSAutoreleasePool alloc] init];
+      mod     = [LKMod modWithOperation:LKLdapModOperationReplace
+                       type:@"description"
+                       value:[NSString stringWithFormat:@"modified %lu", (unsigned long)pos]];
+      message = [session ldapModifyDN:[self userDN:pos] modification:mod];
+      success = [self waitForMessage:message];
+      [pool release];
+   };
+   [results setObject:[LKBenchmark rateWithCount:count
+                                   seconds:([NSDate timeIntervalSinceReferenceDate] - start)]
+            forKey:@"modify"];
+
+   // renames entries
+   start = [NSDate timeIntervalSinceReferenceDate];
+   for(pos = 0; ((pos < count) && ((success))); pos++)
+   {
+      pool    = [[NSAutoreleasePool alloc] init];
+      rdn     = [NSString stringWithFormat:@"uid=bench%06lu", (unsigned long)pos];
+      message = [session ldapRenameDN:[self userDN:pos] newRDN:rdn
+                         newSuperior:nil deleteOldRDN:1];
+      success = [self waitForMessage:message];
+      [pool release];
+   };
+   [results setObject:[LKBenchmark rateWithCount:count
+                                   seconds:([NSDate timeIntervalSinceReferenceDate] - start)]
+            forKey:@"rename"];
+
+   // deletes renamed entries
+   start = [NSDate timeIntervalSinceReferenceDate];
+   for(pos = 0; ((pos < count) && ((success))); pos++)
+   {
+      pool    = [[NSAutoreleasePool alloc] init];
+      rdn     = [NSString stringWithFormat:@"uid=bench%06lu,%@", (unsigned long)pos,
+                 [self peopleDN]];
+      message = [session ldapDeleteDN:rdn];
+      if ((success = [self waitForMessage:message]))
+         deleted++;
+      [pool release];
+   };
+   [results setObject:[LKBenchmark rateWithCount:count
+                                   seconds:([NSDate timeIntervalSinceReferenceDate] - start)]
+            forKey:@"delete"];
+
+   [session release];
+
+   // adds the deleted entries with their original attributes so that the
+   // fixture may be used by another run
+   if (!([self restoreEntries:originals count:deleted]))
+      success = NO;
+
+   if ((success))
+      [report setObject:results forKey:@"write"];
+
+   return(success);
+}
+
+
+- (BOOL) restoreEntries:(NSArray *)entries count:(NSUInteger)count
+{
+   NSAutoreleasePool * pool;
+   LKEntry           * entry;
+   NSArray           * attributes;
+   LDAP              * ld;
+   LDAPMod          ** mods;
+   struct berval       cred;
+   NSUInteger          pos;
+   NSUInteger          index;
+   int                 version;
+   int                 err;
+
+   if (count == 0)
+      return(YES);
+
+   // restores entries with libldap because LKLdap does not send add requests
+   if ((err = ldap_initialize(&ld, [uri UTF8String])) != LDAP_SUCCESS)
+   {
+      NSLog(@"ldap_initialize(): %s", ldap_err2string(err));
+      return(NO);
+   };
+   version = LDAP_VERSION3;
+   ldap_set_option(ld, LDAP_OPT_PROTOCOL_VERSION, &version);
+   cred.bv_val = (char *)[bindPassword UTF8String];
+   cred.bv_len = strlen(cred.bv_val);
+   err = ldap_sasl_bind_s(ld, [bindWho UTF8String], LDAP_SASL_SIMPLE, &cred,
+                          NULL, NULL, NULL);
+
+   for(pos = 0; ((pos < count) && (err == LDAP_SUCCESS)); pos++)
+   {
+      pool       = [[NSAutoreleasePool alloc] init];
+      entry      = [entries objectAtIndex:pos];
+      attributes = [entry attributes];
+
+      mods = calloc([attributes count] + 1, sizeof(LDAPMod *));
+      for(index = 0; index < [attributes count]; index++)
+         mods[index] = [[LKMod modWithOperation:LKLdapModOperationAdd
+                               type:[attributes objectAtIndex:index]
+                               values:[entry valuesForAttribute:[attributes objectAtIndex:index]]]
+                        newLDAPMod];
+
+      err = ldap_add_ext_s(ld, [entry.dn UTF8String], mods, NULL, NULL);
+
+      for(index = 0; index < [attributes count]; index++)
+         [LKMod freeLDAPMod:mods[index]];
+      free(mods);
+      [pool release];
+   };
+
+   ldap_unbind_ext_s(ld, NULL, NULL);
+
+   if (err != LDAP_SUCCESS)
+   {
+      NSLog(@"unable to restore entries, reload the fixture: %s", ldap_err2string(err));
+      return(NO);
+   };
+
+   return(YES);
+}
+
+
+#pragma mark - Report
+
+- (NSDictionary *) report
+{
+   NSMutableDictionary * parameters;
+
+   parameters = [NSMutableDictionary dictionaryWithDictionary:[report objectForKey:@"parameters"]];
+   [parameters setObject:baseDN forKey:@"base_dn"];
+   [parameters setObject:[NSNumber numberWithUnsignedInteger:entryCount] forKey:@"entries"];
+   [parameters setObject:[NSNumber numberWithUnsignedInteger:iterations] forKey:@"iterations"];
+   [parameters setObject:[NSNumber numberWithUnsignedInteger:repeats]    forKey:@"repeats"];
+   [report setObject:parameters forKey:@"parameters"];
+
+   [report setObject:[LKBenchmark peakResidentSetSize] forKey:@"peak_rss_bytes"];
+
+   return([[report copy] autorelease]);
+}
+
+
+- (NSData *) reportJSONData
+{
+   return([NSJSONSerialization dataWithJSONObject:[self report]
+                               options:NSJSONWritingPrettyPrinted error:NULL]);
+}
+
+@end
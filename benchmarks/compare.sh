@@ -0,0 +1,121 @@
+#!/bin/sh
+#
+#   LDAP Kit
+#   Copyright (c) 2012, Bindle Binaries
+#
+#   @BINDLE_BINARIES_BSD_LICENSE_START@
+#
+#   Redistribution and use in source and binary forms, with or without
+#   modification, are permitted provided that the following conditions are
+#   met:
+#
+#      * Redistributions of source code must retain the above copyright
+#        notice, this list of conditions and the following disclaimer.
+#      * Redistributions in binary form must reproduce the above copyright
+#        notice, this list of conditions and the following disclaimer in the
+#        documentation and/or other materials provided with the distribution.
+#      * Neither the name of Bindle Binaries nor the
+#        names of its contributors may be used to endorse or promote products
+#        derived from this software without specific prior written permission.
+#
+#   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+#   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+#   THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+#   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+#   ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+#   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+#   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+#   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+#   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+#   OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+#   SUCH DAMAGE.
+#
+#   @BINDLE_BINARIES_BSD_LICENSE_END@
+#
+#   benchmarks/compare.sh - compares search throughput of two revisions
+#
+
+# saves revisions from command line arguments
+if test "x${2}" = "x";then
+   echo "Usage: ${0} before after" 1>&2;
+   echo "Environment:" 1>&2;
+   echo "   BENCH_ENTRIES     number of entries to load (default: 200)" 1>&2;
+   echo "   BENCH_ITERATIONS  base searches in each repeat (default: 20)" 1>&2;
+   echo "   BENCH_REPEATS     number of repeats (default: 1)" 1>&2;
+   echo "   CC                Objective-C compiler (default: clang)" 1>&2;
+   exit 1;
+fi;
+BEFORE=$1;
+AFTER=$2;
+
+# benchmark settings
+#
+# Before [LKMessage resultWithMessageID:resultEntries:] waited on the socket,
+# it slept 250 ms before reading each entry, so the default is small.
+BENCH_ENTRIES=${BENCH_ENTRIES:-200}
+BENCH_ITERATIONS=${BENCH_ITERATIONS:-20}
+BENCH_REPEATS=${BENCH_REPEATS:-1}
+CC=${CC:-clang}
+
+SRCDIR=`cd "\`dirname "${0}"\`/.." && pwd`;
+LKBENCH_DIR=${LKBENCH_DIR:-/tmp/lkbench}
+WORKDIR="${LKBENCH_DIR}/compare"
+export LKBENCH_DIR;
+
+
+# builds lkbench from the library sources of a revision
+compare_build()
+{
+   REVDIR="${WORKDIR}/${1}";
+   rm -Rf "${REVDIR}";
+   mkdir -p "${REVDIR}" || return 1;
+   (cd "${SRCDIR}" && git archive "${1}" LdapKit) |tar -x -C "${REVDIR}" || return 1;
+   # older revisions do not have the base64 methods of LKBerValue, so the
+   # base64 case is left out
+   "${CC}" -O2 -fobjc-exceptions -Wno-deprecated-declarations \
+      -DLK_BENCHMARK_NO_BASE64 \
+      -include "${REVDIR}/LdapKit/support/LdapKit-Prefix.pch" \
+      -I "${REVDIR}" \
+      -I "${REVDIR}/LdapKit/models" \
+      -I "${REVDIR}/LdapKit/categories" \
+      -o "${REVDIR}/lkbench" \
+      "${REVDIR}"/LdapKit/models/*.m \
+      "${SRCDIR}/benchmarks/LKBenchmark.m" \
+      "${SRCDIR}/benchmarks/main.m" \
+      -framework Foundation -framework AppKit -lldap -llber || return 1;
+   return 0;
+}
+
+
+# runs the search case of a revision
+compare_run()
+{
+   echo "${0}: searching with ${1}" 1>&2;
+   "${WORKDIR}/${1}/lkbench" -H "${URI}" -c search \
+      -n ${BENCH_ENTRIES} -i ${BENCH_ITERATIONS} -r ${BENCH_REPEATS} \
+      -o "${WORKDIR}/${1}.json" || return 1;
+   return 0;
+}
+
+
+compare_build "${BEFORE}" || exit 1;
+compare_build "${AFTER}"  || exit 1;
+
+# older revisions create invalid ldapi:// URIs, so both use TCP
+LKBENCH_ENTRIES=${BENCH_ENTRIES} "${SRCDIR}/benchmarks/slapd-fixture.sh" start > /dev/null || exit 1;
+URI=`"${SRCDIR}/benchmarks/slapd-fixture.sh" tcp-uri`;
+
+STATUS=0;
+compare_run "${BEFORE}" || STATUS=1;
+compare_run "${AFTER}"  || STATUS=1;
+
+"${SRCDIR}/benchmarks/slapd-fixture.sh" stop;
+
+if test ${STATUS} -eq 0;then
+   echo "${BEFORE}: ${WORKDIR}/${BEFORE}.json";
+   echo "${AFTER}: ${WORKDIR}/${AFTER}.json";
+fi;
+
+exit ${STATUS};
+
+# end of script
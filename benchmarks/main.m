@@ -0,0 +1,202 @@
+/*
+ *  LDAP Kit
+ *  Copyright (c) 2012, Bindle Binaries
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_START@
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Bindle Binaries nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+ *  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *  @BINDLE_BINARIES_BSD_LICENSE_END@
+ */
+/*
+ *  benchmarks/main.m runs LdapKit benchmarks and prints the results as JSON
+ */
+#import <Foundation/Foundation.h>
+
+#import "LKBenchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+static void lk_benchmark_usage(void)
+{
+   printf("Usage: lkbench [options] -H uri\n");
+   printf("Options:\n");
+   printf("  -b dn         suffix loaded by the fixture (default: dc=example,dc=com)\n");
+   printf("  -c cases      comma separated cases (default: %s)\n",
+      [[[LKBenchmark caseNames] componentsJoinedByString:@","] UTF8String]);
+   printf("  -D dn         bind DN (default: cn=admin,dc=example,dc=com)\n");
+   printf("  -h            display this message\n");
+   printf("  -H uri        LDAP URI of the directory server\n");
+   printf("  -i count      operations measured by each repeat (default: 100)\n");
+   printf("  -n count      number of entries loaded by the fixture (default: 1000)\n");
+   printf("  -o file       write the JSON report to file (default: stdout)\n");
+   printf("  -r count      number of repeats of each case (default: 3)\n");
+   printf("  -w password   bind password (default: secret)\n");
+   return;
+}
+
+
+int main(int argc, char * argv[])
+{
+   NSAutoreleasePool * pool;
+   LKBenchmark       * benchmark;
+   NSArray           * cases;
+   NSString          * name;
+   NSString          * uri;
+   NSString          * output;
+   NSString          * baseDN;
+   NSString          * bindWho;
+   NSString          * bindPassword;
+   NSData            * json;
+   NSUInteger          entryCount;
+   NSUInteger          iterations;
+   NSUInteger          repeats;
+   int                 c;
+   int                 status;
+
+   pool = [[NSAutoreleasePool alloc] init];
+
+   cases        = [LKBenchmark caseNames];
+   uri          = nil;
+   output       = nil;
+   baseDN       = nil;
+   bindWho      = nil;
+   bindPassword = nil;
+   entryCount   = 0;
+   iterations   = 0;
+   repeats      = 0;
+
+   while((c = getopt(argc, argv, "b:c:D:hH:i:n:o:r:w:")) != -1)
+   {
+      switch(c)
+      {
+         case 'b':
+         baseDN = [NSString stringWithUTF8String:optarg];
+         break;
+
+         case 'c':
+         cases = [[NSString stringWithUTF8String:optarg] componentsSeparatedByString:@","];
+         break;
+
+         case 'D':
+         bindWho = [NSString stringWithUTF8String:optarg];
+         break;
+
+         case 'h':
+         lk_benchmark_usage();
+         [pool release];
+         return(0);
+
+         case 'H':
+         uri = [NSString stringWithUTF8String:optarg];
+         break;
+
+         case 'i':
+         iterations = (NSUInteger)strtoul(optarg, NULL, 0);
+         break;
+
+         case 'n':
+         entryCount = (NSUInteger)strtoul(optarg, NULL, 0);
+         break;
+
+         case 'o':
+         output = [NSString stringWithUTF8String:optarg];
+         break;
+
+         case 'r':
+         repeats = (NSUInteger)strtoul(optarg, NULL, 0);
+         break;
+
+         case 'w':
+         bindPassword = [NSString stringWithUTF8String:optarg];
+         break;
+
+         default:
+         fprintf(stderr, "Try `lkbench -h' for more information.\n");
+         [pool release];
+         return(1);
+      };
+   };
+
+   if (!(uri))
+   {
+      fprintf(stderr, "lkbench: missing required option `-H'\n");
+      fprintf(stderr, "Try `lkbench -h' for more information.\n");
+      [pool release];
+      return(1);
+   };
+
+   benchmark = [[LKBenchmark alloc] initWithURI:uri];
+   if ((baseDN))
+      benchmark.baseDN = baseDN;
+   if ((bindWho))
+      benchmark.bindWho = bindWho;
+   if ((bindPassword))
+      benchmark.bindPassword = bindPassword;
+   if ((entryCount))
+      benchmark.entryCount = entryCount;
+   if ((iterations))
+      benchmark.iterations = iterations;
+   if ((repeats))
+      benchmark.repeats = repeats;
+
+   // runs cases in the requested order and stops at the first failure
+   status = 0;
+   for(name in cases)
+   {
+      fprintf(stderr, "lkbench: running %s\n", [name UTF8String]);
+      if (!([benchmark runCase:name]))
+      {
+         fprintf(stderr, "lkbench: case %s failed\n", [name UTF8String]);
+         status = 1;
+         break;
+      };
+   };
+
+   // writes report
+   json = [benchmark reportJSONData];
+   if ((output))
+   {
+      if (!([json writeToFile:output atomically:YES]))
+      {
+         fprintf(stderr, "lkbench: %s: unable to write report\n", [output UTF8String]);
+         status = 1;
+      };
+   }
+   else
+   {
+      fwrite([json bytes], 1, [json length], stdout);
+      printf("\n");
+   };
+
+   [benchmark release];
+   [pool release];
+
+   return(status);
+}
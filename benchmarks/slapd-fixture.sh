@@ -0,0 +1,232 @@
+#!/bin/sh
+#
+#   LDAP Kit
+#   Copyright (c) 2012, Bindle Binaries
+#
+#   @BINDLE_BINARIES_BSD_LICENSE_START@
+#
+#   Redistribution and use in source and binary forms, with or without
+#   modification, are permitted provided that the following conditions are
+#   met:
+#
+#      * Redistributions of source code must retain the above copyright
+#        notice, this list of conditions and the following disclaimer.
+#      * Redistributions in binary form must reproduce the above copyright
+#        notice, this list of conditions and the following disclaimer in the
+#        documentation and/or other materials provided with the distribution.
+#      * Neither the name of Bindle Binaries nor the
+#        names of its contributors may be used to endorse or promote products
+#        derived from this software without specific prior written permission.
+#
+#   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+#   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+#   THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+#   PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BINDLE BINARIES BE LIABLE FOR
+#   ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+#   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+#   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+#   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+#   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+#   OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+#   SUCH DAMAGE.
+#
+#   @BINDLE_BINARIES_BSD_LICENSE_END@
+#
+#   benchmarks/slapd-fixture.sh - runs a local slapd loaded with synthetic entries
+#
+
+# fixture settings
+LKBENCH_DIR=${LKBENCH_DIR:-/tmp/lkbench}
+LKBENCH_ENTRIES=${LKBENCH_ENTRIES:-1000}
+LKBENCH_PORT=${LKBENCH_PORT:-3890}
+LKBENCH_PHOTO_BYTES=${LKBENCH_PHOTO_BYTES:-0}
+LKBENCH_SUFFIX="dc=example,dc=com"
+LKBENCH_ROOTDN="cn=admin,${LKBENCH_SUFFIX}"
+LKBENCH_ROOTPW="secret"
+BACKEND=${BACKEND:-mdb}
+
+# locates slapd
+if test "x${SLAPD}" = "x";then
+   for SLAPD in `which slapd 2> /dev/null` /usr/libexec/slapd /usr/sbin/slapd /usr/local/libexec/slapd;do
+      test -x "${SLAPD}" && break;
+   done;
+fi;
+
+# locates schema files
+if test "x${SCHEMA_DIR}" = "x";then
+   for SCHEMA_DIR in /etc/openldap/schema /etc/ldap/schema /usr/local/etc/openldap/schema;do
+      test -f "${SCHEMA_DIR}/core.schema" && break;
+   done;
+fi;
+
+# determines URIs of the listeners
+LKBENCH_SOCKET="${LKBENCH_DIR}/ldapi"
+LKBENCH_LDAPI="ldapi://`echo "${LKBENCH_SOCKET}" |sed -e 's,%,%25,g' -e 's,/,%2F,g'`/"
+LKBENCH_LDAP="ldap://127.0.0.1:${LKBENCH_PORT}/"
+
+
+# stops a running fixture
+fixture_stop()
+{
+   if test ! -f "${LKBENCH_DIR}/slapd.pid";then
+      return 0;
+   fi;
+   PID=`cat "${LKBENCH_DIR}/slapd.pid"`;
+   kill "${PID}" 2> /dev/null;
+   COUNT=0;
+   while kill -0 "${PID}" 2> /dev/null && test ${COUNT} -lt 50;do
+      sleep 0.2;
+      COUNT=$((${COUNT} + 1));
+   done;
+   rm -f "${LKBENCH_DIR}/slapd.pid";
+   return 0;
+}
+
+
+# writes slapd configuration
+fixture_config()
+{
+   cat > "${LKBENCH_DIR}/slapd.conf" << EOC
+include         ${SCHEMA_DIR}/core.schema
+include         ${SCHEMA_DIR}/cosine.schema
+include         ${SCHEMA_DIR}/inetorgperson.schema
+pidfile         ${LKBENCH_DIR}/slapd.pid
+argsfile        ${LKBENCH_DIR}/slapd.args
+loglevel        none
+sizelimit       unlimited
+EOC
+   if test "x${MODULE_PATH}" != "x";then
+      echo "modulepath      ${MODULE_PATH}"   >> "${LKBENCH_DIR}/slapd.conf";
+      echo "moduleload      back_${BACKEND}"  >> "${LKBENCH_DIR}/slapd.conf";
+   fi;
+   cat >> "${LKBENCH_DIR}/slapd.conf" << EOC
+database        ${BACKEND}
+suffix          "${LKBENCH_SUFFIX}"
+rootdn          "${LKBENCH_ROOTDN}"
+rootpw          ${LKBENCH_ROOTPW}
+directory       ${LKBENCH_DIR}/db
+index           objectClass eq
+index           uid eq
+EOC
+   if test "x${BACKEND}" = "xmdb";then
+      echo "maxsize         4294967296" >> "${LKBENCH_DIR}/slapd.conf";
+   fi;
+   return 0;
+}
+
+
+# writes synthetic entries
+fixture_ldif()
+{
+   awk -v entries="${LKBENCH_ENTRIES}" -v photo="${LKBENCH_PHOTO_BYTES}" \
+       -v suffix="${LKBENCH_SUFFIX}" '
+   BEGIN {
+      # the photo is a repeated JPEG marker which is not valid UTF-8
+      jpeg = "";
+      for(i = 0; i < (photo + 2) / 3; i++)
+         jpeg = jpeg "/9j/";
+
+      printf("dn: %s\nobjectClass: dcObject\nobjectClass: organization\n", suffix);
+      printf("dc: example\no: LDAP Kit Benchmark\n\n");
+      printf("dn: ou=people,%s\nobjectClass: organizationalUnit\nou: people\n\n", suffix);
+
+      for(i = 0; i < entries; i++)
+      {
+         uid = sprintf("user%06d", i);
+         printf("dn: uid=%s,ou=people,%s\n", uid, suffix);
+         printf("objectClass: inetOrgPerson\n");
+         printf("uid: %s\n", uid);
+         printf("cn: Benchmark User %d\n", i);
+         printf("sn: User %d\n", i);
+         printf("givenName: Benchmark\n");
+         printf("mail: %s@example.com\n", uid);
+         printf("telephoneNumber: +1 907 555 %04d\n", i % 10000);
+         printf("description: synthetic entry %d of %d\n", i, entries);
+         if (photo > 0)
+            printf("jpegPhoto:: %s\n", jpeg);
+         printf("\n");
+      };
+   }' > "${LKBENCH_DIR}/entries.ldif";
+   return 0;
+}
+
+
+# starts a fixture with new entries
+fixture_start()
+{
+   if test ! -x "${SLAPD}";then
+      echo "${0}: slapd not found; set SLAPD" 1>&2;
+      return 1;
+   fi;
+   if test ! -f "${SCHEMA_DIR}/core.schema";then
+      echo "${0}: schema files not found; set SCHEMA_DIR" 1>&2;
+      return 1;
+   fi;
+   if test ${LKBENCH_ENTRIES} -gt 999999;then
+      echo "${0}: LKBENCH_ENTRIES must be less than 1000000" 1>&2;
+      return 1;
+   fi;
+
+   fixture_stop;
+   rm -Rf "${LKBENCH_DIR}/db" "${LKBENCH_SOCKET}";
+   mkdir -p "${LKBENCH_DIR}/db" || return 1;
+
+   fixture_config || return 1;
+   fixture_ldif   || return 1;
+
+   "${SLAPD}" -T add -q -f "${LKBENCH_DIR}/slapd.conf" \
+      -l "${LKBENCH_DIR}/entries.ldif" || return 1;
+   "${SLAPD}" -f "${LKBENCH_DIR}/slapd.conf" \
+      -h "${LKBENCH_LDAPI} ${LKBENCH_LDAP}" || return 1;
+
+   # waits for the listeners
+   COUNT=0;
+   while test ! -S "${LKBENCH_SOCKET}";do
+      if test ${COUNT} -ge 50;then
+         echo "${0}: slapd did not start" 1>&2;
+         return 1;
+      fi;
+      sleep 0.2;
+      COUNT=$((${COUNT} + 1));
+   done;
+
+   echo "${LKBENCH_LDAPI}";
+   return 0;
+}
+
+
+case "${1}" in
+   start)
+   fixture_start;
+   exit $?;
+   ;;
+
+   stop)
+   fixture_stop;
+   exit $?;
+   ;;
+
+   uri)
+   echo "${LKBENCH_LDAPI}";
+   ;;
+
+   tcp-uri)
+   echo "${LKBENCH_LDAP}";
+   ;;
+
+   *)
+   echo "Usage: ${0} start | stop | uri | tcp-uri" 1>&2;
+   echo "Environment:" 1>&2;
+   echo "   LKBENCH_DIR          working directory (default: /tmp/lkbench)" 1>&2;
+   echo "   LKBENCH_ENTRIES      number of entries to load (default: 1000)" 1>&2;
+   echo "   LKBENCH_PHOTO_BYTES  size of a jpegPhoto added to each entry (default: 0)" 1>&2;
+   echo "   LKBENCH_PORT         TCP port of the ldap:// listener (default: 3890)" 1>&2;
+   echo "   SLAPD                path of slapd" 1>&2;
+   echo "   SCHEMA_DIR           directory containing core.schema" 1>&2;
+   echo "   BACKEND              slapd database backend (default: mdb)" 1>&2;
+   echo "   MODULE_PATH          directory of backend modules, if not built in" 1>&2;
+   exit 1;
+   ;;
+esac;
+
+# end of script